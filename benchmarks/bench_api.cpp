@@ -0,0 +1,85 @@
+#include <benchmark/benchmark.h>
+#include "include/forti_api.hpp"
+
+static DNSProfile make_profile(std::size_t i) {
+    DNSProfile profile(std::format("profile-{}", i));
+    profile.external_ip_blocklist = {"feed-ads", "feed-malware"};
+    for (unsigned int category = 1; category < 96; category += 2) profile.block_category(category);
+    return profile;
+}
+
+static FirewallPolicy make_policy(std::size_t i) {
+    FirewallPolicy policy;
+    policy.policyid = policy.q_origin_key = static_cast<unsigned int>(i + 1);
+    policy.name = std::format("policy-{}", i);
+    policy.status = "enable";
+    policy.action = i % 4 ? "accept" : "deny";
+    policy.srcintf.push_back({{std::format("port{}", i % 8), ""}});
+    policy.dstintf.push_back({{"wan1", "wan1"}});
+    policy.srcaddr.push_back({{std::format("net-{}", i), ""}});
+    policy.dstaddr.push_back({{"all", "all"}});
+    policy.service.push_back({{"HTTPS", "HTTPS"}});
+    policy.service.push_back({{"DNS", "DNS"}});
+    policy.ssl_ssh_profile = "certificate-inspection";
+    policy.dnsfilter_profile = "default";
+    policy.nat = "enable";
+    return policy;
+}
+
+// Wire-format (hyphenated) payloads the way the device sends them.
+static const nlohmann::json& payload(int which) {
+    static const std::array<nlohmann::json, 3> payloads = [] {
+        DNSProfilesResponse profiles;
+        for (std::size_t i = 0; i < 200; ++i) profiles.results.push_back(make_profile(i));
+
+        FirewallPoliciesResponse policies;
+        for (std::size_t i = 0; i < 2000; ++i) policies.results.push_back(make_policy(i));
+
+        ExternalResourceEntryListResponse entries;
+        entries.results.status = "enable";
+        for (std::size_t i = 0; i < 100'000; ++i)
+            entries.results.entries.push_back({std::format("host-{}.ads.example.com", i), "true"});
+
+        for (auto* response : std::initializer_list<Response*>{&profiles, &policies, &entries}) {
+            response->http_method = "GET";
+            response->status = "success";
+            response->http_status = 200;
+        }
+        return std::array<nlohmann::json, 3>{profiles, policies, entries};
+    }();
+    return payloads[which];
+}
+
+static void BM_ConvertKeysToUnderscores(benchmark::State& state) {
+    const auto& wire = payload(static_cast<int>(state.range(0)));
+    for (auto _ : state) benchmark::DoNotOptimize(convert_keys_to_underscores(wire));
+}
+BENCHMARK(BM_ConvertKeysToUnderscores)->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+static void BM_ConvertKeysToHyphens(benchmark::State& state) {
+    auto local = convert_keys_to_underscores(payload(static_cast<int>(state.range(0))));
+    for (auto _ : state) benchmark::DoNotOptimize(convert_keys_to_hyphens(local));
+}
+BENCHMARK(BM_ConvertKeysToHyphens)->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+template<typename T, int Which>
+static void BM_FromJson(benchmark::State& state) {
+    const auto& wire = payload(Which);
+    for (auto _ : state) {
+        auto response = wire.get<T>();
+        benchmark::DoNotOptimize(response);
+    }
+}
+BENCHMARK_TEMPLATE(BM_FromJson, DNSProfilesResponse, 0)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_FromJson, FirewallPoliciesResponse, 1)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_FromJson, ExternalResourceEntryListResponse, 2)->Unit(benchmark::kMillisecond);
+
+// Per-request bookkeeping FortiClient adds to every attempt, contended across threads.
+static void BM_RecordRequestMetrics(benchmark::State& state) {
+    RequestTiming timing{std::chrono::microseconds(120), {}, {}, std::chrono::microseconds(900),
+                         std::chrono::microseconds(1400), 512, 4096};
+    auto path = std::format("/cmdb/firewall/policy/{}", state.thread_index());
+    for (auto _ : state) RequestMetrics::record("192.0.2.1:443", "GET", path, 200, timing);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RecordRequestMetrics)->Threads(1)->Threads(8);
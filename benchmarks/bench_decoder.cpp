@@ -0,0 +1,45 @@
+#include <benchmark/benchmark.h>
+#include "include/forti_api/threat_feed.hpp"
+
+static std::string entry_list_payload(std::size_t count) {
+    std::string payload = R"({"http_method":"GET","size":1,"status":"success","http_status":200,"build":2662,)"
+                          R"("results":{"status":"enable","resource-file-status":"valid",)"
+                          R"("last-content-update-time":1725000000,"entries":[)";
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i) payload += ',';
+        payload += std::format(R"({{"entry":"host-{}.ads.example.com","valid":"true"}})", i);
+    }
+    return payload + "]}}";
+}
+
+static void BM_DecodeEntryListDom(benchmark::State& state) {
+    auto payload = entry_list_payload(state.range(0));
+    for (auto _ : state) {
+        ExternalResourceEntryListResponse response =
+                convert_keys_to_underscores(nlohmann::json::parse(payload));
+        benchmark::DoNotOptimize(response);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * payload.size()));
+}
+BENCHMARK(BM_DecodeEntryListDom)->Arg(100'000)->Unit(benchmark::kMillisecond);
+
+static void BM_DecodeEntryListSax(benchmark::State& state) {
+    auto payload = entry_list_payload(state.range(0));
+    for (auto _ : state) {
+        auto response = SaxDecoder::decode<ExternalResourceEntryListResponse>(payload);
+        benchmark::DoNotOptimize(response);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * payload.size()));
+}
+BENCHMARK(BM_DecodeEntryListSax)->Arg(100'000)->Unit(benchmark::kMillisecond);
+
+// The same document as a SnapshotStore keeps it on disk.
+static void BM_DecodeEntryListMsgpack(benchmark::State& state) {
+    auto payload = nlohmann::json::to_msgpack(nlohmann::json::parse(entry_list_payload(state.range(0))));
+    for (auto _ : state) {
+        auto response = SaxDecoder::decode_msgpack<ExternalResourceEntryListResponse>(payload);
+        benchmark::DoNotOptimize(response);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * payload.size()));
+}
+BENCHMARK(BM_DecodeEntryListMsgpack)->Arg(100'000)->Unit(benchmark::kMillisecond);
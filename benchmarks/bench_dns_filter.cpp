@@ -0,0 +1,78 @@
+#include <benchmark/benchmark.h>
+#include "include/forti_api/dns_filter.hpp"
+
+// Every other category blocked, so lookups hit and miss evenly.
+static DNSFilterOptions filters(std::size_t categories) {
+    DNSFilterOptions options;
+    for (unsigned int category = 0; category < categories; category += 2) options.block(category);
+    return options;
+}
+
+static void BM_FindCategory(benchmark::State& state) {
+    auto categories = static_cast<unsigned int>(state.range(0));
+    auto options = filters(categories);
+    unsigned int category = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(options.find_category(category));
+        category = (category + 7) % categories;
+    }
+}
+BENCHMARK(BM_FindCategory)->Arg(256)->Arg(65'536);
+
+// Block then allow the same missing category: one insert and one erase in the middle of the list.
+static void BM_BlockAllow(benchmark::State& state) {
+    auto categories = static_cast<unsigned int>(state.range(0));
+    auto options = filters(categories);
+    unsigned int category = 1;
+    for (auto _ : state) {
+        options.block(category);
+        options.allow(category);
+        category = (category + 14) % categories | 1;
+    }
+    benchmark::DoNotOptimize(options.filters.data());
+}
+BENCHMARK(BM_BlockAllow)->Arg(256)->Arg(65'536);
+
+static void BM_ApplyChanges(benchmark::State& state) {
+    auto options = filters(256);
+    std::vector<CategoryChange> changes;
+    for (unsigned int category = 0; category < 256; ++category)
+        changes.push_back({category, category % 3 ? CategoryAction::BLOCK : CategoryAction::ALLOW});
+    for (auto _ : state) {
+        auto copy = options;
+        benchmark::DoNotOptimize(copy.apply(changes));
+    }
+}
+BENCHMARK(BM_ApplyChanges);
+
+static void BM_CategoryFilterAction(benchmark::State& state) {
+    auto categories = static_cast<unsigned int>(state.range(0));
+    auto dense = filters(categories).categories();
+    unsigned int category = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dense.action(category));
+        category = (category + 7) % categories;
+    }
+}
+BENCHMARK(BM_CategoryFilterAction)->Arg(256)->Arg(65'536);
+
+static void BM_CategoryFilterRoundTrip(benchmark::State& state) {
+    auto options = filters(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        auto filters = CategoryFilter(options.filters).filters();
+        benchmark::DoNotOptimize(filters.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(options.filters.size()));
+}
+BENCHMARK(BM_CategoryFilterRoundTrip)->Arg(256)->Arg(65'536);
+
+static void BM_ConformToTemplate(benchmark::State& state) {
+    auto options = filters(256);
+    CategoryFilter policy;
+    for (unsigned int category = 0; category < 256; category += 3) policy.set(category, CategoryAction::BLOCK);
+    for (auto _ : state) {
+        auto copy = options;
+        benchmark::DoNotOptimize(copy.conform_to(policy));
+    }
+}
+BENCHMARK(BM_ConformToTemplate);
@@ -0,0 +1,31 @@
+#include <benchmark/benchmark.h>
+#include "include/forti_api/domain_ingest.hpp"
+
+static const std::string& blocklist() {
+    static const std::string list = [] {
+        std::string data;
+        for (std::size_t i = 0; data.size() < 64 * 1024 * 1024; ++i) {
+            switch (i % 3) {
+                case 0: data += std::format("0.0.0.0 Tracker-{}.Ads.Example.com # hosts\n", i % 2'000'000); break;
+                case 1: data += std::format("||banner{}.adnetwork.example.net^\n", i); break;
+                default: data += std::format("metrics.{}.example.org.\n", i); break;
+            }
+        }
+        return data;
+    }();
+    return list;
+}
+
+static void BM_IngestBlocklist(benchmark::State& state) {
+    const auto& list = blocklist();
+    IngestOptions options;
+    options.threads = static_cast<unsigned int>(state.range(0));
+    options.parallel_threshold = 0;
+
+    for (auto _ : state) {
+        auto domains = DomainIngest::ingest(list, options);
+        benchmark::DoNotOptimize(domains);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * list.size()));
+}
+BENCHMARK(BM_IngestBlocklist)->Arg(1)->Arg(4)->Arg(8)->Unit(benchmark::kMillisecond)->UseRealTime();
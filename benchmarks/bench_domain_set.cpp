@@ -0,0 +1,37 @@
+#include <benchmark/benchmark.h>
+#include <format>
+#include "include/forti_api/domain_set.hpp"
+
+static const DomainSet& feed_set() {
+    static const DomainSet set = [] {
+        std::vector<std::pair<std::string, bool>> domains;
+        domains.reserve(1'000'000);
+        for (std::size_t i = 0; i < 1'000'000; ++i)
+            domains.emplace_back(std::format("tracker-{}.ads{}.example.com", i, i % 97), true);
+        return DomainSet(domains);
+    }();
+    return set;
+}
+
+static void BM_DomainSetContains(benchmark::State& state) {
+    const auto& set = feed_set();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        auto domain = std::format("tracker-{}.ads{}.example.com", i, i % 97);
+        benchmark::DoNotOptimize(set.contains(domain));
+        i = (i + 7919) % 1'000'000;
+    }
+    state.counters["bytes"] = static_cast<double>(set.memory_usage());
+}
+BENCHMARK(BM_DomainSetContains);
+
+static void BM_DomainSetCovers(benchmark::State& state) {
+    const auto& set = feed_set();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        auto domain = std::format("cdn.tracker-{}.ads{}.example.com", i, i % 97);
+        benchmark::DoNotOptimize(set.covers(domain));
+        i = (i + 7919) % 1'000'000;
+    }
+}
+BENCHMARK(BM_DomainSetCovers);
@@ -0,0 +1,51 @@
+#include <benchmark/benchmark.h>
+#include <format>
+#include <random>
+#include "include/forti_api/policy_match.hpp"
+
+static PolicyMatcher build_matcher(std::size_t count) {
+    PolicyMatcher::Objects objects;
+    std::vector<FirewallPolicy> policies;
+    for (std::size_t i = 0; i < count; ++i) {
+        FirewallAddress address;
+        address.name = std::format("net-{}", i);
+        address.subnet = std::format("10.{}.{}.0 255.255.255.0", i / 256 % 256, i % 256);
+        objects.addresses.push_back(address);
+
+        ServiceCustom service;
+        service.name = std::format("svc-{}", i);
+        service.protocol = "TCP/UDP/SCTP";
+        service.tcp_portrange = std::format("{}-{}", 1000 + i % 5000, 1100 + i % 5000);
+        objects.services.push_back(service);
+
+        FirewallPolicy policy;
+        policy.policyid = static_cast<unsigned int>(i + 1);
+        policy.action = "accept";
+        policy.srcintf.push_back({{std::format("port{}", i % 8), ""}});
+        policy.dstintf.push_back({{"wan1", "wan1"}});
+        policy.srcaddr.push_back({{address.name, ""}});
+        policy.dstaddr.push_back({{"all", "all"}});
+        policy.service.push_back({{service.name, ""}});
+        policies.push_back(policy);
+    }
+    return PolicyMatcher(policies, objects);
+}
+
+static void BM_PolicyMatch(benchmark::State& state) {
+    auto count = static_cast<std::size_t>(state.range(0));
+    auto matcher = build_matcher(count);
+
+    std::mt19937 random(42);
+    std::vector<PacketTuple> packets(4096);
+    for (auto& packet : packets) {
+        auto i = random() % count;
+        packet = {matcher.interface_id(std::format("port{}", i % 8)), matcher.interface_id("wan1"),
+                  static_cast<std::uint32_t>(10u << 24 | (i / 256 % 256) << 16 | (i % 256) << 8 | 7),
+                  0x08080808u, 6, static_cast<std::uint16_t>(1050 + i % 5000)};
+    }
+
+    std::size_t n = 0;
+    for (auto _ : state) benchmark::DoNotOptimize(matcher.match_index(packets[n++ & 4095]));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_PolicyMatch)->Arg(1000)->Arg(10000);
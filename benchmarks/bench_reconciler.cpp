@@ -0,0 +1,39 @@
+#include <benchmark/benchmark.h>
+#include "include/forti_api.hpp"
+
+// A device with n profiles and n policies, and a desired state that changes every eighth of each: the
+// cost of planning is the diff itself, so most objects are unchanged as in a typical deploy.
+static std::pair<ConfigState, ConfigState> states(std::size_t n) {
+    ConfigState current, desired;
+    for (std::size_t i = 0; i < n; ++i) {
+        DNSProfile profile(std::format("profile-{}", i));
+        for (unsigned int category = 1; category < 90; category += 3) profile.block_category(category);
+        unsigned int id = 0;
+        for (auto& filter : profile.ftgd_dns.filters) filter.id = ++id;
+        current.dns_profiles.push_back(profile);
+
+        for (auto& filter : profile.ftgd_dns.filters) filter.id = 0;
+        if (i % 8 == 0) profile.block_category(150);
+        desired.dns_profiles.push_back(profile);
+
+        FirewallPolicy policy;
+        policy.policyid = static_cast<unsigned int>(i + 1);
+        policy.name = std::format("policy-{}", i);
+        policy.action = "accept";
+        policy.dnsfilter_profile = profile.name;
+        current.firewall_policies.push_back(policy);
+        if (i % 8 == 0) policy.comments = "managed";
+        desired.firewall_policies.push_back(policy);
+    }
+    return {current, desired};
+}
+
+static void BM_PlanReconcile(benchmark::State& state) {
+    auto [current, desired] = states(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        auto plan = Reconciler::plan(desired, current);
+        benchmark::DoNotOptimize(plan.changes.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * 2);  // objects diffed
+}
+BENCHMARK(BM_PlanReconcile)->Arg(64)->Arg(1024)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,74 @@
+#include <benchmark/benchmark.h>
+#include "include/forti_api.hpp"
+
+// End-to-end workflows against recorded responses: everything the library does per request except the
+// network, so the numbers are the client-side ceiling on a device that answers instantly.
+
+static const DeviceConfig replay_device{"192.0.2.1", 8443, "ca.pem", "cert.p12", "secret", "key"};
+
+static std::shared_ptr<ReplayTransport> profile_replay(std::size_t profiles) {
+    DNSProfilesResponse listing;
+    listing.status = "success";
+    listing.http_status = 200;
+    Response updated;
+    updated.status = "success";
+    updated.http_status = 200;
+
+    std::vector<Exchange> exchanges;
+    for (std::size_t i = 0; i < profiles; ++i) {
+        DNSProfile profile(std::format("profile-{}", i));
+        for (unsigned int category = 1; category < 90; category += 3) profile.block_category(category);
+        listing.results.push_back(profile);
+        exchanges.push_back({"PUT", std::format("/cmdb/dnsfilter/profile/{}", profile.name), "",
+                             {CURLE_OK, 200, nlohmann::json(updated).dump()}});
+    }
+    exchanges.push_back({"GET", "/cmdb/dnsfilter/profile", "", {CURLE_OK, 200, nlohmann::json(listing).dump()}});
+    return std::make_shared<ReplayTransport>(std::move(exchanges));
+}
+
+static void BM_ReplayDNSFilterApply(benchmark::State& state) {
+    auto profiles = static_cast<std::size_t>(state.range(0));
+    FortiAPI::Scope scope(FortiClient::create(replay_device, profile_replay(profiles)));
+    for (auto _ : state) {
+        // the replayed listing never changes, so every profile needs the PUT each time
+        auto results = DNSFilter::apply_category_changes({{150, CategoryAction::BLOCK}});
+        benchmark::DoNotOptimize(results);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * (profiles + 1)));  // requests
+}
+BENCHMARK(BM_ReplayDNSFilterApply)->Arg(8)->Arg(64)->Unit(benchmark::kMicrosecond);
+
+static void BM_ReplayThreatFeedStream(benchmark::State& state) {
+    std::vector<std::string> entries;
+    entries.reserve(static_cast<std::size_t>(state.range(0)));
+    for (int64_t i = 0; i < state.range(0); ++i) entries.push_back(std::format("tracker-{}.ads.example.com", i));
+
+    auto replay = std::make_shared<ReplayTransport>(std::vector<Exchange>{
+            {"POST", "/monitor/system/external-resource/dynamic", "", {CURLE_OK, 200, R"({"status":"success"})"}}});
+    FortiAPI::Scope scope(FortiClient::create(replay_device, replay));
+    for (auto _ : state) {
+        auto response = ThreatFeed::stream_feed("blocklist", entries_from(entries.begin(), entries.end()));
+        benchmark::DoNotOptimize(response);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));  // feed entries
+}
+BENCHMARK(BM_ReplayThreatFeedStream)->Arg(10'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+// Recorded latency scaled to a 2ms device: shows how much of it batching hides.
+static void BM_ReplayBatchWithLatency(benchmark::State& state) {
+    std::vector<Exchange> exchanges;
+    std::vector<BatchRequest> requests;
+    for (int i = 0; i < 64; ++i) {
+        auto path = std::format("/cmdb/firewall/policy/{}", i);
+        exchanges.push_back({"GET", path, "", {CURLE_OK, 200, R"({"status":"success","http_status":200})"}});
+        requests.push_back({"GET", path});
+    }
+    FortiClient client(replay_device, std::make_shared<ReplayTransport>(exchanges, ReplayOptions{.latency = std::chrono::milliseconds(2)}));
+    client.configure_limiter({.initial = 32, .min = 1, .max = 32});
+    for (auto _ : state) {
+        auto results = client.batch<Response>(requests, static_cast<unsigned int>(state.range(0)));
+        benchmark::DoNotOptimize(results);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(requests.size()));
+}
+BENCHMARK(BM_ReplayBatchWithLatency)->Arg(1)->Arg(8)->Arg(32)->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,56 @@
+#include <benchmark/benchmark.h>
+#include "include/forti_api/system.hpp"
+
+// trust() on a subnet the user doesn't have yet: the containment check, the dedupe scan and the insert.
+static void BM_APIUserTrust(benchmark::State& state) {
+    APIUser user;
+    for (int i = 0; i < state.range(0); ++i) user.trust(std::format("10.{}.{}.0/24", i / 256 % 256, i % 256));
+
+    bool ipv6 = state.range(1);
+    auto subnet = ipv6 ? std::string("2001:0db8:85a3:0000:0000:8a2e:0370:7334") : std::string("192.168.100.200");
+    for (auto _ : state) {
+        user.trust(subnet);
+        user.distrust(subnet);
+    }
+    benchmark::DoNotOptimize(user.trusthost.size());
+}
+BENCHMARK(BM_APIUserTrust)->ArgsProduct({{1, 16, 256}, {0, 1}});
+
+static void BM_ParsePrefix(benchmark::State& state) {
+    std::array<std::string_view, 4> inputs{"10.20.30.0 255.255.255.0", "192.168.7.14/32", "2001:db8:85a3::8a2e:0:0/96",
+                                           "::ffff:10.0.0.1"};
+    for (auto _ : state)
+        for (auto input : inputs) benchmark::DoNotOptimize(IPPrefix::parse(input));
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(inputs.size()));
+}
+BENCHMARK(BM_ParsePrefix);
+
+// Is a client covered by one of range(0) trusthosts.
+static void BM_TrustHostCovers(benchmark::State& state) {
+    APIUser user;
+    std::vector<std::string> subnets;
+    for (int i = 0; i < state.range(0); ++i) subnets.push_back(std::format("10.{}.{}.0/24", i / 256 % 256, i % 256));
+    user.sync_trusthosts(subnets);
+
+    std::vector<std::string> clients;
+    for (int i = 0; i < 1024; ++i) clients.push_back(std::format("10.{}.{}.{}", i % 64, i * 7 % 256, i % 250));
+    std::size_t i = 0;
+    for (auto _ : state) benchmark::DoNotOptimize(user.covers(clients[i++ % clients.size()]));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TrustHostCovers)->Arg(16)->Arg(4096);
+
+// Bulk sync of range(0) prefixes, a quarter of them nested inside others.
+static void BM_SyncTrusthosts(benchmark::State& state) {
+    std::vector<std::string> subnets;
+    for (int i = 0; i < state.range(0); ++i) {
+        if (i % 4 == 3) subnets.push_back(std::format("10.{}.{}.128/25", (i - 1) / 256 % 256, (i - 1) % 256));
+        else subnets.push_back(std::format("10.{}.{}.0/24", i / 256 % 256, i % 256));
+    }
+    for (auto _ : state) {
+        APIUser user;
+        benchmark::DoNotOptimize(user.sync_trusthosts(subnets));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SyncTrusthosts)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,35 @@
+#include <benchmark/benchmark.h>
+#include "include/forti_api/threat_feed.hpp"
+
+static const std::vector<std::string>& feed_entries() {
+    static const std::vector<std::string> entries = [] {
+        std::vector<std::string> list;
+        list.reserve(1'000'000);
+        for (std::size_t i = 0; i < 1'000'000; ++i) list.push_back(std::format("tracker-{}.ads{}.example.com", i, i % 97));
+        return list;
+    }();
+    return entries;
+}
+
+static void BM_SerializeCommandsRequest(benchmark::State& state) {
+    CommandsRequest request(CommandEntry("blocklist", feed_entries()));
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        auto body = nlohmann::json(request).dump();
+        bytes += body.size();
+        benchmark::DoNotOptimize(body);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_SerializeCommandsRequest)->Unit(benchmark::kMillisecond);
+
+static void BM_StreamCommandsRequest(benchmark::State& state) {
+    const auto& entries = feed_entries();
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        CommandStream stream("blocklist", entries_from(entries.begin(), entries.end()));
+        for (auto chunk = stream(); !chunk.empty(); chunk = stream()) bytes += chunk.size();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_StreamCommandsRequest)->Unit(benchmark::kMillisecond);
@@ -12,7 +12,7 @@ class Pkg(ConanFile):
     topics = ("c++", "security")
     settings = "os", "compiler", "arch", "build_type"
     generators = "PkgConfigDeps", "MesonToolchain"
-    exports_sources = "meson.build", "include/*", "tests/*", "main.cpp"
+    exports_sources = "meson.build", "include/*", "tests/*", "benchmarks/*", "main.cpp"
 
     def layout(self):
         self.folders.source = '.'
@@ -24,6 +24,7 @@ class Pkg(ConanFile):
         self.requires('nlohmann_json/3.11.3')
         self.requires('libcurl/8.9.1')
         self.test_requires('gtest/1.14.0')
+        self.test_requires('benchmark/1.8.4')
 
     def build(self):
         meson = Meson(self)
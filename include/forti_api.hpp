@@ -9,5 +9,10 @@
 #include "forti_api/dns_filter.hpp"
 #include "forti_api/system.hpp"
 #include "forti_api/firewall.hpp"
+#include "forti_api/domain_set.hpp"
+#include "forti_api/policy_match.hpp"
+#include "forti_api/fleet.hpp"
+#include "forti_api/record_replay.hpp"
+#include "forti_api/reconciler.hpp"
 
 #endif //FORTI_API_H
@@ -15,17 +15,78 @@
 #include <utility>
 #include <cstdlib>
 #include <stdexcept>
-#include <regex>
-
-inline static std::regex ipv4("(([0-9]|[1-9][0-9]|1[0-9][0-9]|2[0-4][0-9]|25[0-5])\\.){3}([0-9]|[1-9][0-9]|1[0-9][0-9]|2[0-4][0-9]|25[0-5])");
-inline static std::regex ipv6("((([0-9a-fA-F]){1,4})\\:){7}([0-9a-fA-F]){1,4}");
+#include <memory>
+#include <expected>
+#include <vector>
+#include <functional>
+#include <string_view>
+#include <cstring>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <concepts>
+#include <optional>
+#include <deque>
+#include <thread>
+#include "connection_pool.hpp"
+#include "transport.hpp"
+#include "decoder.hpp"
+#include "response_cache.hpp"
+#include "snapshot_store.hpp"
+#include "request_scheduler.hpp"
+#include "metrics.hpp"
 
 struct Response {
     unsigned int size{}, matched_count{}, next_idx{}, http_status{}, build{};
+    int error{};  // FortiOS error code of a failed request, e.g. -3 for a missing entry
     std::string http_method, revision, vdom, path, name, status, serial, version;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(Response, http_method, size, matched_count, next_idx, revision,
-                                                vdom, path, name, status, http_status, serial, version, build)
+    FORTI_API_DEFINE_TYPE(Response, http_method, size, matched_count, next_idx, revision,
+                                                vdom, path, name, status, http_status, error, serial, version, build)
+};
+
+enum class MutationStatus {
+    OK,
+    NOT_FOUND,
+    ALREADY_EXISTS,
+    IN_USE,  // still referenced by another object
+    FAILED,
+};
+
+// What the device made of a create, update or delete that was sent without checking first.
+struct MutationResult {
+    MutationStatus status = MutationStatus::FAILED;
+    Response response;
+
+    explicit operator bool() const { return status == MutationStatus::OK; }
+
+    // Prints the device's answer unless it succeeded, as FortiAPI::put and friends do.
+    const MutationResult &report() const {
+        if (status != MutationStatus::OK) std::cerr << nlohmann::json(response).dump(4) << std::endl;
+        return *this;
+    }
+};
+
+inline MutationStatus classify_mutation(const Response &response) {
+    if (response.status == "success") return MutationStatus::OK;
+    if (response.error == -3 || response.http_status == 404) return MutationStatus::NOT_FOUND;
+    if (response.error == -5) return MutationStatus::ALREADY_EXISTS;
+    if (response.error == -23) return MutationStatus::IN_USE;
+    return MutationStatus::FAILED;
+}
+
+struct RequestError {
+    long http_status{};
+    std::string message;
+};
+
+template<typename T>
+using Result = std::expected<T, RequestError>;
+
+struct BatchRequest {
+    std::string method, path;
+    nlohmann::json data{};
 };
 
 inline static nlohmann::json convert_keys_to_hyphens(const nlohmann::json& j) {
@@ -87,197 +148,599 @@ inline static nlohmann::json convert_keys_to_underscores(const nlohmann::json& j
     return result;
 }
 
+// Settings of the default device behind the static FortiAPI facade. Every change bumps a generation
+// counter so FortiAPI builds a fresh client on its next call; clients already handed out keep theirs.
 class FortiAuth {
-    inline static unsigned int admin_https_port = 0;
-    inline static std::string gateway_ip;
-    inline static std::string ca_cert_path;
-    inline static std::string ssl_cert_path;
-    inline static std::string cert_password;
-    inline static std::string api_key;
-    inline static std::string auth_header;
-
-    static std::string check_env(const char* env_var_name) {
-        const char* value = std::getenv(env_var_name);
-        if (value == nullptr) {
-            std::cerr << "[DEBUG] Missing required field: '" << env_var_name << "'. Please set this in your environment.\n";
-            return "";
-        }
-        return value;
+    inline static std::mutex mutex;
+    inline static DeviceConfig config;
+    inline static std::atomic<unsigned long> generation{0};
+
+    template<typename F>
+    static void update(F&& apply) {
+        std::lock_guard lock(mutex);
+        apply(config);
+        generation.fetch_add(1, std::memory_order_release);
     }
 
 public:
-    inline static bool PROGRAM_IS_RUNNING = false;
+    static void set_vars_from_env() { set_config(DeviceConfig::from_env()); }
 
-    static void set_vars_from_env() {
-        set_admin_https_port(std::stoi(check_env("FORTIGATE_ADMIN_HTTPS_PORT")));
-        set_gateway_ip(check_env("FORTIGATE_GATEWAY_IP"));
-        set_ca_cert_path(check_env("PATH_TO_FORTIGATE_CA_CERT"));
-        set_ssl_cert_path(check_env("PATH_TO_FORTIGATE_SSL_CERT"));
-        set_cert_password(check_env("FORTIGATE_SSL_CERT_PASS"));
-        set_api_key(check_env("FORTIGATE_API_KEY"));
-        set_auth_header();
-    }
+    static void set_config(DeviceConfig device) { update([&](DeviceConfig& c) { c = std::move(device); }); }
 
-    static void set_admin_https_port(unsigned int port) { admin_https_port = port; }
+    static void set_admin_https_port(unsigned int port) { update([&](DeviceConfig& c) { c.admin_https_port = port; }); }
 
-    static void set_gateway_ip(const std::string& ip) { gateway_ip = ip; }
+    static void set_gateway_ip(const std::string& ip) { update([&](DeviceConfig& c) { c.gateway_ip = ip; }); }
 
-    static void set_ca_cert_path(const std::string& path) { ca_cert_path = path; }
+    static void set_ca_cert_path(const std::string& path) { update([&](DeviceConfig& c) { c.ca_cert_path = path; }); }
 
-    static void set_ssl_cert_path(const std::string& path) { ssl_cert_path = path; }
+    static void set_ssl_cert_path(const std::string& path) { update([&](DeviceConfig& c) { c.ssl_cert_path = path; }); }
 
-    static void set_cert_password(const std::string& password) { cert_password = password; }
+    static void set_cert_password(const std::string& password) {
+        update([&](DeviceConfig& c) { c.cert_password = password; });
+    }
+
+    static void set_api_key(const std::string& key) { update([&](DeviceConfig& c) { c.api_key = key; }); }
 
-    static void set_api_key(const std::string& key) {
-        api_key = key;
-        set_auth_header();
+    static DeviceConfig get_config() {
+        std::lock_guard lock(mutex);
+        return config;
     }
 
-    static void set_auth_header() { if (!api_key.empty()) auth_header = "Authorization: Bearer " + api_key; }
+    static unsigned long get_generation() { return generation.load(std::memory_order_acquire); }
+
+    static unsigned int get_admin_https_port() { return get_config().admin_https_port; }
+    static std::string get_gateway_ip() { return get_config().gateway_ip; }
+    static std::string get_ca_cert_path() { return get_config().ca_cert_path; }
+    static std::string get_ssl_cert_path() { return get_config().ssl_cert_path; }
+    static std::string get_cert_password() { return get_config().cert_password; }
+    static std::string get_api_key() { return get_config().api_key; }
+    static std::string get_auth_header() { return get_config().auth_header(); }
+};
+
 
-    static unsigned int get_admin_https_port() {
-        if (PROGRAM_IS_RUNNING && admin_https_port == 0) {
-            std::cerr << "[WARNING] admin_ssh_port is uninitialized!\n";
+// One FortiGate: an immutable config plus the transport that reaches it, the response cache and the
+// request scheduler. Every member is safe to call from any number of threads, so one instance is meant
+// to be shared by shared_ptr across all the work aimed at that device.
+class FortiClient {
+    const DeviceConfig config;
+    const std::shared_ptr<Transport> transport;
+    const std::string metrics_label;  // device label of this client's RequestMetrics series
+    ResponseCache cache;
+    SnapshotStore snapshots;
+    ConcurrencyLimiter limiter;
+    std::atomic<unsigned int> batch_concurrency{8};
+
+    mutable std::mutex retry_mutex;
+    RetryPolicy retry;
+
+    using Clock = std::chrono::steady_clock;
+    inline static thread_local std::optional<Clock::time_point> deadline;
+    inline static thread_local std::shared_ptr<const std::atomic<bool>> cancelled;
+
+    inline static std::string revision_probe = "/cmdb/system/global?format=hostname";
+
+    // Bookkeeping for one try at a request while the transport has it.
+    struct Attempt {
+        std::string method, path;
+        unsigned int number = 1;
+        bool streamed = false;
+        Clock::time_point started = Clock::now();
+
+        [[nodiscard]] std::chrono::microseconds elapsed() const {
+            return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started);
         }
-        return admin_https_port;
+    };
+
+    static TransportRequest make_request(const std::string &method, const std::string &path,
+                                         const nlohmann::json &data, BodySource source = {}) {
+        std::string body = source ? "" : data.dump();
+        return {method, path, std::move(body), std::move(source), deadline, cancelled};
     }
 
-    static std::string get_gateway_ip() {
-        if (PROGRAM_IS_RUNNING && gateway_ip.empty()) std::cerr << "[WARNING] gateway_ip is uninitialized!\n";
-        return gateway_ip;
+    // Hands the attempt's slot back to the limiter along with how it went.
+    RequestOutcome settle(const Attempt &attempt, const TransportResponse &response) {
+        auto outcome = classify_attempt(response.code, response.http_status, attempt.method);
+        limiter.release(attempt.elapsed(), outcome);
+        RequestMetrics::record(metrics_label, attempt.method, attempt.path, response.http_status, response.timing);
+        return outcome;
     }
 
-    static std::string get_ca_cert_path() {
-        if (PROGRAM_IS_RUNNING && ca_cert_path.empty()) std::cerr << "[WARNING] ca_cert_path is uninitialized!\n";
-        return ca_cert_path;
+    // Backoff before the next attempt, nullopt when the request can't or shouldn't be repeated. Streamed
+    // bodies are consumed by the first attempt and are never retried.
+    std::optional<std::chrono::milliseconds> retry_delay(const Attempt &attempt, const TransportResponse &response,
+                                                         const RetryPolicy &policy) const {
+        if (attempt.streamed || attempt.number >= policy.max_attempts) return std::nullopt;
+        auto delay = policy.backoff(attempt.number, response.retry_after);
+        if (deadline && Clock::now() + delay >= *deadline) return std::nullopt;
+        return delay;
     }
 
-    static std::string get_ssl_cert_path() {
-        if (PROGRAM_IS_RUNNING && ssl_cert_path.empty()) std::cerr << "[WARNING] ssl_cert_path is uninitialized!\n";
-        return ssl_cert_path;
+    template<typename T>
+    static T decode(const std::string &buffer) { return SaxDecoder::decode<T>(buffer); }
+
+    // Decodes the response body, charging the CPU time it took to the request's metrics series.
+    template<typename T>
+    T decode(const std::string &method, const std::string &path, const TransportResponse &response) {
+        auto started = thread_cpu_time();
+        T result = decode<T>(response.body);
+        RequestMetrics::record_decode(metrics_label, method, path, response.http_status, thread_cpu_time() - started);
+        return result;
+    }
+
+    template<typename T>
+    Result<T> finish(const std::string &method, const std::string &path, const TransportResponse &response) {
+        if (response.code != CURLE_OK) return std::unexpected(RequestError{0, curl_easy_strerror(response.code)});
+        try {
+            T result = decode<T>(method, path, response);
+            if (response.http_status >= 400)
+                return std::unexpected(RequestError{response.http_status, std::format("{} {} failed with HTTP {}",
+                                                                                      method, path, response.http_status)});
+            return result;
+        } catch (const nlohmann::json::exception &e) {
+            return std::unexpected(RequestError{response.http_status, e.what()});
+        }
     }
 
-    static std::string get_cert_password() {
-        if (PROGRAM_IS_RUNNING && cert_password.empty()) std::cerr << "[WARNING] cert_password is uninitialized!\n";
-        return cert_password;
+    // Retries throttled and transient failures with backoff; throws once they're exhausted, or when
+    // the response isn't something T can be decoded from.
+    // raw_body, when given, receives the body T was decoded from.
+    template<typename T>
+    T request(const std::string &method, const std::string &path, const nlohmann::json &data = {},
+              BodySource source = {}, std::string *raw_body = nullptr) {
+        auto policy = retry_policy();
+        for (unsigned int number = 1;; ++number) {
+            Attempt attempt{method, path, number, static_cast<bool>(source)};
+            auto outgoing = make_request(method, path, data, number == 1 ? std::move(source) : BodySource{});
+            if (!limiter.acquire(deadline))
+                throw std::runtime_error(std::format("{} {} timed out waiting for a request slot", method, path));
+            HeldSlot slot(limiter);
+            attempt.started = Clock::now();
+
+            auto response = transport->perform(std::move(outgoing));
+            slot.dismiss();  // settle() hands the slot back
+            if (settle(attempt, response) == RequestOutcome::RETRYABLE) {
+                if (auto delay = retry_delay(attempt, response, policy)) {
+                    limiter.record_retry();
+                    std::this_thread::sleep_for(*delay);
+                    continue;
+                }
+            }
+
+            if (method != "GET") invalidate(path);
+            if (response.code != CURLE_OK)
+                throw std::runtime_error(std::format("{} {} failed: {}", method, path, curl_easy_strerror(response.code)));
+
+            try {
+                T result = decode<T>(method, path, response);
+                if (raw_body) *raw_body = std::move(response.body);
+                return result;
+            } catch (const nlohmann::json::exception &) {
+                if (response.http_status >= 400)
+                    throw std::runtime_error(std::format("{} {} failed with HTTP {}", method, path, response.http_status));
+                throw;
+            }
+        }
     }
 
-    static std::string get_api_key() {
-        if (PROGRAM_IS_RUNNING && api_key.empty()) std::cerr << "[WARNING] api_key is uninitialized!\n";
-        return api_key;
+    Response validate(const std::string &method, const std::string &path, const nlohmann::json &data = {}) {
+        auto response = request<Response>(method, path, data);
+        if (response.status != "success") std::cerr << nlohmann::json(response).dump(4) << std::endl;
+        return response;
     }
 
-    static std::string get_auth_header() {
-        if (PROGRAM_IS_RUNNING && auth_header.empty()) std::cerr << "[WARNING] auth_header is uninitialized!\n";
-        return auth_header;
+    // Serial and current config revision, used to revalidate cached entries that outlived max_age.
+    SnapshotTag probe_device() {
+        auto response = request<Response>("GET", revision_probe);
+        if (response.http_status != 200) return {};
+        return {response.serial, response.revision};
     }
-};
 
+    std::string probe_revision() { return probe_device().revision; }
 
-class FortiAPI {
-    inline static std::string BASE_API_ENDPOINT() {
-        return std::format("https://{}:{}/api/v2", FortiAuth::get_gateway_ip(), FortiAuth::get_admin_https_port());
+    // A write changes the config revision, so cached reads of the table and the last revision check go.
+    void invalidate(const std::string &path) {
+        cache.invalidate(path);
+        snapshots.invalidate();
     }
 
-    static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp) {
-        ((std::string*)userp)->append((char*)contents, size * nmemb);
-        return size * nmemb;
+    template<typename T>
+    std::optional<T> cached(const std::string &path) {
+        if constexpr (std::derived_from<T, Response>) {
+            if (ResponseCache::cacheable(path)) return cache.lookup<T>(path, [this] { return probe_revision(); });
+        }
+        return std::nullopt;
     }
 
-    static int curl_debug_callback(CURL *handle, curl_infotype type, char *data, size_t size, void *userptr) {
-        switch (type) {
-            case CURLINFO_TEXT:
-                std::cerr << "== Info: " << std::string(data, size);
-                break;
-            case CURLINFO_HEADER_OUT:
-                std::cerr << "=> Send header: " << std::string(data, size);
-                break;
-            case CURLINFO_DATA_OUT:
-                std::cerr << "=> Send data: " << std::string(data, size);
-                break;
-            case CURLINFO_SSL_DATA_OUT:
-                std::cerr << "=> Send SSL data: " << std::string(data, size);
-                break;
-            case CURLINFO_HEADER_IN:
-                std::cerr << "<= Recv header: " << std::string(data, size);
-                break;
-            case CURLINFO_DATA_IN:
-                std::cerr << "<= Recv data: " << std::string(data, size);
-                break;
-            case CURLINFO_SSL_DATA_IN:
-                std::cerr << "<= Recv SSL data: " << std::string(data, size);
-                break;
-            default:
-                break;
+    template<typename T>
+    void remember(const std::string &path, const T &result) {
+        if constexpr (std::derived_from<T, Response>) {
+            if (ResponseCache::cacheable(path) && result.http_status == 200) cache.store(path, result, result.revision);
         }
-        return 0;
     }
 
     template<typename T>
-    static T request(const std::string &method, const std::string &path, const nlohmann::json &data = {}) {
-        if (!FortiAuth::PROGRAM_IS_RUNNING) FortiAuth::PROGRAM_IS_RUNNING = true;
-
-        CURL *curl;
-        CURLcode res;
-        std::string readBuffer;
-
-        curl = curl_easy_init();
-        if (curl) {
-            std::string url = BASE_API_ENDPOINT() + path;
-
-            struct curl_slist *headers = nullptr;
-            headers = curl_slist_append(headers, "Content-Type: application/json");
-            headers = curl_slist_append(headers, FortiAuth::get_auth_header().c_str());
-
-            curl_easy_setopt(curl, CURLOPT_SSL_SESSIONID_CACHE, 1L);
-            curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, 0L);
-            curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 0L);
-            curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, -1);
-            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-            curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
-            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 1L);
-            curl_easy_setopt(curl, CURLOPT_SSLCERTTYPE, "P12");  // Explicitly set certificate type to P12
-            curl_easy_setopt(curl, CURLOPT_CAINFO, FortiAuth::get_ca_cert_path().c_str());
-            curl_easy_setopt(curl, CURLOPT_SSLCERT, FortiAuth::get_ssl_cert_path().c_str());
-            curl_easy_setopt(curl, CURLOPT_KEYPASSWD, FortiAuth::get_cert_password().c_str());
-
-            std::string json_payload = convert_keys_to_hyphens(data).dump();  // do not simplify by deleting this
-            if (method == "POST" || method == "PUT")
-                curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_payload.c_str());
-
-            if (method != "POST" && method != "GET")
-                curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method.c_str());
-
-#ifdef ENABLE_DEBUG
-            curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
-            curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, curl_debug_callback);
-            curl_easy_setopt(curl, CURLOPT_DEBUGDATA, nullptr);
-#endif
-
-            res = curl_easy_perform(curl);
-            if (res != CURLE_OK) std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << std::endl;
-            curl_easy_cleanup(curl);
+    std::optional<T> restore(const std::string &path) {
+        if constexpr (Snapshottable<T>) return snapshots.load<T>(path, [this] { return probe_device(); });
+        else return std::nullopt;
+    }
+
+    template<typename T>
+    void keep(const std::string &path, const T &result, std::string_view body) {
+        if constexpr (Snapshottable<T>) snapshots.save(path, result, body);
+    }
+
+public:
+    // Bounds every transfer started on this thread while it's alive, so an operation made of many
+    // requests can be given one overall timeout. Nested deadlines restore the outer one on exit.
+    class Deadline {
+        std::optional<Clock::time_point> previous;
+
+    public:
+        explicit Deadline(Clock::duration timeout) : Deadline(Clock::now() + timeout) {}
+        explicit Deadline(Clock::time_point until) : previous(std::exchange(deadline, until)) {}
+        Deadline(const Deadline&) = delete;
+        Deadline& operator=(const Deadline&) = delete;
+        ~Deadline() { deadline = previous; }
+    };
+
+    // This thread's deadline, for handing it on to work started elsewhere on the caller's behalf.
+    static std::optional<Clock::time_point> current_deadline() { return deadline; }
+
+    // Transfers started on this thread while it's alive are abandoned once flag is set, failing with
+    // CURLE_ABORTED_BY_CALLBACK; aborted transfers aren't retried.
+    class Cancellation {
+        std::shared_ptr<const std::atomic<bool>> previous;
+
+    public:
+        explicit Cancellation(std::shared_ptr<const std::atomic<bool>> flag) :
+                previous(std::exchange(cancelled, std::move(flag))) {}
+        Cancellation(const Cancellation&) = delete;
+        Cancellation& operator=(const Cancellation&) = delete;
+        ~Cancellation() { cancelled = std::move(previous); }
+    };
+
+    // Without a transport the device is reached over HTTPS with CurlTransport.
+    explicit FortiClient(DeviceConfig device, std::shared_ptr<Transport> transport = nullptr) :
+            config(std::move(device)),
+            transport(transport ? std::move(transport) : std::make_shared<CurlTransport>(config)),
+            metrics_label(std::format("{}:{}", config.gateway_ip, config.admin_https_port)) {}
+
+    FortiClient(const FortiClient&) = delete;
+    FortiClient& operator=(const FortiClient&) = delete;
+
+    static std::shared_ptr<FortiClient> create(DeviceConfig device, std::shared_ptr<Transport> transport = nullptr) {
+        return std::make_shared<FortiClient>(std::move(device), std::move(transport));
+    }
+
+    [[nodiscard]] const DeviceConfig& get_config() const { return config; }
+    [[nodiscard]] const std::shared_ptr<Transport>& get_transport() const { return transport; }
+
+    // Served from the response cache, then from the on-disk snapshots, before going to the device.
+    template<typename T>
+    T get(const std::string &path) {
+        if (auto hit = cached<T>(path)) return std::move(*hit);
+        if (auto restored = restore<T>(path)) {
+            remember(path, *restored);
+            return std::move(*restored);
         }
 
-        return convert_keys_to_underscores(nlohmann::json::parse(readBuffer));
+        std::string body;
+        bool snapshot = Snapshottable<T> && snapshots.wants(path);
+        T result = request<T>("GET", path, {}, {}, snapshot ? &body : nullptr);
+        remember(path, result);
+        if (snapshot) keep(path, result, body);
+        return result;
     }
 
-    static Response validate(const std::string &method, const std::string &path, const nlohmann::json &data = {}) {
+    Response post(const std::string &path, const nlohmann::json &data) { return validate("POST", path, data); }
+    Response put(const std::string &path, const nlohmann::json &data) { return validate("PUT", path, data); }
+    Response del(const std::string &path) { return validate("DELETE", path); }
+
+    // Sends the mutation without checking for the object first; a missing or duplicate entry comes back
+    // as a MutationStatus instead of being printed.
+    MutationResult mutate(const std::string &method, const std::string &path, const nlohmann::json &data = {}) {
         auto response = request<Response>(method, path, data);
+        return {classify_mutation(response), std::move(response)};
+    }
+
+    // Asks for key_field alone, so checking an object's existence doesn't download the object.
+    bool exists(const std::string &path, std::string_view key_field = "name") {
+        auto separator = path.find('?') == std::string::npos ? '?' : '&';
+        return request<Response>("GET", std::format("{}{}format={}", path, separator, key_field)).http_status == 200;
+    }
+
+    // Streams the body with chunked transfer encoding instead of building it in memory first.
+    Response post_stream(const std::string &path, BodySource source) {
+        auto response = request<Response>("POST", path, {}, std::move(source));
         if (response.status != "success") std::cerr << nlohmann::json(response).dump(4) << std::endl;
         return response;
     }
 
+    // Runs every request concurrently over one Transport::Multi, at most max_concurrency in flight and
+    // never more than the adaptive limit allows. Retryable failures are queued again after their backoff.
+    // Results are returned in request order; failures are reported per item instead of thrown.
+    template<typename T = Response>
+    std::vector<Result<T>> batch(const std::vector<BatchRequest> &requests, unsigned int max_concurrency = 0) {
+        if (max_concurrency == 0) max_concurrency = batch_concurrency.load(std::memory_order_relaxed);
+        auto policy = retry_policy();
+
+        std::vector<Result<T>> results(requests.size());
+        std::vector<Attempt> attempts(requests.size());
+        std::vector<HeldSlot> slots(requests.size());  // freed if the batch unwinds with requests in flight
+
+        struct Queued {
+            std::size_t index;
+            unsigned int attempt;
+            Clock::time_point ready;
+        };
+
+        // GETs the cache can answer never reach the wire
+        std::deque<Queued> queue;
+        for (std::size_t i = 0; i < requests.size(); ++i) {
+            if (requests[i].method == "GET") {
+                if (auto hit = cached<T>(requests[i].path)) {
+                    results[i] = std::move(*hit);
+                    continue;
+                }
+            }
+            queue.push_back({i, 1, {}});
+        }
+        if (queue.empty()) return results;
+
+        auto multi = transport->multi(max_concurrency);
+        std::size_t active = 0;
+        auto next_ready = [&queue] { return std::ranges::min(queue, {}, &Queued::ready).ready; };
+
+        // Starts whatever is due while slots are free. With nothing in flight the first slot is waited
+        // for, since it can only be freed by another thread; false means the deadline passed meanwhile.
+        auto start_ready = [&](bool wait) {
+            auto now = Clock::now();
+            while (active < max_concurrency) {
+                auto it = std::ranges::find_if(queue, [now](const Queued &item) { return item.ready <= now; });
+                if (it == queue.end()) break;
+                bool blocking = wait && active == 0;
+                if (!(blocking ? limiter.acquire(deadline) : limiter.try_acquire())) return !blocking;
+                slots[it->index] = HeldSlot(limiter);
+
+                const auto &request = requests[it->index];
+                attempts[it->index] = {request.method, request.path, it->attempt};
+                multi->add(it->index, make_request(request.method, request.path, request.data));
+                queue.erase(it);
+                ++active;
+            }
+            return true;
+        };
+
+        start_ready(false);
+
+        while (active > 0 || !queue.empty()) {
+            if (active == 0) {
+                std::this_thread::sleep_until(next_ready());
+                if (!start_ready(true)) {
+                    for (const auto &item : queue)
+                        results[item.index] = std::unexpected(RequestError{0, "timed out waiting for a request slot"});
+                    break;
+                }
+            }
+
+            // wake up for the next retry that comes due, or soon if slots are only held elsewhere
+            auto wait = queue.empty() ? std::chrono::milliseconds(1000) :
+                        std::clamp(std::chrono::duration_cast<std::chrono::milliseconds>(next_ready() - Clock::now()),
+                                   std::chrono::milliseconds(50), std::chrono::milliseconds(1000));
+
+            for (auto &[index, response] : multi->poll(wait)) {
+                --active;
+                const auto &attempt = attempts[index];
+                slots[index].dismiss();
+
+                std::optional<std::chrono::milliseconds> delay;
+                if (settle(attempt, response) == RequestOutcome::RETRYABLE) delay = retry_delay(attempt, response, policy);
+                if (delay) {
+                    limiter.record_retry();
+                    queue.push_back({index, attempt.number + 1, Clock::now() + *delay});
+                } else {
+                    auto &result = results[index] = finish<T>(attempt.method, attempt.path, response);
+                    if (attempt.method != "GET") invalidate(attempt.path);
+                    else if (result) remember(attempt.path, *result);
+                }
+            }
+
+            start_ready(false);
+        }
+
+        return results;
+    }
+
+    // Batch of mutations, reporting every item that didn't succeed the same way validate() does.
+    std::vector<Result<Response>> batch_mutate(const std::vector<BatchRequest> &requests) {
+        auto results = batch<Response>(requests);
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            if (!results[i]) std::cerr << std::format("{} {} failed: {}", requests[i].method, requests[i].path,
+                                                      results[i].error().message) << std::endl;
+            else if (results[i]->status != "success") std::cerr << nlohmann::json(*results[i]).dump(4) << std::endl;
+        }
+        return results;
+    }
+
+    void set_batch_concurrency(unsigned int max_concurrency) { batch_concurrency = std::max(1u, max_concurrency); }
+
+    [[nodiscard]] RetryPolicy retry_policy() const {
+        std::lock_guard lock(retry_mutex);
+        return retry;
+    }
+
+    void set_retry_policy(const RetryPolicy &policy) {
+        std::lock_guard lock(retry_mutex);
+        retry = policy;
+        retry.max_attempts = std::max(1u, retry.max_attempts);
+    }
+
+    // Resets the adaptive limit to options.initial; requests already in flight keep their slots.
+    void configure_limiter(const LimiterOptions &options) { limiter.configure(options); }
+    SchedulerStats scheduler_stats() const { return limiter.stats(); }
+
+    ConnectionStats connection_stats() const { return transport->connection_stats(); }
+    void reset_connection_stats() { transport->reset_connection_stats(); }
+
+    // Opt-in: cached CMDB reads are served locally for max_age, then revalidated against the config revision.
+    void enable_cache(std::chrono::milliseconds max_age = std::chrono::seconds(5)) { cache.enable(max_age); }
+    void disable_cache() { cache.disable(); }
+    void clear_cache() { cache.clear(); }
+    void invalidate_cache(const std::string &path) { cache.invalidate(path); }
+    CacheStats cache_stats() const { return cache.stats(); }
+    void reset_cache_stats() { cache.reset_stats(); }
+
+    // Opt-in: GET results are kept under directory/<device> and reused across runs while the device's
+    // serial and config revision still match, see SnapshotStore.
+    void enable_snapshots(const std::filesystem::path &directory, SnapshotOptions options = {}) {
+        auto device = metrics_label;
+        std::ranges::replace(device, ':', '_');
+        snapshots.enable(directory / device, std::move(options));
+    }
+    void disable_snapshots() { snapshots.disable(); }
+    void clear_snapshots() { snapshots.clear(); }
+    SnapshotStats snapshot_stats() const { return snapshots.stats(); }
+    void reset_snapshot_stats() { snapshots.reset_stats(); }
+};
+
+
+// Static facade over a default FortiClient built from FortiAuth. The client is rebuilt whenever the
+// FortiAuth settings change; the transport, batch concurrency, retry, limiter, cache and snapshot
+// settings made here carry over to it. A Scope points the facade (and so DNSFilter, ThreatFeed, ...)
+// at another client for the current thread.
+class FortiAPI {
+    inline static std::mutex client_mutex;
+    inline static std::shared_ptr<FortiClient> default_client;
+    inline static unsigned long client_generation = 0;
+    inline static unsigned int batch_concurrency = 8;
+    inline static std::optional<std::chrono::milliseconds> cache_max_age;
+    inline static std::optional<std::pair<std::filesystem::path, SnapshotOptions>> snapshot_settings;
+    inline static RetryPolicy retry_policy;
+    inline static std::optional<LimiterOptions> limiter_options;
+    inline static std::shared_ptr<Transport> transport;
+    inline static thread_local std::shared_ptr<FortiClient> scoped_client;
+
 public:
+    class Scope {
+        std::shared_ptr<FortiClient> previous;
+
+    public:
+        explicit Scope(std::shared_ptr<FortiClient> client) : previous(std::exchange(scoped_client, std::move(client))) {}
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        ~Scope() { scoped_client = std::move(previous); }
+    };
+
+    static std::shared_ptr<FortiClient> client() {
+        if (scoped_client) return scoped_client;
+        auto generation = FortiAuth::get_generation();
+        std::lock_guard lock(client_mutex);
+        if (!default_client || client_generation != generation) {
+            default_client = FortiClient::create(FortiAuth::get_config(), transport);
+            default_client->set_batch_concurrency(batch_concurrency);
+            default_client->set_retry_policy(retry_policy);
+            if (limiter_options) default_client->configure_limiter(*limiter_options);
+            if (cache_max_age) default_client->enable_cache(*cache_max_age);
+            if (snapshot_settings) default_client->enable_snapshots(snapshot_settings->first, snapshot_settings->second);
+            client_generation = generation;
+        }
+        return default_client;
+    }
+
     template<typename T>
-    static T get(const std::string &path) { return request<T>("GET", path); }
+    static T get(const std::string &path) { return client()->get<T>(path); }
+
+    static Response post(const std::string &path, const nlohmann::json &data) { return client()->post(path, data); }
+    static Response put(const std::string &path, const nlohmann::json &data) { return client()->put(path, data); }
+    static Response del(const std::string &path) { return client()->del(path); }
+
+    static Response post_stream(const std::string &path, BodySource source) {
+        return client()->post_stream(path, std::move(source));
+    }
+
+    static MutationResult mutate(const std::string &method, const std::string &path, const nlohmann::json &data = {}) {
+        return client()->mutate(method, path, data);
+    }
+
+    static bool exists(const std::string &path, std::string_view key_field = "name") {
+        return client()->exists(path, key_field);
+    }
+
+    template<typename T = Response>
+    static std::vector<Result<T>> batch(const std::vector<BatchRequest> &requests, unsigned int max_concurrency = 0) {
+        return client()->batch<T>(requests, max_concurrency);
+    }
+
+    static std::vector<Result<Response>> batch_mutate(const std::vector<BatchRequest> &requests) {
+        return client()->batch_mutate(requests);
+    }
+
+    // Routes the default client through next (a recorder, a replayer, ...) from its next call on;
+    // nullptr goes back to CurlTransport.
+    static void set_transport(std::shared_ptr<Transport> next) {
+        std::lock_guard lock(client_mutex);
+        transport = std::move(next);
+        default_client.reset();
+    }
+
+    static void set_batch_concurrency(unsigned int max_concurrency) {
+        std::lock_guard lock(client_mutex);
+        batch_concurrency = std::max(1u, max_concurrency);
+        if (default_client) default_client->set_batch_concurrency(batch_concurrency);
+    }
+
+    static void set_retry_policy(const RetryPolicy &policy) {
+        std::lock_guard lock(client_mutex);
+        retry_policy = policy;
+        if (default_client) default_client->set_retry_policy(policy);
+    }
+
+    static void configure_limiter(const LimiterOptions &options) {
+        std::lock_guard lock(client_mutex);
+        limiter_options = options;
+        if (default_client) default_client->configure_limiter(options);
+    }
+
+    static SchedulerStats scheduler_stats() { return client()->scheduler_stats(); }
+
+    // Per-request metrics of every client in the process, see RequestMetrics.
+    static std::vector<SeriesSnapshot> metrics() { return RequestMetrics::snapshot(); }
+    static std::string openmetrics() { return RequestMetrics::openmetrics(); }
+
+    static ConnectionStats connection_stats() { return client()->connection_stats(); }
+    static void reset_connection_stats() { client()->reset_connection_stats(); }
+
+    static void enable_cache(std::chrono::milliseconds max_age = std::chrono::seconds(5)) {
+        std::lock_guard lock(client_mutex);
+        cache_max_age = max_age;
+        if (default_client) default_client->enable_cache(max_age);
+    }
+
+    static void disable_cache() {
+        std::lock_guard lock(client_mutex);
+        cache_max_age.reset();
+        if (default_client) default_client->disable_cache();
+    }
+
+    static void enable_snapshots(const std::filesystem::path &directory, const SnapshotOptions &options = {}) {
+        std::lock_guard lock(client_mutex);
+        snapshot_settings.emplace(directory, options);
+        if (default_client) default_client->enable_snapshots(directory, options);
+    }
+
+    static void disable_snapshots() {
+        std::lock_guard lock(client_mutex);
+        snapshot_settings.reset();
+        if (default_client) default_client->disable_snapshots();
+    }
+
+    static void clear_snapshots() { client()->clear_snapshots(); }
+    static SnapshotStats snapshot_stats() { return client()->snapshot_stats(); }
 
-    static Response post(const std::string &path, const nlohmann::json &data) { return validate("POST", path, data); }
-    static Response put(const std::string &path, const nlohmann::json &data) { return validate("PUT", path, data); }
-    static Response del(const std::string &path) { return validate("DELETE", path); }
+    static void clear_cache() { client()->clear_cache(); }
+    static void invalidate_cache(const std::string &path) { client()->invalidate_cache(path); }
+    static CacheStats cache_stats() { return client()->cache_stats(); }
+    static void reset_cache_stats() { client()->reset_cache_stats(); }
 };
 
 #endif //FORTI_API_API_HPP
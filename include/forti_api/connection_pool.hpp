@@ -0,0 +1,141 @@
+#ifndef FORTI_API_CONNECTION_POOL_HPP
+#define FORTI_API_CONNECTION_POOL_HPP
+
+#include <curl/curl.h>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <stdexcept>
+
+
+struct ConnectionStats {
+    unsigned long requests{}, connections_opened{}, connections_reused{}, tls_handshakes{};
+};
+
+// Long-lived easy handles checked out per request. All handles are attached to one share
+// handle so the connection cache, TLS session ids and DNS results survive between calls.
+class ConnectionPool {
+    std::mutex mutex;
+    std::vector<CURL*> idle;
+    std::size_t max_idle;
+    CURLSH* share = nullptr;
+    std::array<std::mutex, CURL_LOCK_DATA_LAST> share_locks;
+
+    std::atomic<unsigned long> requests{0}, connections_opened{0}, connections_reused{0}, tls_handshakes{0};
+
+    static void lock_callback(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+        static_cast<ConnectionPool*>(userptr)->share_locks[data].lock();
+    }
+
+    static void unlock_callback(CURL*, curl_lock_data data, void* userptr) {
+        static_cast<ConnectionPool*>(userptr)->share_locks[data].unlock();
+    }
+
+    static void global_init() {
+        static std::once_flag once;
+        std::call_once(once, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+    }
+
+    CURL* create() {
+        CURL* curl = curl_easy_init();
+        if (!curl) throw std::runtime_error("curl_easy_init() failed");
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+        return curl;
+    }
+
+    void release(CURL* curl) {
+        curl_easy_reset(curl);  // drops per-request options, keeps live connections and caches
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+
+        std::lock_guard lock(mutex);
+        if (idle.size() < max_idle) idle.push_back(curl);
+        else curl_easy_cleanup(curl);
+    }
+
+public:
+    class Handle {
+        ConnectionPool* pool;
+        CURL* curl;
+
+    public:
+        Handle(ConnectionPool* pool, CURL* curl) : pool(pool), curl(curl) {}
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+        Handle(Handle&& other) noexcept : pool(other.pool), curl(std::exchange(other.curl, nullptr)) {}
+        ~Handle() { if (curl) pool->release(curl); }
+
+        [[nodiscard]] CURL* get() const { return curl; }
+    };
+
+    ConnectionPool() : ConnectionPool(16) {}
+
+    explicit ConnectionPool(std::size_t max_idle) : max_idle(max_idle) {
+        global_init();
+        share = curl_share_init();
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lock_callback);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlock_callback);
+        curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    }
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    ~ConnectionPool() {
+        clear();
+        curl_share_cleanup(share);
+    }
+
+    Handle acquire() {
+        {
+            std::lock_guard lock(mutex);
+            if (!idle.empty()) {
+                CURL* curl = idle.back();
+                idle.pop_back();
+                return {this, curl};
+            }
+        }
+        return {this, create()};
+    }
+
+    // Tally whether the finished transfer opened (and handshook) a new connection or reused one.
+    void record(CURL* curl) {
+        long new_connections = 0;
+        curl_off_t appconnect_time = 0;
+        curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &new_connections);
+        curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &appconnect_time);
+
+        requests.fetch_add(1, std::memory_order_relaxed);
+        if (new_connections > 0) {
+            connections_opened.fetch_add(new_connections, std::memory_order_relaxed);
+            if (appconnect_time > 0) tls_handshakes.fetch_add(new_connections, std::memory_order_relaxed);
+        } else connections_reused.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] ConnectionStats stats() const {
+        return {requests.load(std::memory_order_relaxed),
+                connections_opened.load(std::memory_order_relaxed),
+                connections_reused.load(std::memory_order_relaxed),
+                tls_handshakes.load(std::memory_order_relaxed)};
+    }
+
+    void reset_stats() {
+        requests = 0;
+        connections_opened = 0;
+        connections_reused = 0;
+        tls_handshakes = 0;
+    }
+
+    // Drops idle handles, e.g. after the certificates or gateway changed.
+    void clear() {
+        std::lock_guard lock(mutex);
+        for (auto* curl : idle) curl_easy_cleanup(curl);
+        idle.clear();
+    }
+};
+
+#endif //FORTI_API_CONNECTION_POOL_HPP
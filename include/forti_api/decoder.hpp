@@ -0,0 +1,314 @@
+#ifndef FORTI_API_DECODER_HPP
+#define FORTI_API_DECODER_HPP
+
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+
+// Streaming decode of API responses straight into the typed structs, without building a DOM first.
+// Types declared with FORTI_API_DEFINE_TYPE expose their field table to the decoder; anything else
+// (custom from_json, raw nlohmann::json members) is collected into a small DOM for that value only.
+
+// FortiOS spells cmdb keys with hyphens where our members use underscores. The wire name of every
+// member is computed at compile time; q_origin_key is the one key the device spells with underscores,
+// and it's read-only so it's never sent back.
+template<std::size_t N>
+struct WireName {
+    char key[N]{};
+    bool read_only = false;
+
+    consteval WireName(const char (&name)[N]) {
+        read_only = std::string_view(name) == "q_origin_key";
+        for (std::size_t i = 0; i < N; ++i) key[i] = name[i] == '_' && !read_only ? '-' : name[i];
+    }
+
+    [[nodiscard]] constexpr std::string_view view() const { return {key, N - 1}; }
+};
+
+template<WireName Name>
+struct Wire {
+    static constexpr std::string_view key = Name.view();
+    static constexpr bool written = !Name.read_only;
+};
+
+// Monitor endpoints answer with underscored keys, so the member name is accepted as well.
+inline nlohmann::json::const_iterator find_wire_key(const nlohmann::json& j, std::string_view key,
+                                                    std::string_view name) {
+    auto it = j.find(key);
+    if (it == j.end() && key != name) it = j.find(name);
+    return it;
+}
+
+using DecodeScalar = std::variant<std::nullptr_t, bool, std::int64_t, std::uint64_t, double, std::string*>;
+
+struct DecodeOps;
+
+struct DecodeTarget {
+    void* object = nullptr;
+    const DecodeOps* ops = nullptr;
+
+    explicit operator bool() const { return object != nullptr; }
+
+    template<typename T>
+    static DecodeTarget bind(T& value);
+};
+
+struct DecodeOps {
+    void (*scalar)(void*, DecodeScalar&) = nullptr;
+    DecodeTarget (*field)(void*, std::string_view) = nullptr;
+    DecodeTarget (*element)(void*) = nullptr;
+    void (*assign)(void*, nlohmann::json&&) = nullptr;
+};
+
+struct FieldBinding {
+    std::string_view wire, name;
+    DecodeTarget (*bind)(void*);
+};
+
+template<typename T>
+concept Decodable = requires { typename T::decode_type; } && std::is_same_v<typename T::decode_type, T>;
+
+template<typename T>
+struct DecodeTraits {
+    static void scalar(void* object, DecodeScalar& value) {
+        auto& target = *static_cast<T*>(object);
+        if constexpr (std::is_same_v<T, std::string>) {
+            std::visit([&target](auto& v) {
+                using V = std::decay_t<decltype(v)>;
+                if constexpr (std::is_same_v<V, std::string*>) target = std::move(*v);
+                else if constexpr (std::is_same_v<V, bool>) target = v ? "true" : "false";
+                else if constexpr (!std::is_same_v<V, std::nullptr_t>) target = std::to_string(v);
+            }, value);
+        } else {
+            std::visit([&target](auto& v) {
+                using V = std::decay_t<decltype(v)>;
+                if constexpr (!std::is_same_v<V, std::string*> && !std::is_same_v<V, std::nullptr_t>)
+                    target = static_cast<T>(v);
+            }, value);
+        }
+    }
+
+    static DecodeTarget field(void* object, std::string_view key) {
+        for (const auto& binding : T::decode_fields())
+            if (key == binding.wire || key == binding.name) return binding.bind(object);
+        return {};
+    }
+
+    static void assign(void* object, nlohmann::json&& j) {
+        if constexpr (std::is_same_v<T, nlohmann::json>) *static_cast<T*>(object) = std::move(j);
+        else j.get_to(*static_cast<T*>(object));
+    }
+
+    static constexpr DecodeOps make() {
+        DecodeOps ops;
+        if constexpr (std::is_arithmetic_v<T> || std::is_same_v<T, std::string>) ops.scalar = scalar;
+        else if constexpr (Decodable<T>) ops.field = field;
+        else ops.assign = assign;
+        return ops;
+    }
+
+    static constexpr DecodeOps ops = make();
+};
+
+template<typename E>
+struct DecodeTraits<std::vector<E>> {
+    static DecodeTarget element(void* object) {
+        return DecodeTarget::bind(static_cast<std::vector<E>*>(object)->emplace_back());
+    }
+
+    static constexpr DecodeOps ops = [] { DecodeOps o; o.element = element; return o; }();
+};
+
+template<typename T>
+DecodeTarget DecodeTarget::bind(T& value) { return {&value, &DecodeTraits<T>::ops}; }
+
+
+class SaxDecoder {
+    std::vector<DecodeTarget> stack;
+    DecodeTarget root, pending;
+    bool root_consumed = false;
+    std::size_t skip_depth = 0;
+
+    // DOM fallback for values whose type has no field table
+    DecodeTarget dom_target;
+    nlohmann::json dom_root;
+    std::vector<nlohmann::json*> dom_stack;
+    std::string dom_key;
+
+    DecodeTarget next_target() {
+        if (stack.empty()) {
+            if (root_consumed) return {};
+            root_consumed = true;
+            return root;
+        }
+        if (stack.back().ops->element) return stack.back().ops->element(stack.back().object);
+        return std::exchange(pending, {});
+    }
+
+    nlohmann::json* dom_insert(nlohmann::json&& value) {
+        if (dom_stack.empty()) {
+            dom_root = std::move(value);
+            return &dom_root;
+        }
+        auto* parent = dom_stack.back();
+        if (parent->is_array()) {
+            parent->push_back(std::move(value));
+            return &parent->back();
+        }
+        auto& slot = (*parent)[dom_key];
+        slot = std::move(value);
+        return &slot;
+    }
+
+    void dom_complete() {
+        dom_target.ops->assign(dom_target.object, std::move(dom_root));
+        dom_target = {};
+        dom_root = nullptr;
+    }
+
+    static nlohmann::json to_json(DecodeScalar& scalar) {
+        return std::visit([](auto& v) -> nlohmann::json {
+            if constexpr (std::is_same_v<std::decay_t<decltype(v)>, std::string*>) return std::move(*v);
+            else return v;
+        }, scalar);
+    }
+
+    bool value(DecodeScalar scalar) {
+        if (skip_depth) return true;
+        if (dom_target) {
+            dom_insert(to_json(scalar));
+            return true;
+        }
+
+        auto target = next_target();
+        if (!target) return true;
+        if (target.ops->scalar) target.ops->scalar(target.object, scalar);
+        else if (target.ops->assign) target.ops->assign(target.object, to_json(scalar));
+        return true;
+    }
+
+    bool start(nlohmann::json&& container, bool is_array) {
+        if (skip_depth) {
+            ++skip_depth;
+            return true;
+        }
+        if (dom_target) {
+            dom_stack.push_back(dom_insert(std::move(container)));
+            return true;
+        }
+
+        auto target = next_target();
+        if (target && target.ops->assign) {
+            dom_target = target;
+            dom_stack.push_back(dom_insert(std::move(container)));
+        } else if (target && (is_array ? target.ops->element != nullptr : target.ops->field != nullptr)) {
+            stack.push_back(target);
+        } else skip_depth = 1;
+        return true;
+    }
+
+    bool end() {
+        if (skip_depth) {
+            --skip_depth;
+            return true;
+        }
+        if (dom_target) {
+            dom_stack.pop_back();
+            if (dom_stack.empty()) dom_complete();
+            return true;
+        }
+        stack.pop_back();
+        return true;
+    }
+
+public:
+    using json = nlohmann::json;
+
+    explicit SaxDecoder(DecodeTarget root) : root(root) {}
+
+    bool null() { return value(nullptr); }
+    bool boolean(bool v) { return value(v); }
+    bool number_integer(json::number_integer_t v) { return value(static_cast<std::int64_t>(v)); }
+    bool number_unsigned(json::number_unsigned_t v) { return value(static_cast<std::uint64_t>(v)); }
+    bool number_float(json::number_float_t v, const json::string_t&) { return value(v); }
+    bool string(json::string_t& v) { return value(&v); }
+    bool binary(json::binary_t&) { return value(nullptr); }
+
+    bool start_object(std::size_t) { return start(json::object(), false); }
+    bool start_array(std::size_t) { return start(json::array(), true); }
+    bool end_object() { return end(); }
+    bool end_array() { return end(); }
+
+    bool key(json::string_t& k) {
+        if (skip_depth) return true;
+        if (dom_target) dom_key = std::move(k);
+        else pending = stack.back().ops->field(stack.back().object, k);
+        return true;
+    }
+
+    // Rethrows ex as its concrete type, so callers catching json::parse_error (or the others) still match.
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) {
+        if (auto* e = dynamic_cast<const json::parse_error*>(&ex)) throw *e;
+        if (auto* e = dynamic_cast<const json::out_of_range*>(&ex)) throw *e;
+        if (auto* e = dynamic_cast<const json::type_error*>(&ex)) throw *e;
+        if (auto* e = dynamic_cast<const json::invalid_iterator*>(&ex)) throw *e;
+        if (auto* e = dynamic_cast<const json::other_error*>(&ex)) throw *e;
+        return false;
+    }
+
+    template<typename T>
+    static T decode(std::string_view buffer) {
+        T result{};
+        SaxDecoder handler(DecodeTarget::bind(result));
+        nlohmann::json::sax_parse(buffer, &handler);
+        return result;
+    }
+
+    // Same, from the MessagePack encoding of a response (see SnapshotStore).
+    template<typename T>
+    static T decode_msgpack(std::span<const std::uint8_t> buffer) {
+        T result{};
+        SaxDecoder handler(DecodeTarget::bind(result));
+        nlohmann::json::sax_parse(buffer.begin(), buffer.end(), &handler, nlohmann::json::input_format_t::msgpack);
+        return result;
+    }
+};
+
+
+#define FORTI_API_TO_WIRE(field) \
+    if constexpr (Wire<#field>::written) forti_api_j[Wire<#field>::key] = forti_api_t.field;
+
+#define FORTI_API_FROM_WIRE(field) \
+    if (auto it = find_wire_key(forti_api_j, Wire<#field>::key, #field); it != forti_api_j.end()) \
+        it->get_to(forti_api_t.field); \
+    else forti_api_t.field = forti_api_default_obj.field;
+
+#define FORTI_API_DECODE_FIELD(field) \
+    FieldBinding{Wire<#field>::key, #field, \
+                 [](void* object) { return DecodeTarget::bind(static_cast<Self*>(object)->field); }},
+
+// Replaces NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT: (de)serializes straight to wire names and
+// registers the fields with SaxDecoder.
+#define FORTI_API_DEFINE_TYPE(Type, ...) \
+    friend void to_json(nlohmann::json& forti_api_j, const Type& forti_api_t) { \
+        NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(FORTI_API_TO_WIRE, __VA_ARGS__)) \
+    } \
+    friend void from_json(const nlohmann::json& forti_api_j, Type& forti_api_t) { \
+        Type forti_api_default_obj; \
+        NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(FORTI_API_FROM_WIRE, __VA_ARGS__)) \
+    } \
+    using decode_type = Type; \
+    static std::span<const FieldBinding> decode_fields() { \
+        using Self = Type; \
+        static const FieldBinding fields[] = { NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(FORTI_API_DECODE_FIELD, __VA_ARGS__)) }; \
+        return fields; \
+    }
+
+#endif //FORTI_API_DECODER_HPP
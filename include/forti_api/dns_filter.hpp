@@ -5,7 +5,13 @@
 #ifndef FORTI_API_DNS_FILTER_HPP
 #define FORTI_API_DNS_FILTER_HPP
 
+#include <bit>
+#include <cstdint>
 #include <utility>
+#include <functional>
+#include <initializer_list>
+#include <unordered_map>
+#include <unordered_set>
 #include "api.hpp"
 
 
@@ -17,7 +23,20 @@ struct Filter {
     explicit Filter(unsigned int category, std::string  action = "allow") :
             category(category), action(std::move(action)) {}
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(Filter, id, q_origin_key, category, action, log)
+    friend bool operator==(const Filter&, const Filter&) = default;
+
+    FORTI_API_DEFINE_TYPE(Filter, id, q_origin_key, category, action, log)
+};
+
+enum class CategoryAction {
+    ALLOW,
+    BLOCK,
+    MONITOR,
+};
+
+struct CategoryChange {
+    unsigned int category{};
+    CategoryAction action = CategoryAction::ALLOW;
 };
 
 struct CompareFilters {
@@ -26,11 +45,296 @@ struct CompareFilters {
     bool operator()(unsigned int category, const Filter& b) const { return category < b.category; }
 };
 
+// Set of category ids as a dense bitmap. FortiGuard ids are small, so a whole set is a few words and
+// set operations are a handful of word-wise ands and ors. Trailing zero words are never kept.
+class CategoryBitmap {
+    std::vector<std::uint64_t> words;
+
+    void trim() { while (!words.empty() && !words.back()) words.pop_back(); }
+
+public:
+    CategoryBitmap() = default;
+    CategoryBitmap(std::initializer_list<unsigned int> categories) { for (auto category : categories) set(category); }
+
+    [[nodiscard]] bool test(unsigned int category) const {
+        auto word = category / 64;
+        return word < words.size() && (words[word] >> (category % 64) & 1);
+    }
+
+    // Both return whether the bit changed.
+    bool set(unsigned int category) {
+        auto word = category / 64;
+        if (word >= words.size()) words.resize(word + 1);
+        auto mask = std::uint64_t{1} << (category % 64);
+        if (words[word] & mask) return false;
+        words[word] |= mask;
+        return true;
+    }
+
+    bool reset(unsigned int category) {
+        if (!test(category)) return false;
+        words[category / 64] &= ~(std::uint64_t{1} << (category % 64));
+        trim();
+        return true;
+    }
+
+    [[nodiscard]] bool empty() const { return words.empty(); }
+    void clear() { words.clear(); }
+
+    [[nodiscard]] std::size_t count() const {
+        std::size_t total = 0;
+        for (auto word : words) total += static_cast<std::size_t>(std::popcount(word));
+        return total;
+    }
+
+    // Calls f with every category in ascending order.
+    template<typename F>
+    void for_each(F&& f) const {
+        for (std::size_t i = 0; i < words.size(); ++i)
+            for (auto bits = words[i]; bits; bits &= bits - 1)
+                f(static_cast<unsigned int>(i * 64 + static_cast<std::size_t>(std::countr_zero(bits))));
+    }
+
+    CategoryBitmap& operator|=(const CategoryBitmap& other) {
+        if (other.words.size() > words.size()) words.resize(other.words.size());
+        for (std::size_t i = 0; i < other.words.size(); ++i) words[i] |= other.words[i];
+        return *this;
+    }
+
+    CategoryBitmap& operator&=(const CategoryBitmap& other) {
+        words.resize(std::min(words.size(), other.words.size()));
+        for (std::size_t i = 0; i < words.size(); ++i) words[i] &= other.words[i];
+        trim();
+        return *this;
+    }
+
+    CategoryBitmap& operator-=(const CategoryBitmap& other) {
+        for (std::size_t i = 0; i < std::min(words.size(), other.words.size()); ++i) words[i] &= ~other.words[i];
+        trim();
+        return *this;
+    }
+
+    friend CategoryBitmap operator|(CategoryBitmap a, const CategoryBitmap& b) { return a |= b; }
+    friend CategoryBitmap operator&(CategoryBitmap a, const CategoryBitmap& b) { return a &= b; }
+    friend CategoryBitmap operator-(CategoryBitmap a, const CategoryBitmap& b) { return a -= b; }
+    friend bool operator==(const CategoryBitmap&, const CategoryBitmap&) = default;
+};
+
+// Dense form of a filter list: which categories are listed and which of them block or monitor, as
+// bitmaps. Every entry the device sends carries an id and q_origin_key, so those sit in an array indexed
+// by category next to the bitmaps; the log setting and unknown actions rarely differ from the defaults
+// and live in a side table holding only those entries. Queries are O(1), and filters() gives back the
+// same list the device sent, sorted by category.
+class CategoryFilter {
+public:
+    struct Attributes {
+        unsigned int id = 0, q_origin_key = 0;
+        std::string log = "enable", action;  // action is only kept when it isn't allow, block or monitor
+
+        friend bool operator==(const Attributes&, const Attributes&) = default;
+    };
+
+private:
+    struct Keys {
+        unsigned int id = 0, q_origin_key = 0;
+
+        friend bool operator==(const Keys&, const Keys&) = default;
+    };
+
+    struct Extra {
+        std::string log = "enable", action;
+
+        [[nodiscard]] bool is_default() const { return log == "enable" && action.empty(); }
+
+        friend bool operator==(const Extra&, const Extra&) = default;
+    };
+
+    CategoryBitmap listed, blocked, monitored;
+    std::vector<Keys> keys;  // by category, without trailing empty entries
+    std::unordered_map<unsigned int, Extra> extras;
+
+    [[nodiscard]] Keys keys_of(unsigned int category) const {
+        return category < keys.size() ? keys[category] : Keys{};
+    }
+
+    void set_keys(unsigned int category, Keys value) {
+        if (category >= keys.size()) {
+            if (value == Keys{}) return;
+            keys.resize(std::size_t{category} + 1);
+        }
+        keys[category] = value;
+        while (!keys.empty() && keys.back() == Keys{}) keys.pop_back();
+    }
+
+    void set_attributes(unsigned int category, Attributes attributes) {
+        set_keys(category, {attributes.id, attributes.q_origin_key});
+        Extra extra{std::move(attributes.log), std::move(attributes.action)};
+        if (extra.is_default()) extras.erase(category);
+        else extras.insert_or_assign(category, std::move(extra));
+    }
+
+    void erase_attributes(unsigned int category) {
+        set_keys(category, {});
+        extras.erase(category);
+    }
+
+    // Returns whether a non-standard action was dropped.
+    bool clear_action(unsigned int category) {
+        auto it = extras.find(category);
+        if (it == extras.end() || it->second.action.empty()) return false;
+        it->second.action.clear();
+        if (it->second.is_default()) extras.erase(it);
+        return true;
+    }
+
+public:
+    CategoryFilter() = default;
+
+    explicit CategoryFilter(const std::vector<Filter>& filters) {
+        for (const auto& filter : filters) {
+            auto category = filter.category;
+            listed.set(category);
+            blocked.reset(category);
+            monitored.reset(category);
+            if (filter.action == "block") blocked.set(category);
+            else if (filter.action == "monitor") monitored.set(category);
+            bool standard = filter.action == "allow" || filter.action == "block" || filter.action == "monitor";
+            set_attributes(category, {filter.id, filter.q_origin_key, filter.log, standard ? "" : filter.action});
+        }
+    }
+
+    // Back to the wire format, sorted by category.
+    [[nodiscard]] std::vector<Filter> filters() const {
+        std::vector<Filter> result;
+        result.reserve(listed.count());
+        listed.for_each([&](unsigned int category) {
+            auto& filter = result.emplace_back(category, blocked.test(category)     ? "block"
+                                                         : monitored.test(category) ? "monitor"
+                                                                                    : "allow");
+            auto [id, q_origin_key] = keys_of(category);
+            filter.id = id;
+            filter.q_origin_key = q_origin_key;
+            if (auto it = extras.find(category); it != extras.end()) {
+                filter.log = it->second.log;
+                if (!it->second.action.empty()) filter.action = it->second.action;
+            }
+        });
+        return result;
+    }
+
+    [[nodiscard]] bool contains(unsigned int category) const { return listed.test(category); }
+
+    [[nodiscard]] CategoryAction action(unsigned int category) const {
+        if (blocked.test(category)) return CategoryAction::BLOCK;
+        if (monitored.test(category)) return CategoryAction::MONITOR;
+        return CategoryAction::ALLOW;
+    }
+
+    [[nodiscard]] Attributes attributes_of(unsigned int category) const {
+        auto [id, q_origin_key] = keys_of(category);
+        Attributes attributes;
+        attributes.id = id;
+        attributes.q_origin_key = q_origin_key;
+        if (auto it = extras.find(category); it != extras.end()) {
+            attributes.log = it->second.log;
+            attributes.action = it->second.action;
+        }
+        return attributes;
+    }
+
+    [[nodiscard]] const CategoryBitmap& categories() const { return listed; }
+    [[nodiscard]] const CategoryBitmap& blocked_categories() const { return blocked; }
+    [[nodiscard]] const CategoryBitmap& monitored_categories() const { return monitored; }
+    [[nodiscard]] std::size_t size() const { return listed.count(); }
+
+    // ALLOW drops the entry, like DNSFilterOptions::allow. Returns whether anything changed.
+    bool set(unsigned int category, CategoryAction action) {
+        if (action == CategoryAction::ALLOW) {
+            if (!listed.reset(category)) return false;
+            blocked.reset(category);
+            monitored.reset(category);
+            erase_attributes(category);
+            return true;
+        }
+        auto& on = action == CategoryAction::BLOCK ? blocked : monitored;
+        auto& off = action == CategoryAction::BLOCK ? monitored : blocked;
+        bool changed = listed.set(category);
+        changed = on.set(category) || changed;
+        changed = off.reset(category) || changed;
+        return clear_action(category) || changed;
+    }
+
+    bool apply(const CategoryChange& change) { return set(change.category, change.action); }
+
+    // Applies every change in order, returns whether the filter differs from before.
+    bool apply(const std::vector<CategoryChange>& changes) {
+        auto original = *this;
+        for (const auto& change : changes) apply(change);
+        return *this != original;
+    }
+
+    // Union: every category other blocks or monitors gets that action here, and its allow entries are
+    // dropped. Returns whether anything changed.
+    bool merge(const CategoryFilter& other) {
+        auto original = *this;
+        auto assigned = other.blocked | other.monitored;
+        auto cleared = other.listed - assigned;
+        cleared.for_each([&](unsigned int category) { erase_attributes(category); });
+        listed = (listed - cleared) | assigned;
+        blocked = (blocked - other.monitored - cleared) | other.blocked;
+        monitored = (monitored - other.blocked - cleared) | other.monitored;
+        assigned.for_each([&](unsigned int category) { clear_action(category); });
+        return *this != original;
+    }
+
+    // Difference: drops every listed category in categories. Returns whether anything changed.
+    bool remove(const CategoryBitmap& categories) {
+        auto removed = listed & categories;
+        if (removed.empty()) return false;
+        listed -= removed;
+        blocked -= removed;
+        monitored -= removed;
+        removed.for_each([&](unsigned int category) { erase_attributes(category); });
+        return true;
+    }
+
+    // The changes that give every category the action it has in target, ascending by category.
+    [[nodiscard]] std::vector<CategoryChange> diff(const CategoryFilter& target) const {
+        std::vector<CategoryChange> changes;
+        (listed | target.listed).for_each([&](unsigned int category) {
+            auto wanted = target.action(category);
+            if (action(category) != wanted || (contains(category) && !target.contains(category)))
+                changes.push_back({category, wanted});
+        });
+        return changes;
+    }
+
+    // Makes the listed categories and their actions exactly policy's. Categories that stay keep their id
+    // and log setting; new ones take policy's log setting. Returns whether anything changed.
+    bool conform_to(const CategoryFilter& policy) {
+        CategoryFilter next;
+        next.listed = policy.listed;
+        next.blocked = policy.blocked;
+        next.monitored = policy.monitored;
+        policy.listed.for_each([&](unsigned int category) {
+            auto wanted = policy.attributes_of(category);
+            auto extra = listed.test(category) ? attributes_of(category) : Attributes{0, 0, wanted.log, {}};
+            extra.action = std::move(wanted.action);
+            next.set_attributes(category, std::move(extra));
+        });
+        if (next == *this) return false;
+        *this = std::move(next);
+        return true;
+    }
+
+    friend bool operator==(const CategoryFilter&, const CategoryFilter&) = default;
+};
+
 struct DNSFilterOptions {
     std::string options;
     std::vector<Filter> filters;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(DNSFilterOptions, options, filters)
+    FORTI_API_DEFINE_TYPE(DNSFilterOptions, options, filters)
 
     std::pair<bool, unsigned int> find_category(unsigned int category) {
         auto it = std::lower_bound(filters.begin(), filters.end(), category, CompareFilters());
@@ -59,13 +363,45 @@ struct DNSFilterOptions {
         else filters.emplace(filters.begin() + index, category, "monitor");
     }
 
-    void sort_filters() { std::sort(filters.begin(), filters.end(), CompareFilters()); }
+    void apply(const CategoryChange& change) {
+        switch (change.action) {
+            case CategoryAction::ALLOW: allow(change.category); break;
+            case CategoryAction::BLOCK: block(change.category); break;
+            case CategoryAction::MONITOR: monitor(change.category); break;
+        }
+    }
+
+    [[nodiscard]] CategoryFilter categories() const { return CategoryFilter(filters); }
+    void set_categories(const CategoryFilter& categories) { filters = categories.filters(); }
+
+    // Applies every change in order, returns whether the filters differ from before. Works on the dense
+    // form, so a batch costs one pass over the list rather than a shift per insert.
+    bool apply(const std::vector<CategoryChange>& changes) {
+        auto original = categories(), updated = original;
+        for (const auto& change : changes) updated.apply(change);
+        if (updated == original) return false;
+        set_categories(updated);
+        return true;
+    }
+
+    // See CategoryFilter::conform_to.
+    bool conform_to(const CategoryFilter& policy) {
+        auto updated = categories();
+        if (!updated.conform_to(policy)) return false;
+        set_categories(updated);
+        return true;
+    }
+
+    void sort_filters() {
+        if (!std::is_sorted(filters.begin(), filters.end(), CompareFilters()))
+            std::sort(filters.begin(), filters.end(), CompareFilters());
+    }
 };
 
 struct DomainFilter {
     unsigned int domain_filter_table = 2;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(DomainFilter, domain_filter_table)
+    FORTI_API_DEFINE_TYPE(DomainFilter, domain_filter_table)
 };
 
 struct DNSProfile {
@@ -92,7 +428,7 @@ struct DNSProfile {
     void monitor_category(unsigned int category) { ftgd_dns.monitor(category); }
     bool contains_category(unsigned int category) { return ftgd_dns.contains(category); }
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(DNSProfile, name, q_origin_key, comment, sdns_ftgd_err_log,
+    FORTI_API_DEFINE_TYPE(DNSProfile, name, q_origin_key, comment, sdns_ftgd_err_log,
                                                 sdns_domain_log, block_action, redirect_portal, redirect_portal6,
                                                 block_botnet, safe_search, youtube_restrict, log_all_domain,
                                                 domain_filter, external_ip_blocklist, dns_translation, ftgd_dns)
@@ -102,7 +438,7 @@ struct DNSProfile {
 struct DNSFiltersResponse : public Response {
     std::vector<DNSFilterOptions> results;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(DNSFiltersResponse, http_method, size, matched_count, next_idx,
+    FORTI_API_DEFINE_TYPE(DNSFiltersResponse, http_method, size, matched_count, next_idx,
                                                 revision, vdom, path, name, status, http_status, serial, version,
                                                 build, results)
 };
@@ -110,31 +446,52 @@ struct DNSFiltersResponse : public Response {
 struct DNSProfilesResponse : public Response {
     std::vector<DNSProfile> results;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(DNSProfilesResponse, http_method, size, matched_count, next_idx,
+    FORTI_API_DEFINE_TYPE(DNSProfilesResponse, http_method, size, matched_count, next_idx,
                                                 revision, vdom, path, name, status, http_status, serial, version,
                                                 build, results)
 };
 
 
+using ProfileSelector = std::function<bool(const DNSProfile&)>;
+
 class DNSFilter {
     inline static std::string api_endpoint = "/cmdb/dnsfilter/profile";
 
 public:
+    static ProfileSelector select_profiles(const std::vector<std::string>& names) {
+        return [selected = std::unordered_set<std::string>(names.begin(), names.end())](const DNSProfile& profile) {
+            return selected.contains(profile.name);
+        };
+    }
+
+    // Optimistic mutations: sent without looking the profile up first, the outcome says whether it existed.
+    static MutationResult try_update(const DNSProfile& profile) {
+        return FortiAPI::mutate("PUT", std::format("{}/{}", api_endpoint, profile.name), profile);
+    }
+
+    static MutationResult try_add(const DNSProfile& profile) { return FortiAPI::mutate("POST", api_endpoint, profile); }
+
+    static MutationResult try_del(const std::string& name) {
+        return FortiAPI::mutate("DELETE", std::format("{}/{}", api_endpoint, name));
+    }
+
     static void update(const DNSProfile& profile) {
-        if (!contains(profile.name)) throw std::runtime_error("Can't update non-existent DNS Profile");
-        FortiAPI::put(std::format("{}/{}", api_endpoint, profile.name), profile);
+        auto result = try_update(profile);
+        if (result.status == MutationStatus::NOT_FOUND)
+            throw std::runtime_error("Can't update non-existent DNS Profile");
+        result.report();
     }
 
     static void add(const std::string& name) { FortiAPI::post(api_endpoint, DNSProfile(name)); }
 
     static void del(const std::string& name) {
-        if (!contains(name)) throw std::runtime_error("Can't delete non-existent item: " + name);
-        else FortiAPI::del(std::format("{}/{}", api_endpoint, name));
+        auto result = try_del(name);
+        if (result.status == MutationStatus::NOT_FOUND)
+            throw std::runtime_error("Can't delete non-existent item: " + name);
+        result.report();
     }
 
-    static bool contains(const std::string& name) {
-        return FortiAPI::get<DNSProfilesResponse>(std::format("{}/{}", api_endpoint, name)).http_status == 200;
-    }
+    static bool contains(const std::string& name) { return FortiAPI::exists(std::format("{}/{}", api_endpoint, name)); }
 
     static std::vector<DNSProfile> get() {
         auto results = FortiAPI::get<DNSProfilesResponse>(api_endpoint).results;
@@ -148,11 +505,30 @@ public:
         return result;
     }
 
-    static void global_allow_category(unsigned int category) {
+    // Fetches every profile once, edits the selected ones locally and only PUTs those the edit changed.
+    static std::vector<Result<Response>> update_profiles(const std::function<bool(DNSProfile&)>& edit,
+                                                         const ProfileSelector& selector = {}) {
+        std::vector<BatchRequest> updates;
         for (auto& profile : get()) {
-            profile.allow_category(category);
-            update(profile);
+            if (selector && !selector(profile)) continue;
+            if (edit(profile)) updates.push_back({"PUT", std::format("{}/{}", api_endpoint, profile.name), profile});
         }
+        return FortiAPI::batch_mutate(updates);
+    }
+
+    static std::vector<Result<Response>> apply_category_changes(const std::vector<CategoryChange>& changes,
+                                                                const ProfileSelector& selector = {}) {
+        return update_profiles([&](DNSProfile& profile) { return profile.ftgd_dns.apply(changes); }, selector);
+    }
+
+    // Gives every selected profile exactly policy's categories and actions.
+    static std::vector<Result<Response>> apply_template(const CategoryFilter& policy,
+                                                        const ProfileSelector& selector = {}) {
+        return update_profiles([&](DNSProfile& profile) { return profile.ftgd_dns.conform_to(policy); }, selector);
+    }
+
+    static void global_allow_category(unsigned int category) {
+        apply_category_changes({{category, CategoryAction::ALLOW}});
     }
 
     static void block_category_in_profile(const std::string& profile_name, unsigned int category) {
@@ -162,7 +538,21 @@ public:
     }
 
     static void block_category_in_profiles(const std::vector<std::string>& profiles, unsigned int category) {
-        for (const auto& name : profiles) block_category_in_profile(name, category);
+        std::vector<BatchRequest> lookups;
+        for (const auto& name : profiles) lookups.push_back({"GET", std::format("{}/{}", api_endpoint, name)});
+
+        std::vector<BatchRequest> updates;
+        auto responses = FortiAPI::batch<DNSProfilesResponse>(lookups);
+        for (std::size_t i = 0; i < responses.size(); ++i) {
+            if (!responses[i] || responses[i]->results.empty())
+                throw std::runtime_error("Can't update non-existent DNS Profile: " + profiles[i]);
+
+            auto& profile = responses[i]->results[0];
+            profile.ftgd_dns.sort_filters();
+            profile.block_category(category);
+            updates.push_back({"PUT", lookups[i].path, profile});
+        }
+        FortiAPI::batch_mutate(updates);
     }
 };
 
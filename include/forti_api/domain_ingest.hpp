@@ -0,0 +1,370 @@
+#ifndef FORTI_API_DOMAIN_INGEST_HPP
+#define FORTI_API_DOMAIN_INGEST_HPP
+
+#include "threat_feed.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+// POSIX only, so forti_api.hpp leaves this header out; include it directly to ingest blocklists.
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+enum class ListFormat {
+    AUTO,
+    HOSTS,    // 0.0.0.0 ads.example.com
+    PLAIN,    // ads.example.com
+    ADBLOCK,  // ||ads.example.com^
+};
+
+struct IngestOptions {
+    ListFormat format = ListFormat::AUTO;
+    bool idna = false;                               // punycode labels with non-ASCII characters
+    unsigned int threads = 0;                        // 0 = hardware concurrency
+    std::size_t parallel_threshold = 8 * 1024 * 1024;  // inputs below this are parsed on the calling thread
+};
+
+// Read-only memory map of a whole file.
+class MappedFile {
+    const char* data = nullptr;
+    std::size_t length = 0;
+
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Unable to open blocklist: " + path);
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Unable to stat blocklist: " + path);
+        }
+
+        length = static_cast<std::size_t>(st.st_size);
+        if (length > 0) {
+            void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Unable to map blocklist: " + path);
+            }
+            ::madvise(mapped, length, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(mapped);
+        }
+        ::close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { if (data) ::munmap(const_cast<char*>(data), length); }
+
+    [[nodiscard]] std::string_view view() const { return {data, length}; }
+};
+
+// Turns hosts, plain and adblock style blocklists into normalized, deduplicated feed entries.
+class DomainIngest {
+    static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+
+    static std::string_view trim(std::string_view s) {
+        while (!s.empty() && is_space(s.front())) s.remove_prefix(1);
+        while (!s.empty() && is_space(s.back())) s.remove_suffix(1);
+        return s;
+    }
+
+    static std::string_view next_token(std::string_view& s) {
+        s = trim(s);
+        std::size_t end = 0;
+        while (end < s.size() && !is_space(s[end])) ++end;
+        auto token = s.substr(0, end);
+        s.remove_prefix(end);
+        return token;
+    }
+
+    static bool looks_like_ip(std::string_view s) {
+        if (s.empty()) return false;
+        return std::all_of(s.begin(), s.end(), [](char c) {
+            return (c >= '0' && c <= '9') || c == '.' || c == ':' || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+        }) && (s.find('.') != std::string_view::npos || s.find(':') != std::string_view::npos);
+    }
+
+    static bool valid_char(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_';
+    }
+
+    // Lowercases into out and reports whether every byte is a valid hostname character; 16 bytes at a
+    // time where SSE2 is available.
+    static bool lower_ascii(std::string_view in, char* out) {
+        std::size_t i = 0;
+#if defined(__SSE2__)
+        const __m128i upper_lo = _mm_set1_epi8('A' - 1), upper_hi = _mm_set1_epi8('Z' + 1);
+        const __m128i lower_lo = _mm_set1_epi8('a' - 1), lower_hi = _mm_set1_epi8('z' + 1);
+        const __m128i digit_lo = _mm_set1_epi8('0' - 1), digit_hi = _mm_set1_epi8('9' + 1);
+        const __m128i case_bit = _mm_set1_epi8(0x20);
+        const __m128i hyphen = _mm_set1_epi8('-'), dot = _mm_set1_epi8('.'), underscore = _mm_set1_epi8('_');
+
+        for (; i + 16 <= in.size(); i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in.data() + i));
+            __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, upper_lo), _mm_cmplt_epi8(v, upper_hi));
+            v = _mm_or_si128(v, _mm_and_si128(upper, case_bit));
+
+            __m128i valid = _mm_and_si128(_mm_cmpgt_epi8(v, lower_lo), _mm_cmplt_epi8(v, lower_hi));
+            valid = _mm_or_si128(valid, _mm_and_si128(_mm_cmpgt_epi8(v, digit_lo), _mm_cmplt_epi8(v, digit_hi)));
+            valid = _mm_or_si128(valid, _mm_cmpeq_epi8(v, hyphen));
+            valid = _mm_or_si128(valid, _mm_cmpeq_epi8(v, dot));
+            valid = _mm_or_si128(valid, _mm_cmpeq_epi8(v, underscore));
+            if (_mm_movemask_epi8(valid) != 0xFFFF) return false;
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), v);
+        }
+#endif
+        for (; i < in.size(); ++i) {
+            char c = in[i];
+            if (c >= 'A' && c <= 'Z') c = static_cast<char>(c | 0x20);
+            if (!valid_char(c)) return false;
+            out[i] = c;
+        }
+        return true;
+    }
+
+    static void append_utf8_lower(std::u32string& out, std::string_view label, bool& ok) {
+        for (std::size_t i = 0; i < label.size();) {
+            auto c = static_cast<unsigned char>(label[i]);
+            char32_t cp;
+            std::size_t len;
+            if (c < 0x80) { cp = c; len = 1; }
+            else if ((c >> 5) == 0x6) { cp = c & 0x1F; len = 2; }
+            else if ((c >> 4) == 0xE) { cp = c & 0x0F; len = 3; }
+            else if ((c >> 3) == 0x1E) { cp = c & 0x07; len = 4; }
+            else { ok = false; return; }
+            if (i + len > label.size()) { ok = false; return; }
+            for (std::size_t k = 1; k < len; ++k) {
+                auto cc = static_cast<unsigned char>(label[i + k]);
+                if ((cc >> 6) != 0x2) { ok = false; return; }
+                cp = (cp << 6) | (cc & 0x3F);
+            }
+            if (cp >= 'A' && cp <= 'Z') cp |= 0x20;
+            out.push_back(cp);
+            i += len;
+        }
+    }
+
+    static char punycode_digit(std::uint32_t d) { return static_cast<char>(d < 26 ? 'a' + d : '0' + (d - 26)); }
+
+    static std::uint32_t punycode_adapt(std::uint32_t delta, std::uint32_t points, bool first) {
+        delta = first ? delta / 700 : delta / 2;
+        delta += delta / points;
+        std::uint32_t k = 0;
+        while (delta > ((36 - 1) * 26) / 2) {
+            delta /= 36 - 1;
+            k += 36;
+        }
+        return k + (36 * delta) / (delta + 38);
+    }
+
+public:
+    // RFC 3492 encoding of one label, "xn--" prefixed when it contains non-ASCII characters.
+    static bool punycode_label(std::string_view label, std::string& out) {
+        bool ok = true;
+        std::u32string input;
+        append_utf8_lower(input, label, ok);
+        if (!ok) return false;
+
+        std::string encoded;
+        for (char32_t cp : input) if (cp < 0x80) encoded += static_cast<char>(cp);
+        if (encoded.size() == input.size()) {
+            out += encoded;
+            return true;
+        }
+
+        std::size_t basic = encoded.size(), handled = basic;
+        if (basic > 0) encoded += '-';
+
+        std::uint32_t n = 0x80, delta = 0, bias = 72;
+        while (handled < input.size()) {
+            std::uint32_t m = UINT32_MAX;
+            for (char32_t cp : input) if (cp >= n && cp < m) m = cp;
+            delta += (m - n) * static_cast<std::uint32_t>(handled + 1);
+            n = m;
+            for (char32_t cp : input) {
+                if (cp < n) ++delta;
+                if (cp != n) continue;
+                std::uint32_t q = delta;
+                for (std::uint32_t k = 36;; k += 36) {
+                    std::uint32_t t = k <= bias ? 1 : (k >= bias + 26 ? 26 : k - bias);
+                    if (q < t) break;
+                    encoded += punycode_digit(t + (q - t) % (36 - t));
+                    q = (q - t) / (36 - t);
+                }
+                encoded += punycode_digit(q);
+                bias = punycode_adapt(delta, static_cast<std::uint32_t>(handled + 1), handled == basic);
+                delta = 0;
+                ++handled;
+            }
+            ++delta;
+            ++n;
+        }
+
+        out += "xn--";
+        out += encoded;
+        return true;
+    }
+
+    // Normalizes a candidate domain into out: lowercase, no trailing dots, valid labels only.
+    static bool normalize(std::string_view domain, std::string& out, bool idna = false) {
+        while (!domain.empty() && domain.back() == '.') domain.remove_suffix(1);
+        while (!domain.empty() && domain.front() == '.') domain.remove_prefix(1);
+        if (domain.empty() || domain.size() > 253) return false;
+
+        out.resize(domain.size());
+        if (!lower_ascii(domain, out.data())) {
+            if (!idna) return false;
+            out.clear();
+            for (std::size_t start = 0; start <= domain.size();) {
+                auto end = domain.find('.', start);
+                if (end == std::string_view::npos) end = domain.size();
+                if (!out.empty()) out += '.';
+                if (!punycode_label(domain.substr(start, end - start), out)) return false;
+                start = end + 1;
+            }
+            if (out.size() > 253 || !lower_ascii(out, out.data())) return false;
+        }
+
+        // every label 1-63 chars, not starting or ending with a hyphen, and more than one label
+        std::size_t labels = 0, start = 0;
+        bool numeric = true;
+        for (std::size_t i = 0; i <= out.size(); ++i) {
+            if (i < out.size() && out[i] != '.') {
+                numeric &= out[i] >= '0' && out[i] <= '9';
+                continue;
+            }
+            std::size_t len = i - start;
+            if (len == 0 || len > 63 || out[start] == '-' || out[i - 1] == '-') return false;
+            ++labels;
+            start = i + 1;
+        }
+        return labels > 1 && !numeric;
+    }
+
+    // Extracts the domains on one line; appends normalized entries to out.
+    static void parse_line(std::string_view line, ListFormat format, bool idna, std::vector<std::string>& out) {
+        line = trim(line);
+        if (line.empty() || line.front() == '#' || line.front() == '!') return;
+
+        if (format == ListFormat::AUTO) {
+            if (line.starts_with("||")) format = ListFormat::ADBLOCK;
+            else {
+                auto rest = line;
+                auto first = next_token(rest);
+                format = looks_like_ip(first) && !trim(rest).empty() ? ListFormat::HOSTS : ListFormat::PLAIN;
+            }
+        }
+
+        std::string domain;
+        switch (format) {
+            case ListFormat::ADBLOCK: {
+                if (!line.starts_with("||")) return;
+                line.remove_prefix(2);
+                auto caret = line.find('^');
+                if (caret == std::string_view::npos || trim(line.substr(caret + 1)).size() > 0) return;
+                if (normalize(line.substr(0, caret), domain, idna)) out.push_back(std::move(domain));
+                break;
+            }
+            case ListFormat::HOSTS: {
+                if (auto hash = line.find('#'); hash != std::string_view::npos) line = line.substr(0, hash);
+                next_token(line);  // address
+                for (auto host = next_token(line); !host.empty(); host = next_token(line)) {
+                    if (host == "localhost" || host == "localhost.localdomain" || host == "broadcasthost" ||
+                        host == "local" || host.starts_with("ip6-"))
+                        continue;
+                    if (normalize(host, domain, idna)) out.push_back(std::move(domain));
+                }
+                break;
+            }
+            default: {
+                if (auto hash = line.find('#'); hash != std::string_view::npos) line = line.substr(0, hash);
+                if (normalize(next_token(line), domain, idna)) out.push_back(std::move(domain));
+                break;
+            }
+        }
+    }
+
+    static void parse_chunk(std::string_view data, const IngestOptions& options, std::vector<std::string>& out) {
+        while (!data.empty()) {
+            const void* newline = std::memchr(data.data(), '\n', data.size());
+            std::size_t end = newline ? static_cast<const char*>(newline) - data.data() : data.size();
+            parse_line(data.substr(0, end), options.format, options.idna, out);
+            data.remove_prefix(std::min(end + 1, data.size()));
+        }
+    }
+
+    // Parses a whole blocklist, splitting it on line boundaries across threads when it's large.
+    // The result is sorted and free of duplicates.
+    static std::vector<std::string> ingest(std::string_view data, const IngestOptions& options = {}) {
+        unsigned int threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+        if (data.size() < options.parallel_threshold) threads = 1;
+
+        std::vector<std::string_view> chunks;
+        for (std::size_t begin = 0, t = 0; begin < data.size(); ++t) {
+            std::size_t end = t + 1 == threads ? data.size() : std::max(begin, data.size() * (t + 1) / threads);
+            const void* newline = end < data.size() ? std::memchr(data.data() + end, '\n', data.size() - end) : nullptr;
+            end = newline ? static_cast<const char*>(newline) - data.data() + 1 : data.size();
+            chunks.push_back(data.substr(begin, end - begin));
+            begin = end;
+        }
+
+        std::vector<std::vector<std::string>> parsed(chunks.size());
+        if (chunks.size() == 1) parse_chunk(chunks[0], options, parsed[0]);
+        else {
+            std::vector<std::jthread> workers;
+            for (std::size_t i = 0; i < chunks.size(); ++i)
+                workers.emplace_back([&, i] {
+                    parse_chunk(chunks[i], options, parsed[i]);
+                    std::sort(parsed[i].begin(), parsed[i].end());
+                    parsed[i].erase(std::unique(parsed[i].begin(), parsed[i].end()), parsed[i].end());
+                });
+        }
+
+        std::vector<std::string> domains;
+        std::size_t total = 0;
+        for (const auto& part : parsed) total += part.size();
+        domains.reserve(total);
+        for (auto& part : parsed) std::move(part.begin(), part.end(), std::back_inserter(domains));
+
+        std::sort(domains.begin(), domains.end());
+        domains.erase(std::unique(domains.begin(), domains.end()), domains.end());
+        return domains;
+    }
+
+    static std::vector<std::string> ingest_file(const std::string& path, const IngestOptions& options = {}) {
+        MappedFile file(path);
+        return ingest(file.view(), options);
+    }
+
+    // Merges several blocklists into one snapshot command for ThreatFeed::update_feed.
+    static CommandsRequest ingest_feed(const std::string& feed, const std::vector<std::string>& paths,
+                                       const IngestOptions& options = {}) {
+        std::vector<std::string> domains;
+        for (const auto& path : paths) {
+            auto parsed = ingest_file(path, options);
+            std::move(parsed.begin(), parsed.end(), std::back_inserter(domains));
+        }
+        if (paths.size() > 1) {
+            std::sort(domains.begin(), domains.end());
+            domains.erase(std::unique(domains.begin(), domains.end()), domains.end());
+        }
+        return CommandEntry(feed, domains);
+    }
+};
+
+#endif //FORTI_API_DOMAIN_INGEST_HPP
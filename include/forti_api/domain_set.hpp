@@ -0,0 +1,223 @@
+#ifndef FORTI_API_DOMAIN_SET_HPP
+#define FORTI_API_DOMAIN_SET_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+// Immutable, compact set of domains for feed entry lists.
+//
+// Domains are stored with their labels reversed ("www.example.com" -> "com.example.www") so parents
+// sort directly before their subdomains, then front-coded in blocks of 16 inside a single arena.
+// Validity is one bit per entry. Lookups binary search the uncompressed block heads and decode at
+// most one block, with no allocation.
+class DomainSet {
+    static constexpr std::size_t block_size = 16;
+    static constexpr std::size_t max_domain = 255;
+
+    std::vector<char> arena;
+    std::vector<std::uint32_t> blocks;   // arena offset of each block head
+    std::vector<std::uint64_t> valid_bits;
+    std::size_t count = 0;
+
+    static void put_varint(std::vector<char>& out, std::size_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    static std::size_t get_varint(const char*& p) {
+        std::size_t value = 0;
+        for (unsigned shift = 0;; shift += 7) {
+            auto byte = static_cast<unsigned char>(*p++);
+            value |= static_cast<std::size_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+    }
+
+    // Writes the lowercased, label-reversed form of domain into out, returns its length (0 if invalid).
+    static std::size_t reverse_labels(std::string_view domain, char* out) {
+        while (!domain.empty() && domain.back() == '.') domain.remove_suffix(1);
+        if (domain.empty() || domain.size() > max_domain) return 0;
+
+        std::size_t written = 0, end = domain.size();
+        while (true) {
+            auto dot = domain.rfind('.', end - 1);
+            std::size_t start = dot == std::string_view::npos ? 0 : dot + 1;
+            for (std::size_t i = start; i < end; ++i) {
+                char c = domain[i];
+                out[written++] = c >= 'A' && c <= 'Z' ? static_cast<char>(c | 0x20) : c;
+            }
+            if (dot == std::string_view::npos || dot == 0) break;
+            out[written++] = '.';
+            end = dot;
+        }
+        return written;
+    }
+
+    [[nodiscard]] std::string_view block_head(std::size_t block) const {
+        const char* p = arena.data() + blocks[block];
+        std::size_t length = get_varint(p);
+        return {p, length};
+    }
+
+    // Position of key in sorted order, or nullopt.
+    [[nodiscard]] std::optional<std::size_t> find(std::string_view key) const {
+        if (blocks.empty()) return std::nullopt;
+
+        std::size_t lo = 0, hi = blocks.size();
+        while (hi - lo > 1) {
+            std::size_t mid = (lo + hi) / 2;
+            if (block_head(mid) <= key) lo = mid;
+            else hi = mid;
+        }
+
+        char current[max_domain + 1];
+        const char* p = arena.data() + blocks[lo];
+        std::size_t length = get_varint(p);
+        std::memcpy(current, p, length);
+        p += length;
+
+        std::size_t index = lo * block_size, last = std::min(count, index + block_size);
+        while (true) {
+            int cmp = std::string_view(current, length).compare(key);
+            if (cmp == 0) return index;
+            if (cmp > 0 || ++index == last) return std::nullopt;
+
+            std::size_t shared = get_varint(p), suffix = get_varint(p);
+            std::memcpy(current + shared, p, suffix);
+            p += suffix;
+            length = shared + suffix;
+        }
+    }
+
+    // Builds the set from reversed keys, sorting them in place.
+    void build(std::vector<std::pair<std::string, bool>>& keys) {
+        std::stable_sort(keys.begin(), keys.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        keys.erase(std::unique(keys.begin(), keys.end(), [](const auto& a, const auto& b) { return a.first == b.first; }),
+                   keys.end());
+
+        count = keys.size();
+        valid_bits.assign((count + 63) / 64, 0);
+        blocks.reserve((count + block_size - 1) / block_size);
+
+        std::string_view previous;
+        for (std::size_t i = 0; i < count; ++i) {
+            std::string_view key = keys[i].first;
+            if (keys[i].second) valid_bits[i / 64] |= std::uint64_t{1} << (i % 64);
+
+            if (i % block_size == 0) {
+                blocks.push_back(static_cast<std::uint32_t>(arena.size()));
+                put_varint(arena, key.size());
+                arena.insert(arena.end(), key.begin(), key.end());
+            } else {
+                std::size_t shared = 0;
+                while (shared < key.size() && shared < previous.size() && key[shared] == previous[shared]) ++shared;
+                put_varint(arena, shared);
+                put_varint(arena, key.size() - shared);
+                arena.insert(arena.end(), key.begin() + static_cast<std::ptrdiff_t>(shared), key.end());
+            }
+            previous = key;
+        }
+        arena.shrink_to_fit();
+    }
+
+public:
+    DomainSet() = default;
+
+    // (domain, valid) pairs in any order; duplicates keep the first validity seen.
+    explicit DomainSet(const std::vector<std::pair<std::string, bool>>& domains) {
+        std::vector<std::pair<std::string, bool>> keys;
+        keys.reserve(domains.size());
+        char buffer[max_domain + 1];
+        for (const auto& [domain, valid] : domains) {
+            std::size_t length = reverse_labels(domain, buffer);
+            if (length) keys.emplace_back(std::string(buffer, length), valid);
+        }
+        build(keys);
+    }
+
+    // Same, reusing the pairs' strings for the keys instead of copying them.
+    explicit DomainSet(std::vector<std::pair<std::string, bool>>&& domains) {
+        char buffer[max_domain + 1];
+        std::size_t kept = 0;
+        for (auto& [domain, valid] : domains) {
+            std::size_t length = reverse_labels(domain, buffer);
+            if (!length) continue;
+            domain.assign(buffer, length);
+            domains[kept++] = {std::move(domain), valid};
+        }
+        domains.resize(kept);
+        build(domains);
+        std::vector<std::pair<std::string, bool>>().swap(domains);
+    }
+
+    // Exact membership.
+    [[nodiscard]] bool contains(std::string_view domain) const {
+        char key[max_domain + 1];
+        std::size_t length = reverse_labels(domain, key);
+        return length && find({key, length}).has_value();
+    }
+
+    // Whether the domain or any of its parent domains is in the set.
+    [[nodiscard]] bool covers(std::string_view domain) const {
+        char key[max_domain + 1];
+        std::size_t length = reverse_labels(domain, key);
+        if (!length) return false;
+
+        // every label boundary of the reversed key is a parent domain, shortest first
+        for (std::size_t i = 0; i <= length; ++i)
+            if ((i == length || key[i] == '.') && find({key, i})) return true;
+        return false;
+    }
+
+    // Validity flag of an exact entry, nullopt when absent.
+    [[nodiscard]] std::optional<bool> is_valid(std::string_view domain) const {
+        char key[max_domain + 1];
+        std::size_t length = reverse_labels(domain, key);
+        if (!length) return std::nullopt;
+        auto index = find({key, length});
+        if (!index) return std::nullopt;
+        return (valid_bits[*index / 64] >> (*index % 64)) & 1;
+    }
+
+    // Visits every domain (in natural label order) with its validity, sorted by reversed labels.
+    void for_each(const std::function<void(std::string_view, bool)>& visit) const {
+        char current[max_domain + 1], domain[max_domain + 1];
+        std::size_t length = 0;
+        const char* p = arena.data();
+        for (std::size_t i = 0; i < count; ++i) {
+            if (i % block_size == 0) {
+                length = get_varint(p);
+                std::memcpy(current, p, length);
+                p += length;
+            } else {
+                std::size_t shared = get_varint(p), suffix = get_varint(p);
+                std::memcpy(current + shared, p, suffix);
+                p += suffix;
+                length = shared + suffix;
+            }
+            std::size_t domain_length = reverse_labels({current, length}, domain);
+            visit({domain, domain_length}, (valid_bits[i / 64] >> (i % 64)) & 1);
+        }
+    }
+
+    [[nodiscard]] std::size_t size() const { return count; }
+    [[nodiscard]] bool empty() const { return count == 0; }
+
+    [[nodiscard]] std::size_t memory_usage() const {
+        return sizeof(*this) + arena.capacity() + blocks.capacity() * sizeof(std::uint32_t) +
+               valid_bits.capacity() * sizeof(std::uint64_t);
+    }
+};
+
+#endif //FORTI_API_DOMAIN_SET_HPP
@@ -6,19 +6,35 @@
 #define FORTI_API_FIREWALL_HPP
 
 #include "api.hpp"
+#include "pagination.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
 
 struct Module { std::string name, q_origin_key; };
 
 struct Interface : public Module {
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(Interface, name, q_origin_key)
+    FORTI_API_DEFINE_TYPE(Interface, name, q_origin_key)
 };
 
 struct Address : public Module {
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(Address, name, q_origin_key)
+    FORTI_API_DEFINE_TYPE(Address, name, q_origin_key)
 };
 
 struct Service : public Module {
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(Service, name, q_origin_key)
+    FORTI_API_DEFINE_TYPE(Service, name, q_origin_key)
+};
+
+struct User : public Module {
+    FORTI_API_DEFINE_TYPE(User, name, q_origin_key)
+};
+
+struct Group : public Module {
+    FORTI_API_DEFINE_TYPE(Group, name, q_origin_key)
 };
 
 struct FirewallPolicy {
@@ -26,39 +42,331 @@ struct FirewallPolicy {
     std::vector<Interface> srcintf, dstintf;
     std::vector<Address> srcaddr, dstaddr;
     std::vector<Service> service;
+    std::vector<User> users;
+    std::vector<Group> groups;
     std::string status, name, action, ssl_ssh_profile, av_profile, webfilter_profile, dnsfilter_profile,
                 nat, inbound, outbound, natinbound, natoutbound, comments, vlan_filter;
+    // FortiOS defaults, so policies built locally send what the device would assume anyway
+    std::string srcaddr_negate = "disable", dstaddr_negate = "disable", service_negate = "disable",
+                internet_service = "disable", schedule = "always";
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(FirewallPolicy, policyid, q_origin_key, uuid_idx,
-                                                srcintf, dstintf, srcaddr, dstaddr, service,
+    FORTI_API_DEFINE_TYPE(FirewallPolicy, policyid, q_origin_key, uuid_idx,
+                                                srcintf, dstintf, srcaddr, dstaddr, service, users, groups,
                                                 status, name, action, ssl_ssh_profile,
                                                 av_profile, webfilter_profile, dnsfilter_profile, nat,
-                                                inbound, outbound, natinbound, natoutbound, comments, vlan_filter)
+                                                inbound, outbound, natinbound, natoutbound, comments, vlan_filter,
+                                                srcaddr_negate, dstaddr_negate, service_negate, internet_service,
+                                                schedule)
 };
 
 struct FirewallPoliciesResponse : public Response {
     std::vector<FirewallPolicy> results;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(FirewallPoliciesResponse, http_method, size, matched_count, next_idx,
+    FORTI_API_DEFINE_TYPE(FirewallPoliciesResponse, http_method, size, matched_count, next_idx,
                                                 revision, vdom, path, name, status, http_status, serial, version, build, results)
 };
 
+struct FirewallAddress {
+    std::string name, q_origin_key, type, subnet, start_ip, end_ip;
+
+    FORTI_API_DEFINE_TYPE(FirewallAddress, name, q_origin_key, type, subnet, start_ip, end_ip)
+};
+
+struct FirewallAddressGroup {
+    std::string name, q_origin_key;
+    std::vector<Address> member;
+
+    FORTI_API_DEFINE_TYPE(FirewallAddressGroup, name, q_origin_key, member)
+};
+
+struct ServiceCustom {
+    std::string name, q_origin_key, protocol, tcp_portrange, udp_portrange, sctp_portrange;
+    unsigned int protocol_number{};
+
+    FORTI_API_DEFINE_TYPE(ServiceCustom, name, q_origin_key, protocol, tcp_portrange, udp_portrange,
+                          sctp_portrange, protocol_number)
+};
+
+struct ServiceGroup {
+    std::string name, q_origin_key;
+    std::vector<Service> member;
+
+    FORTI_API_DEFINE_TYPE(ServiceGroup, name, q_origin_key, member)
+};
+
+struct FirewallAddressesResponse : public Response {
+    std::vector<FirewallAddress> results;
+
+    FORTI_API_DEFINE_TYPE(FirewallAddressesResponse, http_method, size, matched_count, next_idx,
+                          revision, vdom, path, name, status, http_status, serial, version, build, results)
+};
+
+struct FirewallAddressGroupsResponse : public Response {
+    std::vector<FirewallAddressGroup> results;
+
+    FORTI_API_DEFINE_TYPE(FirewallAddressGroupsResponse, http_method, size, matched_count, next_idx,
+                          revision, vdom, path, name, status, http_status, serial, version, build, results)
+};
+
+struct ServicesCustomResponse : public Response {
+    std::vector<ServiceCustom> results;
+
+    FORTI_API_DEFINE_TYPE(ServicesCustomResponse, http_method, size, matched_count, next_idx,
+                          revision, vdom, path, name, status, http_status, serial, version, build, results)
+};
+
+struct ServiceGroupsResponse : public Response {
+    std::vector<ServiceGroup> results;
+
+    FORTI_API_DEFINE_TYPE(ServiceGroupsResponse, http_method, size, matched_count, next_idx,
+                          revision, vdom, path, name, status, http_status, serial, version, build, results)
+};
+
+// Local copy of the policy table with hash indexes on policyid and name, and inverted indexes from
+// every referenced interface, address, service and profile name to the policies using it. Kept in
+// step with the device through upsert()/erase() instead of refetching.
+class PolicyTable {
+public:
+    enum class Field : std::size_t {
+        SRCINTF, DSTINTF, SRCADDR, DSTADDR, SERVICE,
+        SSL_SSH_PROFILE, AV_PROFILE, WEBFILTER_PROFILE, DNSFILTER_PROFILE, COUNT
+    };
+
+private:
+    using Postings = std::unordered_map<std::string, std::vector<unsigned int>>;
+
+    std::unordered_map<unsigned int, FirewallPolicy> policies;  // node based, so pointers survive rehashing
+    std::unordered_map<std::string, unsigned int> names;
+    std::array<Postings, static_cast<std::size_t>(Field::COUNT)> inverted;
+
+    template<typename Visit>
+    static void for_each_reference(const FirewallPolicy& policy, Visit&& visit) {
+        for (const auto& module : policy.srcintf) visit(Field::SRCINTF, module.name);
+        for (const auto& module : policy.dstintf) visit(Field::DSTINTF, module.name);
+        for (const auto& module : policy.srcaddr) visit(Field::SRCADDR, module.name);
+        for (const auto& module : policy.dstaddr) visit(Field::DSTADDR, module.name);
+        for (const auto& module : policy.service) visit(Field::SERVICE, module.name);
+        if (!policy.ssl_ssh_profile.empty()) visit(Field::SSL_SSH_PROFILE, policy.ssl_ssh_profile);
+        if (!policy.av_profile.empty()) visit(Field::AV_PROFILE, policy.av_profile);
+        if (!policy.webfilter_profile.empty()) visit(Field::WEBFILTER_PROFILE, policy.webfilter_profile);
+        if (!policy.dnsfilter_profile.empty()) visit(Field::DNSFILTER_PROFILE, policy.dnsfilter_profile);
+    }
+
+    void unindex(const FirewallPolicy& policy) {
+        if (auto it = names.find(policy.name); it != names.end() && it->second == policy.policyid) names.erase(it);
+        for_each_reference(policy, [&](Field field, const std::string& name) {
+            auto& postings = inverted[static_cast<std::size_t>(field)];
+            auto it = postings.find(name);
+            if (it == postings.end()) return;
+            std::erase(it->second, policy.policyid);
+            if (it->second.empty()) postings.erase(it);
+        });
+    }
+
+    void index(const FirewallPolicy& policy) {
+        if (!policy.name.empty()) names.insert_or_assign(policy.name, policy.policyid);
+        for_each_reference(policy, [&](Field field, const std::string& name) {
+            auto& ids = inverted[static_cast<std::size_t>(field)][name];
+            if (std::find(ids.begin(), ids.end(), policy.policyid) == ids.end()) ids.push_back(policy.policyid);
+        });
+    }
+
+    [[nodiscard]] std::vector<const FirewallPolicy*> resolve(std::initializer_list<Field> fields, std::string_view name) const {
+        std::vector<unsigned int> ids;
+        for (auto field : fields) {
+            const auto& postings = inverted[static_cast<std::size_t>(field)];
+            if (auto it = postings.find(std::string(name)); it != postings.end())
+                ids.insert(ids.end(), it->second.begin(), it->second.end());
+        }
+        if (fields.size() > 1) {
+            std::sort(ids.begin(), ids.end());
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        }
+
+        std::vector<const FirewallPolicy*> result;
+        result.reserve(ids.size());
+        for (auto id : ids) result.push_back(&policies.at(id));
+        return result;
+    }
+
+public:
+    PolicyTable() = default;
+
+    explicit PolicyTable(const std::vector<FirewallPolicy>& policies) {
+        for (const auto& policy : policies) upsert(policy);
+    }
+
+    void upsert(const FirewallPolicy& policy) {
+        if (auto it = policies.find(policy.policyid); it != policies.end()) {
+            unindex(it->second);
+            it->second = policy;
+            index(it->second);
+        } else index(policies.emplace(policy.policyid, policy).first->second);
+    }
+
+    bool erase(unsigned int policyid) {
+        auto it = policies.find(policyid);
+        if (it == policies.end()) return false;
+        unindex(it->second);
+        policies.erase(it);
+        return true;
+    }
+
+    [[nodiscard]] const FirewallPolicy* by_id(unsigned int policyid) const {
+        auto it = policies.find(policyid);
+        return it == policies.end() ? nullptr : &it->second;
+    }
+
+    [[nodiscard]] const FirewallPolicy* by_name(std::string_view name) const {
+        auto it = names.find(std::string(name));
+        return it == names.end() ? nullptr : by_id(it->second);
+    }
+
+    [[nodiscard]] std::vector<const FirewallPolicy*> by(Field field, std::string_view name) const {
+        return resolve({field}, name);
+    }
+
+    // Source or destination side.
+    [[nodiscard]] std::vector<const FirewallPolicy*> by_interface(std::string_view name) const {
+        return resolve({Field::SRCINTF, Field::DSTINTF}, name);
+    }
+
+    [[nodiscard]] std::vector<const FirewallPolicy*> by_address(std::string_view name) const {
+        return resolve({Field::SRCADDR, Field::DSTADDR}, name);
+    }
+
+    [[nodiscard]] std::vector<const FirewallPolicy*> by_service(std::string_view name) const {
+        return resolve({Field::SERVICE}, name);
+    }
+
+    [[nodiscard]] std::vector<const FirewallPolicy*> by_dnsfilter_profile(std::string_view name) const {
+        return resolve({Field::DNSFILTER_PROFILE}, name);
+    }
+
+    [[nodiscard]] std::size_t size() const { return policies.size(); }
+};
+
 namespace FortiGate {
 
     class Policy {
         inline static std::string endpoint = "/cmdb/firewall/policy";
 
+        // One table per device, keyed like the threat feed baselines. Tables are immutable once
+        // published: lookups keep the shared_ptr they got, and update() swaps in an edited copy.
+        struct Entry {
+            std::shared_ptr<const PolicyTable> table;
+            std::chrono::steady_clock::time_point loaded_at;
+            std::uint64_t generation = 0;  // bumped by every update and reload
+        };
+
+        inline static std::mutex table_mutex;
+        inline static std::unordered_map<std::string, Entry> policy_tables;
+        inline static std::atomic<std::chrono::milliseconds::rep> max_age_ms{std::chrono::milliseconds(std::chrono::minutes(1)).count()};
+
+        static std::string device_key() { return FortiAPI::client()->get_config().base_url(); }
+
+        static bool expired(const Entry& entry) {
+            auto max_age = std::chrono::milliseconds(max_age_ms.load(std::memory_order_relaxed));
+            return max_age.count() > 0 && std::chrono::steady_clock::now() - entry.loaded_at >= max_age;
+        }
+
     public:
         static std::vector<FirewallPolicy> get() { return FortiAPI::get<FirewallPoliciesResponse>(endpoint).results; }
 
+        // Streams the policy table a page at a time instead of loading it whole.
+        static PagedRange<FirewallPoliciesResponse> range(unsigned int page_size = 1000) {
+            return PagedRange<FirewallPoliciesResponse>(endpoint, page_size);
+        }
+
+        // Indexed copy of the current device's policy table, loaded on first use, kept current by update()
+        // and reloaded once it's older than the max age, so changes made elsewhere show up. The device is
+        // read without holding the lock, so other devices' lookups don't wait on it.
+        static std::shared_ptr<const PolicyTable> table() {
+            auto key = device_key();
+            std::uint64_t generation = 0;
+            {
+                std::lock_guard lock(table_mutex);
+                if (auto it = policy_tables.find(key); it != policy_tables.end()) {
+                    if (it->second.table && !expired(it->second)) return it->second.table;
+                    generation = it->second.generation;
+                }
+            }
+
+            auto loaded = std::make_shared<PolicyTable>();
+            for (const auto& policy : range()) loaded->upsert(policy);
+
+            // an update or reload while loading may not be in what was read, so it isn't published then
+            std::lock_guard lock(table_mutex);
+            auto& entry = policy_tables[key];
+            if (entry.generation == generation) {
+                entry.table = loaded;
+                entry.loaded_at = std::chrono::steady_clock::now();
+            }
+            return loaded;
+        }
+
+        // Drops the current device's local table; the next lookup reloads it from the device.
+        static void reload() {
+            auto key = device_key();
+            std::lock_guard lock(table_mutex);
+            auto& entry = policy_tables[key];
+            entry.table.reset();
+            ++entry.generation;
+        }
+
+        // Zero keeps tables until reload(). Applies to every device.
+        static void set_max_age(std::chrono::milliseconds max_age) { max_age_ms.store(max_age.count()); }
+
         static FirewallPolicy get(const std::string& name) {
-            auto policies = get();
-            for (const auto& policy : policies) if (policy.name == name) return policy;
+            auto policies = table();
+            if (auto policy = policies->by_name(name)) return *policy;
             throw std::runtime_error("Unable to locate firewall policy: " + name);
         }
 
         static void update(const FirewallPolicy& policy) {
-            FortiAPI::put(std::format("{}/{}", endpoint, policy.policyid), policy);
+            auto response = FortiAPI::put(std::format("{}/{}", endpoint, policy.policyid), policy);
+            if (response.status != "success") return;
+
+            auto key = device_key();
+            std::unique_lock lock(table_mutex);
+            auto& entry = policy_tables[key];
+            ++entry.generation;
+            // the copy is edited outside the lock and swapped in unless another update got there first
+            while (entry.table) {
+                auto current = entry.table;
+                lock.unlock();
+                auto next = std::make_shared<PolicyTable>(*current);
+                next->upsert(policy);
+                lock.lock();
+                if (entry.table == current) {
+                    entry.table = std::move(next);
+                    break;
+                }
+            }
+        }
+    };
+
+    class Objects {
+        inline static std::string address_endpoint = "/cmdb/firewall/address",
+                                  address_group_endpoint = "/cmdb/firewall/addrgrp",
+                                  service_endpoint = "/cmdb/firewall.service/custom",
+                                  service_group_endpoint = "/cmdb/firewall.service/group";
+
+    public:
+        static std::vector<FirewallAddress> get_addresses() {
+            return FortiAPI::get<FirewallAddressesResponse>(address_endpoint).results;
+        }
+
+        static std::vector<FirewallAddressGroup> get_address_groups() {
+            return FortiAPI::get<FirewallAddressGroupsResponse>(address_group_endpoint).results;
+        }
+
+        static std::vector<ServiceCustom> get_services() {
+            return FortiAPI::get<ServicesCustomResponse>(service_endpoint).results;
+        }
+
+        static std::vector<ServiceGroup> get_service_groups() {
+            return FortiAPI::get<ServiceGroupsResponse>(service_group_endpoint).results;
         }
     };
 
@@ -0,0 +1,167 @@
+#ifndef FORTI_API_FLEET_HPP
+#define FORTI_API_FLEET_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <vector>
+#include "api.hpp"
+
+
+struct FleetDevice {
+    std::string name;
+    DeviceConfig config;
+};
+
+struct FleetOptions {
+    unsigned int parallelism = 16;                      // devices worked on at once
+    std::chrono::milliseconds timeout = std::chrono::seconds(60);  // per device, across all its requests
+};
+
+template<typename T>
+struct DeviceOutcome {
+    std::string device;
+    Result<T> result = std::unexpected(RequestError{0, "not run"});
+    std::chrono::milliseconds latency{};
+    bool timed_out = false;
+};
+
+template<typename T>
+struct FleetReport {
+    std::vector<DeviceOutcome<T>> devices;  // inventory order
+    std::chrono::milliseconds elapsed{};
+
+    [[nodiscard]] std::size_t succeeded() const {
+        return std::ranges::count_if(devices, [](const auto& outcome) { return outcome.result.has_value(); });
+    }
+
+    [[nodiscard]] std::size_t failed() const { return devices.size() - succeeded(); }
+
+    [[nodiscard]] std::size_t timed_out() const {
+        return std::ranges::count_if(devices, [](const auto& outcome) { return outcome.timed_out; });
+    }
+
+    // Latency at quantile q (0..1) across every device, failures included.
+    [[nodiscard]] std::chrono::milliseconds latency(double q) const {
+        if (devices.empty()) return {};
+        std::vector<std::chrono::milliseconds> latencies;
+        latencies.reserve(devices.size());
+        for (const auto& outcome : devices) latencies.push_back(outcome.latency);
+        auto rank = static_cast<std::size_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(latencies.size() - 1));
+        std::ranges::nth_element(latencies, latencies.begin() + static_cast<std::ptrdiff_t>(rank));
+        return latencies[rank];
+    }
+
+    void print(std::ostream& out = std::cout) const {
+        for (const auto& outcome : devices) {
+            out << std::format("{:<24} {:>7}ms  ", outcome.device, outcome.latency.count());
+            if (outcome.result) out << "ok\n";
+            else out << (outcome.timed_out ? "timed out: " : "failed: ") << outcome.result.error().message << '\n';
+        }
+        out << std::format("{}/{} succeeded, {} timed out, p50 {}ms, p99 {}ms, {}ms total\n", succeeded(),
+                           devices.size(), timed_out(), latency(0.5).count(), latency(0.99).count(), elapsed.count());
+    }
+};
+
+// Runs one operation against every FortiGate of an inventory, at most options.parallelism devices at
+// a time. Each device gets its own FortiClient; while the operation runs on a worker thread the static
+// facades (ThreatFeed, DNSFilter, ...) are scoped to that client, and every request it makes shares one
+// deadline of options.timeout. Exceptions and non-success responses become per-device errors.
+//
+// The indexed tables behind FortiGate::Policy::table() and System::Interface are kept per device,
+// keyed by its base URL, so fleet operations can use them like any other facade.
+class Fleet {
+    std::vector<std::string> names;
+    std::vector<std::shared_ptr<FortiClient>> clients;
+    FleetOptions options;
+
+    template<typename R>
+    using Value = std::conditional_t<std::is_void_v<R>, std::monostate, R>;
+
+    template<typename R, typename F>
+    static Result<Value<R>> invoke(F& operation, FortiClient& client) {
+        try {
+            if constexpr (std::is_void_v<R>) {
+                std::invoke(operation, client);
+                return std::monostate{};
+            } else {
+                R value = std::invoke(operation, client);
+                if constexpr (std::derived_from<R, Response>) {
+                    if (value.status != "success")
+                        return std::unexpected(RequestError{value.http_status, std::format("status '{}', HTTP {}",
+                                                                                          value.status, value.http_status)});
+                }
+                return value;
+            }
+        } catch (const std::exception& e) {
+            return std::unexpected(RequestError{0, e.what()});
+        }
+    }
+
+public:
+    explicit Fleet(const std::vector<FleetDevice>& inventory, FleetOptions options = {}) : options(options) {
+        if (this->options.parallelism == 0) this->options.parallelism = 1;
+        names.reserve(inventory.size());
+        clients.reserve(inventory.size());
+        for (const auto& device : inventory) {
+            names.push_back(device.name.empty() ? device.config.gateway_ip : device.name);
+            clients.push_back(FortiClient::create(device.config));
+        }
+    }
+
+    [[nodiscard]] std::size_t size() const { return clients.size(); }
+
+    [[nodiscard]] std::shared_ptr<FortiClient> client(const std::string& name) const {
+        auto it = std::ranges::find(names, name);
+        if (it == names.end()) throw std::out_of_range("Unknown fleet device: " + name);
+        return clients[static_cast<std::size_t>(it - names.begin())];
+    }
+
+    // operation is called as operation(FortiClient&) from several threads at once.
+    template<typename F>
+    auto run(F&& operation) const {
+        using R = std::invoke_result_t<F&, FortiClient&>;
+        using Clock = std::chrono::steady_clock;
+
+        FleetReport<Value<R>> report;
+        report.devices.resize(clients.size());
+        auto started = Clock::now();
+
+        std::atomic<std::size_t> next{0};
+        auto worker = [&] {
+            for (std::size_t i; (i = next.fetch_add(1)) < clients.size();) {
+                auto& outcome = report.devices[i];
+                outcome.device = names[i];
+
+                auto begin = Clock::now();
+                {
+                    FortiAPI::Scope scope(clients[i]);
+                    FortiClient::Deadline deadline(options.timeout);
+                    outcome.result = invoke<R>(operation, *clients[i]);
+                }
+                outcome.latency = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - begin);
+                outcome.timed_out = !outcome.result && outcome.latency >= options.timeout;
+            }
+        };
+
+        {
+            auto count = std::min<std::size_t>(options.parallelism, clients.size());
+            std::vector<std::jthread> workers;
+            workers.reserve(count);
+            for (std::size_t t = 0; t < count; ++t) workers.emplace_back(worker);
+        }
+
+        report.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - started);
+        return report;
+    }
+};
+
+#endif //FORTI_API_FLEET_HPP
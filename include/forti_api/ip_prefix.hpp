@@ -0,0 +1,381 @@
+#ifndef FORTI_API_IP_PREFIX_HPP
+#define FORTI_API_IP_PREFIX_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// An IPv4 or IPv6 address in network byte order; IPv4 uses the first four bytes.
+struct IPAddress {
+    std::array<std::uint8_t, 16> bytes{};
+    bool v6 = false;
+
+    bool operator==(const IPAddress&) const = default;
+
+    [[nodiscard]] unsigned int bits() const { return v6 ? 128 : 32; }
+    [[nodiscard]] bool bit(unsigned int i) const { return bytes[i / 8] >> (7 - i % 8) & 1; }
+
+    // Strict dotted quad: four decimal octets, no leading '+', nothing trailing.
+    static std::optional<IPAddress> parse_v4(std::string_view text) {
+        IPAddress address;
+        for (int octet = 0; octet < 4; ++octet) {
+            auto dot = octet < 3 ? text.find('.') : text.size();
+            if (dot == std::string_view::npos || dot == 0 || dot > 3) return std::nullopt;
+            unsigned int value = 0;
+            auto [end, error] = std::from_chars(text.data(), text.data() + dot, value);
+            if (error != std::errc{} || end != text.data() + dot || value > 255) return std::nullopt;
+            address.bytes[octet] = static_cast<std::uint8_t>(value);
+            text = octet < 3 ? text.substr(dot + 1) : std::string_view{};
+        }
+        return address;
+    }
+
+    // RFC 4291 text forms: eight groups, "::" compression and an embedded IPv4 tail (::ffff:10.0.0.1).
+    // Zone ids aren't accepted.
+    static std::optional<IPAddress> parse_v6(std::string_view text) {
+        std::array<std::uint16_t, 8> head{}, tail{};
+        std::size_t head_count = 0, tail_count = 0;
+
+        auto compression = text.find("::");
+        if (compression == std::string_view::npos) {
+            if (!parse_groups(text, head, head_count, true) || head_count != 8) return std::nullopt;
+        } else {
+            auto rest = text.substr(compression + 2);
+            if (rest.find("::") != std::string_view::npos) return std::nullopt;
+            if (!parse_groups(text.substr(0, compression), head, head_count, false) ||
+                !parse_groups(rest, tail, tail_count, true) || head_count + tail_count > 7)
+                return std::nullopt;
+        }
+
+        IPAddress address;
+        address.v6 = true;
+        for (std::size_t i = 0; i < head_count; ++i) address.set_group(i, head[i]);
+        for (std::size_t i = 0; i < tail_count; ++i) address.set_group(8 - tail_count + i, tail[i]);
+        return address;
+    }
+
+    static std::optional<IPAddress> parse(std::string_view text) {
+        return text.find(':') == std::string_view::npos ? parse_v4(text) : parse_v6(text);
+    }
+
+    static IPAddress from_v4(std::uint32_t value) {
+        IPAddress address;
+        for (int i = 0; i < 4; ++i) address.bytes[i] = static_cast<std::uint8_t>(value >> (24 - 8 * i));
+        return address;
+    }
+
+    [[nodiscard]] std::uint32_t v4() const {
+        return std::uint32_t{bytes[0]} << 24 | std::uint32_t{bytes[1]} << 16 | std::uint32_t{bytes[2]} << 8 | bytes[3];
+    }
+
+    // Dotted quad, or RFC 5952 canonical IPv6 (lowercase, longest zero run compressed).
+    [[nodiscard]] std::string to_string() const {
+        std::string out;
+        if (!v6) {
+            for (int i = 0; i < 4; ++i) {
+                if (i) out += '.';
+                out += std::to_string(bytes[i]);
+            }
+            return out;
+        }
+
+        std::size_t run_start = 8, run_length = 1;
+        for (std::size_t i = 0; i < 8;) {
+            std::size_t j = i;
+            while (j < 8 && group(j) == 0) ++j;
+            if (j - i > run_length) run_start = i, run_length = j - i;
+            i = j == i ? i + 1 : j;
+        }
+
+        for (std::size_t i = 0; i < 8; ++i) {
+            if (i == run_start) {
+                out += "::";
+                i += run_length - 1;
+                continue;
+            }
+            if (!out.empty() && out.back() != ':') out += ':';
+            char hex[4];
+            auto [end, error] = std::to_chars(hex, hex + 4, group(i), 16);
+            out.append(hex, end);
+        }
+        return out;
+    }
+
+private:
+    [[nodiscard]] std::uint16_t group(std::size_t i) const {
+        return static_cast<std::uint16_t>(bytes[2 * i] << 8 | bytes[2 * i + 1]);
+    }
+
+    void set_group(std::size_t i, std::uint16_t value) {
+        bytes[2 * i] = static_cast<std::uint8_t>(value >> 8);
+        bytes[2 * i + 1] = static_cast<std::uint8_t>(value);
+    }
+
+    // Colon separated hex groups; with embedded_v4 the last one may be a dotted quad counting as two.
+    static bool parse_groups(std::string_view text, std::array<std::uint16_t, 8>& out, std::size_t& count,
+                             bool embedded_v4) {
+        count = 0;
+        if (text.empty()) return true;
+        while (true) {
+            auto colon = text.find(':');
+            auto token = text.substr(0, colon);
+            if (colon == std::string_view::npos && token.find('.') != std::string_view::npos) {
+                auto embedded = parse_v4(token);
+                if (!embedded_v4 || !embedded || count > 6) return false;
+                out[count++] = static_cast<std::uint16_t>(embedded->v4() >> 16);
+                out[count++] = static_cast<std::uint16_t>(embedded->v4());
+                return true;
+            }
+
+            unsigned int value = 0;
+            if (token.empty() || token.size() > 4 || count == 8) return false;
+            auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value, 16);
+            if (error != std::errc{} || end != token.data() + token.size()) return false;
+            out[count++] = static_cast<std::uint16_t>(value);
+
+            if (colon == std::string_view::npos) return true;
+            text = text.substr(colon + 1);
+        }
+    }
+};
+
+// An address block: the network address with host bits cleared and the prefix length.
+struct IPPrefix {
+    IPAddress address;
+    unsigned int length{};
+
+    bool operator==(const IPPrefix&) const = default;
+
+    // Accepts a bare address (a host route), "addr/len", and for IPv4 also the netmask forms FortiOS
+    // uses, "addr mask" and "addr/mask". Non-contiguous masks are rejected; host bits are cleared.
+    static std::optional<IPPrefix> parse(std::string_view text) {
+        while (!text.empty() && text.front() == ' ') text.remove_prefix(1);
+        while (!text.empty() && text.back() == ' ') text.remove_suffix(1);
+
+        auto separator = text.find_first_of(" /");
+        auto address = IPAddress::parse(text.substr(0, separator));
+        if (!address) return std::nullopt;
+        if (separator == std::string_view::npos) return IPPrefix{*address, address->bits()};
+
+        auto rest = text.substr(separator + 1);
+        while (!rest.empty() && rest.front() == ' ') rest.remove_prefix(1);
+
+        unsigned int length = 0;
+        if (rest.find('.') != std::string_view::npos) {
+            auto mask = IPAddress::parse_v4(rest);
+            if (!mask || address->v6) return std::nullopt;
+            auto inverted = ~mask->v4();
+            if (inverted & (inverted + 1)) return std::nullopt;
+            length = static_cast<unsigned int>(std::popcount(mask->v4()));
+        } else {
+            if (text[separator] != '/') return std::nullopt;
+            auto [end, error] = std::from_chars(rest.data(), rest.data() + rest.size(), length);
+            if (rest.empty() || error != std::errc{} || end != rest.data() + rest.size() || length > address->bits())
+                return std::nullopt;
+        }
+
+        IPPrefix prefix{*address, length};
+        prefix.clear_host_bits();
+        return prefix;
+    }
+
+    [[nodiscard]] bool contains(const IPAddress& other) const {
+        if (other.v6 != address.v6) return false;
+        auto whole = length / 8;
+        if (!std::equal(address.bytes.begin(), address.bytes.begin() + whole, other.bytes.begin())) return false;
+        if (auto rest = length % 8) {
+            auto mask = static_cast<std::uint8_t>(0xff << (8 - rest));
+            return (other.bytes[whole] & mask) == address.bytes[whole];
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool contains(const IPPrefix& other) const { return other.length >= length && contains(other.address); }
+
+    [[nodiscard]] std::string to_string() const { return address.to_string() + '/' + std::to_string(length); }
+
+    // The form FortiOS stores trusthosts in: "10.0.0.0 255.255.255.0" for IPv4, "2001:db8::/32" for IPv6.
+    [[nodiscard]] std::string to_trusthost() const {
+        if (address.v6) return to_string();
+        auto mask = length ? ~std::uint32_t{0} << (32 - length) : 0;
+        return address.to_string() + ' ' + IPAddress::from_v4(mask).to_string();
+    }
+
+private:
+    void clear_host_bits() {
+        for (unsigned int i = length; i < address.bits(); ++i)
+            address.bytes[i / 8] &= static_cast<std::uint8_t>(~(0x80 >> (i % 8)));
+    }
+};
+
+// Set of IPv4 and IPv6 prefixes in a binary trie with one bit per level. Inserting a prefix that an
+// existing one covers is a no-op and inserting one that covers existing prefixes replaces them, so the
+// set always holds the minimal list describing its addresses. Lookups walk at most 32/128 nodes and
+// never allocate.
+class PrefixSet {
+    static constexpr std::uint32_t none = 0;  // roots are never children, so 0 can mean "no child"
+
+    struct Node {
+        std::array<std::uint32_t, 2> child{none, none};
+        bool terminal = false;
+    };
+
+    std::vector<Node> nodes{2};  // [0] IPv4 root, [1] IPv6 root
+    std::vector<std::uint32_t> free_nodes;
+    std::size_t count = 0;
+
+    static std::uint32_t root(const IPAddress& address) { return address.v6 ? 1 : 0; }
+
+    std::uint32_t allocate() {
+        if (!free_nodes.empty()) {
+            auto index = free_nodes.back();
+            free_nodes.pop_back();
+            nodes[index] = {};
+            return index;
+        }
+        nodes.emplace_back();
+        return static_cast<std::uint32_t>(nodes.size() - 1);
+    }
+
+    // Frees everything below node, returning how many prefixes went with it.
+    std::size_t release_children(std::uint32_t node) {
+        std::size_t released = 0;
+        std::vector<std::uint32_t> pending;
+        for (auto child : nodes[node].child) if (child != none) pending.push_back(child);
+        nodes[node].child = {none, none};
+
+        while (!pending.empty()) {
+            auto index = pending.back();
+            pending.pop_back();
+            released += nodes[index].terminal;
+            for (auto child : nodes[index].child) if (child != none) pending.push_back(child);
+            free_nodes.push_back(index);
+        }
+        return released;
+    }
+
+    void collect(std::uint32_t node, IPPrefix& prefix, std::vector<IPPrefix>& out) const {
+        if (nodes[node].terminal) {
+            out.push_back(prefix);
+            return;
+        }
+        for (std::uint8_t side = 0; side < 2; ++side) {
+            auto child = nodes[node].child[side];
+            if (child == none) continue;
+            auto i = prefix.length++;
+            if (side) prefix.address.bytes[i / 8] |= static_cast<std::uint8_t>(0x80 >> (i % 8));
+            collect(child, prefix, out);
+            prefix.address.bytes[i / 8] &= static_cast<std::uint8_t>(~(0x80 >> (i % 8)));
+            --prefix.length;
+        }
+    }
+
+public:
+    // False when the prefix was already covered.
+    bool insert(const IPPrefix& prefix) {
+        auto node = root(prefix.address);
+        for (unsigned int i = 0; i < prefix.length; ++i) {
+            if (nodes[node].terminal) return false;
+            auto side = prefix.address.bit(i);
+            if (nodes[node].child[side] == none) {
+                auto child = allocate();
+                nodes[node].child[side] = child;
+            }
+            node = nodes[node].child[side];
+        }
+        if (nodes[node].terminal) return false;
+
+        count -= release_children(node);
+        nodes[node].terminal = true;
+        ++count;
+        return true;
+    }
+
+    // Removes exactly this prefix; addresses it shared with a covering prefix stay covered.
+    bool erase(const IPPrefix& prefix) {
+        std::array<std::uint32_t, 129> path{};
+        path[0] = root(prefix.address);
+        for (unsigned int i = 0; i < prefix.length; ++i) {
+            path[i + 1] = nodes[path[i]].child[prefix.address.bit(i)];
+            if (path[i + 1] == none) return false;
+        }
+
+        auto depth = prefix.length;
+        if (!nodes[path[depth]].terminal) return false;
+        nodes[path[depth]].terminal = false;
+        --count;
+
+        // drop the now empty branch
+        for (; depth > 0; --depth) {
+            const auto& node = nodes[path[depth]];
+            if (node.terminal || node.child[0] != none || node.child[1] != none) break;
+            nodes[path[depth - 1]].child[prefix.address.bit(depth - 1)] = none;
+            free_nodes.push_back(path[depth]);
+        }
+        return true;
+    }
+
+    // Whether exactly this prefix is in the set.
+    [[nodiscard]] bool contains(const IPPrefix& prefix) const {
+        auto node = root(prefix.address);
+        for (unsigned int i = 0; i < prefix.length; ++i) {
+            node = nodes[node].child[prefix.address.bit(i)];
+            if (node == none) return false;
+        }
+        return nodes[node].terminal;
+    }
+
+    // Whether any prefix of the set lies inside prefix (or is it).
+    [[nodiscard]] bool overlaps_within(const IPPrefix& prefix) const {
+        auto node = root(prefix.address);
+        for (unsigned int i = 0; i < prefix.length; ++i) {
+            node = nodes[node].child[prefix.address.bit(i)];
+            if (node == none) return false;
+        }
+        return nodes[node].terminal || nodes[node].child[0] != none || nodes[node].child[1] != none;
+    }
+
+    [[nodiscard]] bool covers(const IPAddress& address) const {
+        return covers(IPPrefix{address, address.bits()});
+    }
+
+    // True when some prefix of the set contains all of prefix.
+    [[nodiscard]] bool covers(const IPPrefix& prefix) const {
+        auto node = root(prefix.address);
+        for (unsigned int i = 0;; ++i) {
+            if (nodes[node].terminal) return true;
+            if (i == prefix.length) return false;
+            node = nodes[node].child[prefix.address.bit(i)];
+            if (node == none) return false;
+        }
+    }
+
+    // The minimal prefix list, IPv4 before IPv6, each in address order.
+    [[nodiscard]] std::vector<IPPrefix> prefixes() const {
+        std::vector<IPPrefix> out;
+        out.reserve(count);
+        IPPrefix v4{}, v6{};
+        v6.address.v6 = true;
+        collect(0, v4, out);
+        collect(1, v6, out);
+        return out;
+    }
+
+    [[nodiscard]] std::size_t size() const { return count; }
+    [[nodiscard]] bool empty() const { return count == 0; }
+
+    void clear() {
+        nodes.assign(2, {});
+        free_nodes.clear();
+        count = 0;
+    }
+};
+
+#endif //FORTI_API_IP_PREFIX_HPP
@@ -0,0 +1,290 @@
+#ifndef FORTI_API_METRICS_HPP
+#define FORTI_API_METRICS_HPP
+
+#include <time.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+// Where one request's wall time went, from curl's timing info. dns, connect and tls are the durations of
+// those phases and only mean something when new_connection is set; ttfb and total are measured from the
+// start.
+struct RequestTiming {
+    std::chrono::microseconds dns{}, connect{}, tls{}, ttfb{}, total{};
+    std::uint64_t bytes_sent{}, bytes_received{};
+    bool new_connection{};
+};
+
+// CPU time used by the calling thread so far, for costing work that may be preempted (JSON decoding).
+inline std::chrono::nanoseconds thread_cpu_time() {
+    timespec now{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec);
+}
+
+struct HistogramSnapshot {
+    static constexpr std::size_t buckets = 22;
+
+    std::array<std::uint64_t, buckets + 1> counts{};  // last one is everything past the largest bound
+    std::uint64_t count{};
+    std::chrono::microseconds sum{};
+
+    static constexpr std::chrono::microseconds bound(std::size_t bucket) {
+        return std::chrono::microseconds(std::int64_t{25} << bucket);
+    }
+
+    // Upper bound of the bucket holding quantile q, so an over-estimate by at most 2x.
+    [[nodiscard]] std::chrono::microseconds quantile(double q) const {
+        if (count == 0) return {};
+        auto rank = static_cast<std::uint64_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(count - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < buckets; ++i)
+            if ((seen += counts[i]) >= rank) return bound(i);
+        return bound(buckets - 1) * 2;
+    }
+
+    [[nodiscard]] std::chrono::microseconds mean() const {
+        return count ? sum / static_cast<std::int64_t>(count) : std::chrono::microseconds{};
+    }
+};
+
+// Log-scale latency histogram, 25us to ~52s in powers of two. Recording is a few relaxed atomic adds,
+// so any number of threads can record without coordinating; snapshots may be torn by in-flight records.
+class LatencyHistogram {
+    std::array<std::atomic<std::uint64_t>, HistogramSnapshot::buckets + 1> counts{};
+    std::atomic<std::uint64_t> count{0}, sum_us{0};
+
+public:
+    static constexpr std::size_t bucket_of(std::chrono::microseconds value) {
+        auto us = static_cast<std::uint64_t>(std::max<std::int64_t>(value.count(), 0));
+        if (us <= 25) return 0;
+        return std::min<std::size_t>(std::bit_width((us - 1) / 25), HistogramSnapshot::buckets);
+    }
+
+    void record(std::chrono::microseconds value) {
+        counts[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+        sum_us.fetch_add(static_cast<std::uint64_t>(std::max<std::int64_t>(value.count(), 0)), std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void reset() {
+        for (auto& bucket : counts) bucket.store(0, std::memory_order_relaxed);
+        count.store(0, std::memory_order_relaxed);
+        sum_us.store(0, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] HistogramSnapshot snapshot() const {
+        HistogramSnapshot snapshot;
+        for (std::size_t i = 0; i < counts.size(); ++i) snapshot.counts[i] = counts[i].load(std::memory_order_relaxed);
+        snapshot.count = count.load(std::memory_order_relaxed);
+        snapshot.sum = std::chrono::microseconds(sum_us.load(std::memory_order_relaxed));
+        return snapshot;
+    }
+};
+
+// One label set: the device, the method, the path with object names and ids folded away, and the HTTP
+// status (0 when the request never got an answer).
+struct SeriesKey {
+    std::string device, method, path;
+    long status{};
+
+    auto operator<=>(const SeriesKey&) const = default;
+};
+
+struct SeriesSnapshot {
+    SeriesKey key;
+    std::uint64_t requests{}, bytes_sent{}, bytes_received{};
+    HistogramSnapshot total, dns, connect, tls, ttfb, decode;
+};
+
+// Process-wide per-request metrics: counters and phase histograms per SeriesKey, and the CPU time spent
+// decoding each response. Every FortiClient records into it; export with openmetrics() for Prometheus
+// or read snapshot() directly.
+class RequestMetrics {
+    struct Series {
+        std::atomic<std::uint64_t> requests{0}, bytes_sent{0}, bytes_received{0};
+        LatencyHistogram total, dns, connect, tls, ttfb, decode;
+
+        void reset() {
+            for (auto* counter : {&requests, &bytes_sent, &bytes_received}) counter->store(0, std::memory_order_relaxed);
+            for (auto* histogram : {&total, &dns, &connect, &tls, &ttfb, &decode}) histogram->reset();
+        }
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const SeriesKey& key) const {
+            auto h = std::hash<std::string_view>{};
+            return h(key.device) ^ (h(key.method) << 1) ^ (h(key.path) << 2) ^ std::hash<long>{}(key.status) << 3;
+        }
+    };
+
+    inline static std::shared_mutex mutex;
+    inline static std::unordered_map<SeriesKey, std::unique_ptr<Series>, KeyHash> series;
+    inline static std::atomic<bool> enabled{true};
+
+    // Series are never removed while the process runs (reset() only zeroes them), so the reference
+    // stays valid after the lock is dropped.
+    static Series& find(SeriesKey key) {
+        {
+            std::shared_lock lock(mutex);
+            if (auto it = series.find(key); it != series.end()) return *it->second;
+        }
+        std::unique_lock lock(mutex);
+        auto& slot = series[std::move(key)];
+        if (!slot) slot = std::make_unique<Series>();
+        return *slot;
+    }
+
+    static std::string escape(std::string_view value) {
+        std::string out;
+        for (char c : value) {
+            if (c == '"' || c == '\\') out += '\\';
+            if (c == '\n') out += "\\n";
+            else out += c;
+        }
+        return out;
+    }
+
+    static void write_histogram(std::string& out, std::string_view name, const std::string& labels,
+                                const HistogramSnapshot& histogram) {
+        std::uint64_t cumulative = 0;
+        for (std::size_t i = 0; i < HistogramSnapshot::buckets; ++i) {
+            cumulative += histogram.counts[i];
+            auto le = std::chrono::duration<double>(HistogramSnapshot::bound(i)).count();
+            out += std::format("{}_bucket{{{},le=\"{}\"}} {}\n", name, labels, le, cumulative);
+        }
+        cumulative += histogram.counts[HistogramSnapshot::buckets];
+        out += std::format("{}_bucket{{{},le=\"+Inf\"}} {}\n", name, labels, cumulative);
+        out += std::format("{}_sum{{{}}} {}\n", name, labels, std::chrono::duration<double>(histogram.sum).count());
+        out += std::format("{}_count{{{}}} {}\n", name, labels, cumulative);
+    }
+
+public:
+    // Collapses the parts of a path that name an object, so series stay few: the query is dropped and
+    // every segment past the endpoint becomes {id}, past the table for CMDB (/cmdb/<path>/<name>/...)
+    // and past the action for monitor paths (/monitor/<path>/<name>/<action>/<mkey>...).
+    static std::string path_template(std::string_view path) {
+        path = path.substr(0, path.find('?'));
+        std::size_t kept;
+        if (path.starts_with("/cmdb/")) kept = 3;
+        else if (path.starts_with("/monitor/")) kept = 4;
+        else return std::string(path);
+
+        std::string result;
+        std::size_t segment = 0, start = 1;
+        while (start < path.size()) {
+            auto end = std::min(path.find('/', start), path.size());
+            result += '/';
+            result += ++segment > kept ? std::string_view("{id}") : path.substr(start, end - start);
+            start = end + 1;
+        }
+        return result;
+    }
+
+    static void set_enabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+    static bool is_enabled() { return enabled.load(std::memory_order_relaxed); }
+
+    static void record(const std::string& device, std::string_view method, std::string_view path, long status,
+                       const RequestTiming& timing) {
+        if (!is_enabled()) return;
+        auto& s = find({device, std::string(method), path_template(path), status});
+        s.requests.fetch_add(1, std::memory_order_relaxed);
+        s.bytes_sent.fetch_add(timing.bytes_sent, std::memory_order_relaxed);
+        s.bytes_received.fetch_add(timing.bytes_received, std::memory_order_relaxed);
+        s.total.record(timing.total);
+        if (timing.new_connection) {  // a reused connection never ran these phases
+            s.dns.record(timing.dns);
+            s.connect.record(timing.connect);
+            s.tls.record(timing.tls);
+        }
+        s.ttfb.record(timing.ttfb);
+    }
+
+    static void record_decode(const std::string& device, std::string_view method, std::string_view path, long status,
+                              std::chrono::nanoseconds cpu) {
+        if (!is_enabled()) return;
+        find({device, std::string(method), path_template(path), status})
+                .decode.record(std::chrono::duration_cast<std::chrono::microseconds>(cpu));
+    }
+
+    // Sorted by key.
+    static std::vector<SeriesSnapshot> snapshot() {
+        std::vector<SeriesSnapshot> result;
+        {
+            std::shared_lock lock(mutex);
+            result.reserve(series.size());
+            for (const auto& [key, s] : series)
+                result.push_back({key, s->requests.load(std::memory_order_relaxed),
+                                  s->bytes_sent.load(std::memory_order_relaxed),
+                                  s->bytes_received.load(std::memory_order_relaxed), s->total.snapshot(),
+                                  s->dns.snapshot(), s->connect.snapshot(), s->tls.snapshot(), s->ttfb.snapshot(),
+                                  s->decode.snapshot()});
+        }
+        std::ranges::sort(result, {}, &SeriesSnapshot::key);
+        return result;
+    }
+
+    // Zeroes every series in place; records racing with it may land on either side.
+    static void reset() {
+        std::shared_lock lock(mutex);
+        for (auto& [_, s] : series) s->reset();
+    }
+
+    // OpenMetrics text exposition of everything recorded so far, terminated by # EOF.
+    static std::string openmetrics() {
+        auto all = snapshot();
+        std::string out;
+
+        auto labels = [](const SeriesKey& key) {
+            return std::format("device=\"{}\",method=\"{}\",path=\"{}\",status=\"{}\"", escape(key.device),
+                               escape(key.method), escape(key.path), key.status);
+        };
+
+        out += "# TYPE forti_api_requests counter\n# HELP forti_api_requests Requests sent to the device.\n";
+        for (const auto& s : all) out += std::format("forti_api_requests_total{{{}}} {}\n", labels(s.key), s.requests);
+
+        out += "# TYPE forti_api_request_sent_bytes counter\n# UNIT forti_api_request_sent_bytes bytes\n";
+        for (const auto& s : all)
+            out += std::format("forti_api_request_sent_bytes_total{{{}}} {}\n", labels(s.key), s.bytes_sent);
+
+        out += "# TYPE forti_api_request_received_bytes counter\n# UNIT forti_api_request_received_bytes bytes\n";
+        for (const auto& s : all)
+            out += std::format("forti_api_request_received_bytes_total{{{}}} {}\n", labels(s.key), s.bytes_received);
+
+        out += "# TYPE forti_api_request_duration_seconds histogram\n"
+               "# UNIT forti_api_request_duration_seconds seconds\n";
+        for (const auto& s : all) write_histogram(out, "forti_api_request_duration_seconds", labels(s.key), s.total);
+
+        out += "# TYPE forti_api_request_phase_seconds histogram\n# UNIT forti_api_request_phase_seconds seconds\n";
+        for (const auto& s : all) {
+            for (auto [phase, histogram] : {std::pair{"dns", &s.dns}, {"connect", &s.connect}, {"tls", &s.tls},
+                                            {"ttfb", &s.ttfb}}) {
+                if (histogram->count)
+                    write_histogram(out, "forti_api_request_phase_seconds",
+                                    std::format("{},phase=\"{}\"", labels(s.key), phase), *histogram);
+            }
+        }
+
+        out += "# TYPE forti_api_decode_cpu_seconds histogram\n# UNIT forti_api_decode_cpu_seconds seconds\n";
+        for (const auto& s : all) {
+            if (s.decode.count) write_histogram(out, "forti_api_decode_cpu_seconds", labels(s.key), s.decode);
+        }
+
+        out += "# EOF\n";
+        return out;
+    }
+};
+
+#endif //FORTI_API_METRICS_HPP
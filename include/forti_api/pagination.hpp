@@ -0,0 +1,175 @@
+#ifndef FORTI_API_PAGINATION_HPP
+#define FORTI_API_PAGINATION_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <format>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "api.hpp"
+
+
+// Appends a query parameter string to a path that may already carry one.
+inline std::string with_query(std::string_view path, std::string_view query) {
+    std::string result(path);
+    if (query.empty()) return result;
+    result += path.find('?') == std::string_view::npos ? '?' : '&';
+    result += query;
+    return result;
+}
+
+// Input range over a CMDB collection fetched `page_size` entries at a time with FortiOS start/count
+// parameters. While the caller works through one page the next is already being fetched, so only two
+// pages are ever held in memory. Leaving a loop early cancels that prefetch instead of waiting for it.
+template<typename ResponseType, typename Item = typename decltype(ResponseType::results)::value_type>
+class PagedRange {
+public:
+    using Extract = std::function<std::vector<Item>(ResponseType&&)>;
+
+private:
+    struct State {
+        std::string path;
+        unsigned int page_size;
+        Extract extract;
+        std::vector<Item> page;
+        std::size_t index = 0;
+        unsigned int next_start = 0;
+        bool last_page = false;
+        std::future<ResponseType> pending;
+
+        // The prefetch worker, one per pass: it fetches each page it's asked for with the caller's client
+        // and deadline, and its transfers are cancelled through abandoned.
+        std::shared_ptr<FortiClient> client = FortiAPI::client();
+        std::optional<std::chrono::steady_clock::time_point> deadline = FortiClient::current_deadline();
+        std::shared_ptr<std::atomic<bool>> abandoned = std::make_shared<std::atomic<bool>>(false);
+        std::mutex mutex;
+        std::condition_variable requested;
+        std::optional<std::pair<unsigned int, std::promise<ResponseType>>> next;
+        std::thread worker;
+
+        State(std::string path, unsigned int page_size, Extract extract) :
+                path(std::move(path)), page_size(page_size), extract(std::move(extract)) {}
+
+        State(const State&) = delete;
+        State& operator=(const State&) = delete;
+
+        ~State() {
+            {
+                std::lock_guard lock(mutex);
+                abandoned->store(true);
+            }
+            requested.notify_one();
+            if (worker.joinable()) worker.join();
+        }
+
+        void run() {
+            FortiClient::Cancellation cancellation(abandoned);
+            std::optional<FortiClient::Deadline> bound;
+            if (deadline) bound.emplace(*deadline);
+
+            for (std::unique_lock lock(mutex);;) {
+                requested.wait(lock, [this] { return next || abandoned->load(); });
+                if (abandoned->load()) return;
+                auto [start, promise] = std::move(*next);
+                next.reset();
+                lock.unlock();
+                try {
+                    promise.set_value(client->template get<ResponseType>(
+                            with_query(path, std::format("start={}&count={}", start, page_size))));
+                } catch (...) {
+                    promise.set_exception(std::current_exception());
+                }
+                lock.lock();
+            }
+        }
+
+        std::future<ResponseType> fetch(unsigned int start) {
+            std::promise<ResponseType> promise;
+            auto future = promise.get_future();
+            {
+                std::lock_guard lock(mutex);
+                next.emplace(start, std::move(promise));
+            }
+            requested.notify_one();
+            if (!worker.joinable()) worker = std::thread([this] { run(); });
+            return future;
+        }
+
+        // Waits for the prefetched page, kicks off the one after it, returns false once exhausted.
+        bool advance() {
+            while (index >= page.size()) {
+                if (!pending.valid()) return false;
+
+                auto response = pending.get();
+                unsigned int total = response.matched_count;
+                page = extract(std::move(response));
+                index = 0;
+                next_start += static_cast<unsigned int>(page.size());
+
+                last_page = page.size() < page_size || (total && next_start >= total);
+                if (!last_page) pending = fetch(next_start);
+                if (page.empty()) return false;
+            }
+            return true;
+        }
+    };
+
+    std::string path;
+    unsigned int page_size;
+    Extract extract;
+
+public:
+    class iterator {
+        std::shared_ptr<State> state;
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Item;
+        using difference_type = std::ptrdiff_t;
+        using reference = Item&;
+        using pointer = Item*;
+
+        iterator() = default;
+        explicit iterator(std::shared_ptr<State> state) : state(std::move(state)) {
+            if (!this->state->advance()) this->state.reset();
+        }
+
+        reference operator*() const { return state->page[state->index]; }
+        pointer operator->() const { return &state->page[state->index]; }
+
+        iterator& operator++() {
+            ++state->index;
+            if (!state->advance()) state.reset();
+            return *this;
+        }
+
+        void operator++(int) { ++*this; }
+
+        bool operator==(std::default_sentinel_t) const { return !state; }
+    };
+
+    explicit PagedRange(std::string path, unsigned int page_size = 1000,
+                        Extract extract = [](ResponseType&& response) { return std::move(response.results); }) :
+            path(std::move(path)), page_size(page_size ? page_size : 1), extract(std::move(extract)) {}
+
+    // Each call starts a fresh pass from the first entry.
+    [[nodiscard]] iterator begin() const {
+        auto state = std::make_shared<State>(path, page_size, extract);
+        state->pending = state->fetch(0);
+        return iterator(std::move(state));
+    }
+
+    [[nodiscard]] std::default_sentinel_t end() const { return std::default_sentinel; }
+};
+
+#endif //FORTI_API_PAGINATION_HPP
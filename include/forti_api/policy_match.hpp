@@ -0,0 +1,390 @@
+#ifndef FORTI_API_POLICY_MATCH_HPP
+#define FORTI_API_POLICY_MATCH_HPP
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <format>
+#include <future>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "firewall.hpp"
+
+
+// IPv4 5-tuple as the match engine sees it; interfaces are ids from PolicyMatcher::interface_id().
+struct PacketTuple {
+    std::uint32_t srcintf{}, dstintf{}, src{}, dst{};
+    std::uint8_t protocol{};
+    std::uint16_t port{};
+};
+
+struct PolicyFinding {
+    enum class Kind { SHADOWED, REDUNDANT };
+
+    unsigned int policyid{}, covered_by{};
+    Kind kind{};
+};
+
+// One match dimension cut into elementary intervals: every distinct range boundary used by any rule
+// starts a new segment, and each segment stores the bitset of rules covering it. A lookup is one binary
+// search over the segment starts.
+class MatchDimension {
+public:
+    using Range = std::pair<std::uint32_t, std::uint32_t>;  // inclusive
+    static constexpr std::uint32_t max_key = std::numeric_limits<std::uint32_t>::max();
+
+private:
+    std::vector<std::uint32_t> starts;
+    std::vector<std::uint64_t> bits;
+    std::size_t words{};
+
+public:
+    MatchDimension() = default;
+
+    MatchDimension(const std::vector<std::vector<Range>>& rules, std::size_t words) : words(words) {
+        starts.push_back(0);
+        for (const auto& ranges : rules)
+            for (auto [low, high] : ranges) {
+                starts.push_back(low);
+                if (high != max_key) starts.push_back(high + 1);
+            }
+        std::sort(starts.begin(), starts.end());
+        starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+
+        bits.assign(starts.size() * words, 0);
+        for (std::size_t rule = 0; rule < rules.size(); ++rule)
+            for (auto [low, high] : rules[rule]) {
+                std::size_t last = high == max_key ? starts.size() - 1 : segment(high + 1) - 1;
+                for (std::size_t s = segment(low); s <= last; ++s)
+                    bits[s * words + rule / 64] |= std::uint64_t{1} << (rule % 64);
+            }
+    }
+
+    [[nodiscard]] std::size_t segment(std::uint32_t key) const {
+        return static_cast<std::size_t>(std::upper_bound(starts.begin(), starts.end(), key) - starts.begin()) - 1;
+    }
+
+    [[nodiscard]] const std::uint64_t* row(std::uint32_t key) const { return bits.data() + segment(key) * words; }
+    [[nodiscard]] const std::uint64_t* row_at(std::size_t segment) const { return bits.data() + segment * words; }
+    [[nodiscard]] std::size_t segments() const { return starts.size(); }
+};
+
+// Compiles an ordered policy list and the address/service objects it references into per-dimension
+// bitsets (srcintf, dstintf, srcaddr, dstaddr, service), so "which policy matches this packet" is five
+// segment lookups and a word-wise AND; the lowest set bit is the first match in list order.
+//
+// Only IPv4 addresses are modelled. Objects the engine can't resolve (fqdn, geography, missing) match
+// nothing. Negated addresses or services, users and groups, schedules other than "always" and
+// internet-service destinations aren't modelled either: match() compares such a rule on its other
+// dimensions alone, so its answer for them is only a candidate (see is_partial()). Partial rules are
+// left out of the shadowing analysis on both sides, as the rule covered and as the one covering it.
+class PolicyMatcher {
+public:
+    struct Objects {
+        std::vector<FirewallAddress> addresses;
+        std::vector<FirewallAddressGroup> address_groups;
+        std::vector<ServiceCustom> services;
+        std::vector<ServiceGroup> service_groups;
+    };
+
+    static constexpr std::uint32_t unknown_interface = MatchDimension::max_key;
+
+private:
+    using Range = MatchDimension::Range;
+    static constexpr Range everything{0, MatchDimension::max_key};
+    static constexpr unsigned int max_group_depth = 16;
+
+    std::vector<unsigned int> policyids;
+    std::vector<std::string> actions;
+    std::vector<bool> partial;
+    std::unordered_map<std::string, std::uint32_t> interfaces;
+    MatchDimension srcintf, dstintf, srcaddr, dstaddr, service;
+    std::size_t words{};
+
+    struct Resolver {
+        std::unordered_map<std::string_view, const FirewallAddress*> addresses;
+        std::unordered_map<std::string_view, const FirewallAddressGroup*> address_groups;
+        std::unordered_map<std::string_view, const ServiceCustom*> services;
+        std::unordered_map<std::string_view, const ServiceGroup*> service_groups;
+
+        explicit Resolver(const Objects& objects) {
+            for (const auto& object : objects.addresses) addresses.emplace(object.name, &object);
+            for (const auto& object : objects.address_groups) address_groups.emplace(object.name, &object);
+            for (const auto& object : objects.services) services.emplace(object.name, &object);
+            for (const auto& object : objects.service_groups) service_groups.emplace(object.name, &object);
+        }
+
+        void address(std::string_view name, std::vector<Range>& out, bool& incomplete, unsigned int depth = 0) const {
+            if (auto it = address_groups.find(name); it != address_groups.end() && depth < max_group_depth) {
+                for (const auto& member : it->second->member) address(member.name, out, incomplete, depth + 1);
+                return;
+            }
+            auto it = addresses.find(name);
+            if (it == addresses.end()) {
+                if (name == "all") out.push_back(everything);
+                else incomplete = true;
+                return;
+            }
+
+            const auto& object = *it->second;
+            if (object.type == "iprange") {
+                auto low = parse_ipv4(object.start_ip), high = parse_ipv4(object.end_ip);
+                if (low && high && *low <= *high) out.emplace_back(*low, *high);
+                else incomplete = true;
+            } else if (object.type.empty() || object.type == "ipmask") {
+                if (auto range = parse_subnet(object.subnet)) out.push_back(*range);
+                else incomplete = true;
+            } else incomplete = true;
+        }
+
+        void service(std::string_view name, std::vector<Range>& out, bool& incomplete, unsigned int depth = 0) const {
+            if (auto it = service_groups.find(name); it != service_groups.end() && depth < max_group_depth) {
+                for (const auto& member : it->second->member) service(member.name, out, incomplete, depth + 1);
+                return;
+            }
+            auto it = services.find(name);
+            if (it == services.end()) {
+                if (name == "ALL") out.push_back(everything);
+                else incomplete = true;
+                return;
+            }
+
+            const auto& object = *it->second;
+            if (object.protocol == "IP") {
+                if (object.protocol_number == 0) out.push_back(everything);
+                else out.push_back(protocol_range(object.protocol_number));
+            } else if (object.protocol == "ICMP") {
+                out.push_back(protocol_range(1));
+            } else if (object.protocol.starts_with("TCP/UDP")) {
+                parse_ports(6, object.tcp_portrange, out);
+                parse_ports(17, object.udp_portrange, out);
+                parse_ports(132, object.sctp_portrange, out);
+            } else incomplete = true;
+        }
+    };
+
+    // Services are keyed as protocol << 16 | destination port.
+    static Range protocol_range(unsigned int protocol) { return {protocol << 16, protocol << 16 | 0xFFFF}; }
+
+    static std::optional<std::uint16_t> parse_port(std::string_view text) {
+        unsigned int port = 0;
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), port);
+        if (error != std::errc{} || end != text.data() + text.size() || port > 0xFFFF) return std::nullopt;
+        return static_cast<std::uint16_t>(port);
+    }
+
+    // "80 443 1000-2000:1024-65535", where the optional part after ':' is the source port range.
+    static void parse_ports(unsigned int protocol, std::string_view list, std::vector<Range>& out) {
+        while (!list.empty()) {
+            auto space = list.find(' ');
+            auto item = list.substr(0, space);
+            list = space == std::string_view::npos ? std::string_view{} : list.substr(space + 1);
+
+            item = item.substr(0, item.find(':'));
+            if (item.empty()) continue;
+            auto dash = item.find('-');
+            auto low = parse_port(item.substr(0, dash));
+            auto high = dash == std::string_view::npos ? low : parse_port(item.substr(dash + 1));
+            if (low && high && *low <= *high) out.emplace_back(protocol << 16 | *low, protocol << 16 | *high);
+        }
+    }
+
+    static std::optional<Range> parse_subnet(std::string_view subnet) {
+        auto separator = subnet.find_first_of(" /");
+        auto address = parse_ipv4(subnet.substr(0, separator));
+        if (!address) return std::nullopt;
+        if (separator == std::string_view::npos) return Range{*address, *address};
+
+        std::uint32_t mask;
+        auto rest = subnet.substr(separator + 1);
+        if (subnet[separator] == '/') {
+            unsigned int length = 0;
+            auto [end, error] = std::from_chars(rest.data(), rest.data() + rest.size(), length);
+            if (error != std::errc{} || length > 32) return std::nullopt;
+            mask = length ? ~std::uint32_t{0} << (32 - length) : 0;
+        } else {
+            auto parsed = parse_ipv4(rest);
+            if (!parsed) return std::nullopt;
+            mask = *parsed;
+        }
+        return Range{*address & mask, (*address & mask) | ~mask};
+    }
+
+    // Whether every condition of the policy is one the engine evaluates.
+    static bool modelled(const FirewallPolicy& policy) {
+        return policy.srcaddr_negate != "enable" && policy.dstaddr_negate != "enable" &&
+               policy.service_negate != "enable" && policy.internet_service != "enable" && policy.users.empty() &&
+               policy.groups.empty() && (policy.schedule.empty() || policy.schedule == "always");
+    }
+
+    void bit_and(std::uint64_t* into, const std::uint64_t* row) const {
+        for (std::size_t w = 0; w < words; ++w) into[w] &= row[w];
+    }
+
+    // Rules whose set in this dimension contains everything rule covers.
+    void supersets(const MatchDimension& dimension, std::size_t rule, std::uint64_t* into) const {
+        std::uint64_t bit = std::uint64_t{1} << (rule % 64);
+        for (std::size_t s = 0; s < dimension.segments(); ++s) {
+            const auto* row = dimension.row_at(s);
+            if (row[rule / 64] & bit) bit_and(into, row);
+        }
+    }
+
+    [[nodiscard]] bool empty_in(const MatchDimension& dimension, std::size_t rule) const {
+        for (std::size_t s = 0; s < dimension.segments(); ++s)
+            if (dimension.row_at(s)[rule / 64] >> (rule % 64) & 1) return false;
+        return true;
+    }
+
+public:
+    static std::optional<std::uint32_t> parse_ipv4(std::string_view text) {
+        std::uint32_t address = 0;
+        for (int octet = 0; octet < 4; ++octet) {
+            auto dot = octet < 3 ? text.find('.') : text.size();
+            if (dot == std::string_view::npos) return std::nullopt;
+            unsigned int value = 0;
+            auto part = text.substr(0, dot);
+            auto [end, error] = std::from_chars(part.data(), part.data() + part.size(), value);
+            if (part.empty() || error != std::errc{} || end != part.data() + part.size() || value > 255)
+                return std::nullopt;
+            address = address << 8 | value;
+            text = octet < 3 ? text.substr(dot + 1) : std::string_view{};
+        }
+        return address;
+    }
+
+    PolicyMatcher(const std::vector<FirewallPolicy>& policies, const Objects& objects) {
+        Resolver resolver(objects);
+        std::vector<std::vector<Range>> src_interfaces, dst_interfaces, src_addresses, dst_addresses, services;
+
+        auto interface_ranges = [&](const std::vector<Interface>& list) {
+            std::vector<Range> ranges;
+            for (const auto& interface : list) {
+                if (interface.name == "any") ranges.push_back(everything);
+                else {
+                    auto id = interfaces.try_emplace(interface.name, static_cast<std::uint32_t>(interfaces.size())).first->second;
+                    ranges.emplace_back(id, id);
+                }
+            }
+            return ranges;
+        };
+
+        for (const auto& policy : policies) {
+            if (policy.status == "disable") continue;
+            policyids.push_back(policy.policyid);
+            actions.push_back(policy.action);
+
+            bool incomplete = false;
+            src_interfaces.push_back(interface_ranges(policy.srcintf));
+            dst_interfaces.push_back(interface_ranges(policy.dstintf));
+            auto& src = src_addresses.emplace_back();
+            for (const auto& address : policy.srcaddr) resolver.address(address.name, src, incomplete);
+            auto& dst = dst_addresses.emplace_back();
+            for (const auto& address : policy.dstaddr) resolver.address(address.name, dst, incomplete);
+            auto& ports = services.emplace_back();
+            for (const auto& entry : policy.service) resolver.service(entry.name, ports, incomplete);
+            partial.push_back(incomplete || !modelled(policy));
+        }
+
+        words = (policyids.size() + 63) / 64;
+        srcintf = MatchDimension(src_interfaces, words);
+        dstintf = MatchDimension(dst_interfaces, words);
+        srcaddr = MatchDimension(src_addresses, words);
+        dstaddr = MatchDimension(dst_addresses, words);
+        service = MatchDimension(services, words);
+    }
+
+    // Fetches the policy list and every object it can reference concurrently, then compiles them.
+    static PolicyMatcher fetch() {
+        auto on_client = [client = FortiAPI::client()](auto get) {
+            return std::async(std::launch::async, [client, get] {
+                FortiAPI::Scope scope(client);
+                return get();
+            });
+        };
+        auto policies = on_client([] { return FortiGate::Policy::get(); });
+        auto addresses = on_client(FortiGate::Objects::get_addresses);
+        auto address_groups = on_client(FortiGate::Objects::get_address_groups);
+        auto services = on_client(FortiGate::Objects::get_services);
+        auto service_groups = on_client(FortiGate::Objects::get_service_groups);
+        return PolicyMatcher(policies.get(), Objects{addresses.get(), address_groups.get(), services.get(),
+                                                     service_groups.get()});
+    }
+
+    // Unknown names get an id only "any" rules match.
+    [[nodiscard]] std::uint32_t interface_id(std::string_view name) const {
+        auto it = interfaces.find(std::string(name));
+        return it == interfaces.end() ? unknown_interface : it->second;
+    }
+
+    // Position in the compiled list of the first matching policy, nullopt for the implicit deny.
+    [[nodiscard]] std::optional<std::size_t> match_index(const PacketTuple& packet) const {
+        const std::uint64_t *a = srcintf.row(packet.srcintf), *b = dstintf.row(packet.dstintf),
+                *c = srcaddr.row(packet.src), *d = dstaddr.row(packet.dst),
+                *e = service.row(static_cast<std::uint32_t>(packet.protocol) << 16 | packet.port);
+        for (std::size_t w = 0; w < words; ++w) {
+            if (auto hit = a[w] & b[w] & c[w] & d[w] & e[w])
+                return w * 64 + static_cast<std::size_t>(std::countr_zero(hit));
+        }
+        return std::nullopt;
+    }
+
+    [[nodiscard]] std::optional<unsigned int> match(const PacketTuple& packet) const {
+        auto index = match_index(packet);
+        return index ? std::optional(policyids[*index]) : std::nullopt;
+    }
+
+    [[nodiscard]] std::optional<unsigned int> match(std::string_view src_interface, std::string_view dst_interface,
+                                                    std::string_view src, std::string_view dst,
+                                                    std::uint8_t protocol, std::uint16_t port = 0) const {
+        auto src_ip = parse_ipv4(src), dst_ip = parse_ipv4(dst);
+        if (!src_ip || !dst_ip) throw std::invalid_argument(std::format("Invalid IPv4 address: {} -> {}", src, dst));
+        return match({interface_id(src_interface), interface_id(dst_interface), *src_ip, *dst_ip, protocol, port});
+    }
+
+    // Rules an earlier rule fully covers in every dimension: SHADOWED when the earlier rule's action
+    // differs (the rule can never take effect), REDUNDANT when it's the same.
+    [[nodiscard]] std::vector<PolicyFinding> analyze() const {
+        std::vector<PolicyFinding> findings;
+        std::vector<std::uint64_t> cover(words);
+
+        for (std::size_t rule = 1; rule < policyids.size(); ++rule) {
+            if (partial[rule] || empty_in(srcaddr, rule) || empty_in(dstaddr, rule) || empty_in(service, rule) ||
+                empty_in(srcintf, rule) || empty_in(dstintf, rule))
+                continue;
+
+            // only earlier rules can cover this one
+            std::fill(cover.begin(), cover.end(), 0);
+            for (std::size_t w = 0; w < rule / 64; ++w) cover[w] = ~std::uint64_t{0};
+            cover[rule / 64] = (std::uint64_t{1} << (rule % 64)) - 1;
+
+            for (const auto* dimension : {&srcintf, &dstintf, &srcaddr, &dstaddr, &service})
+                supersets(*dimension, rule, cover.data());
+            for (std::size_t earlier = 0; earlier < rule; ++earlier)
+                if (partial[earlier]) cover[earlier / 64] &= ~(std::uint64_t{1} << (earlier % 64));
+
+            for (std::size_t w = 0; w < words; ++w) {
+                if (!cover[w]) continue;
+                auto earlier = w * 64 + static_cast<std::size_t>(std::countr_zero(cover[w]));
+                findings.push_back({policyids[rule], policyids[earlier], actions[earlier] == actions[rule] ?
+                                    PolicyFinding::Kind::REDUNDANT : PolicyFinding::Kind::SHADOWED});
+                break;
+            }
+        }
+        return findings;
+    }
+
+    // Whether the rule at this position has conditions match() didn't check.
+    [[nodiscard]] bool is_partial(std::size_t index) const { return partial[index]; }
+
+    [[nodiscard]] std::size_t size() const { return policyids.size(); }
+};
+
+#endif //FORTI_API_POLICY_MATCH_HPP
@@ -0,0 +1,309 @@
+#ifndef FORTI_API_RECONCILER_HPP
+#define FORTI_API_RECONCILER_HPP
+
+#include <algorithm>
+#include <future>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "api.hpp"
+#include "dns_filter.hpp"
+#include "firewall.hpp"
+#include "threat_feed.hpp"
+
+
+// The objects a deploy manages. Each object is complete: every field it declares is what the device
+// should hold, empty strings included.
+struct ConfigState {
+    std::vector<PushThreatFeed> threat_feeds;
+    std::vector<DNSProfile> dns_profiles;
+    std::vector<FirewallPolicy> firewall_policies;
+};
+
+struct ReconcileOptions {
+    bool dry_run = false;
+    // Delete threat feeds and DNS profiles the desired state doesn't mention. The device refuses to delete
+    // a feed whose category a profile still sets, so the categories of pruned feeds are allowed in the
+    // desired profiles too; profiles outside the desired state are deleted before the feeds.
+    bool prune = false;
+};
+
+enum class ChangeKind {
+    CREATE,
+    UPDATE,
+    DELETE,
+};
+
+// One wire field that differs; before is null on create, after is null when the field goes away.
+struct FieldChange {
+    std::string field;
+    nlohmann::json before, after;
+};
+
+// Changes run in stage order, so nothing is created before what it references and nothing is deleted
+// while something still references it: feeds before the profiles blocking their category, profiles
+// before the policies using them, and deletions the other way round.
+enum class ChangeStage : unsigned int {
+    WRITE_FEEDS,
+    WRITE_PROFILES,
+    WRITE_POLICIES,
+    DELETE_PROFILES,
+    DELETE_FEEDS,
+};
+
+struct PlannedChange {
+    std::string module, name;
+    ChangeKind kind = ChangeKind::UPDATE;
+    ChangeStage stage = ChangeStage::WRITE_FEEDS;
+    std::vector<FieldChange> fields;
+    BatchRequest request;
+};
+
+struct ReconcilePlan {
+    std::vector<PlannedChange> changes;  // stage order
+
+    [[nodiscard]] bool empty() const { return changes.empty(); }
+
+    [[nodiscard]] std::size_t count(ChangeKind kind) const {
+        return static_cast<std::size_t>(std::ranges::count(changes, kind, &PlannedChange::kind));
+    }
+
+    void print(std::ostream& out = std::cout) const {
+        for (const auto& change : changes) {
+            auto mark = change.kind == ChangeKind::CREATE ? '+' : change.kind == ChangeKind::DELETE ? '-' : '~';
+            out << std::format("{} {} {}\n", mark, change.module, change.name);
+            if (change.kind != ChangeKind::UPDATE) continue;
+            for (const auto& field : change.fields)
+                out << std::format("    {}: {} -> {}\n", field.field, field.before.dump(), field.after.dump());
+        }
+        out << std::format("{} to create, {} to update, {} to delete\n", count(ChangeKind::CREATE),
+                           count(ChangeKind::UPDATE), count(ChangeKind::DELETE));
+    }
+};
+
+struct ReconcileReport {
+    ReconcilePlan plan;
+    std::vector<Result<Response>> results;  // one per planned change, empty on a dry run
+
+    [[nodiscard]] std::size_t succeeded() const {
+        return static_cast<std::size_t>(
+                std::ranges::count_if(results, [](const auto& result) { return result && result->status == "success"; }));
+    }
+
+    [[nodiscard]] std::size_t failed() const { return results.size() - succeeded(); }
+};
+
+// Brings the device to a desired ConfigState with as few requests as possible: the current objects are
+// fetched concurrently, diffed field by field against the desired ones, and only objects that differ
+// are written, every stage as one concurrent batch. A stage with a failure stops the stages after it.
+//
+// Threat feeds and DNS profiles are matched by name, firewall policies by policyid, or by name when
+// the desired policy has no id. DNS profile filters are compared by category and action, so the ids
+// the device gave existing filter entries aren't treated as differences and are kept.
+class Reconciler {
+    inline static std::string feed_endpoint = "/cmdb/system/external-resource",
+                              profile_endpoint = "/cmdb/dnsfilter/profile",
+                              policy_endpoint = "/cmdb/firewall/policy";
+
+    static std::vector<FieldChange> diff_fields(const nlohmann::json& before, const nlohmann::json& after) {
+        std::vector<FieldChange> fields;
+        for (const auto& [key, value] : after.items()) {
+            auto it = before.find(key);
+            if (it == before.end()) fields.push_back({key, nullptr, value});
+            else if (*it != value) fields.push_back({key, *it, value});
+        }
+        for (const auto& [key, value] : before.items())
+            if (!after.contains(key)) fields.push_back({key, value, nullptr});
+        return fields;
+    }
+
+    // Create, or update when the desired object differs from the current one; nothing otherwise.
+    static void write(ReconcilePlan& plan, std::string module, std::string name, ChangeStage stage,
+                      const nlohmann::json* current, nlohmann::json desired, const std::string& endpoint,
+                      const std::string& key) {
+        if (!current) {
+            auto fields = diff_fields(nlohmann::json::object(), desired);
+            plan.changes.push_back({std::move(module), std::move(name), ChangeKind::CREATE, stage, std::move(fields),
+                                    {"POST", endpoint, std::move(desired)}});
+            return;
+        }
+        auto fields = diff_fields(*current, desired);
+        if (fields.empty()) return;
+        plan.changes.push_back({std::move(module), std::move(name), ChangeKind::UPDATE, stage, std::move(fields),
+                                {"PUT", std::format("{}/{}", endpoint, key), std::move(desired)}});
+    }
+
+    static void remove(ReconcilePlan& plan, std::string module, const std::string& name, ChangeStage stage,
+                       const std::string& endpoint) {
+        plan.changes.push_back({std::move(module), name, ChangeKind::DELETE, stage, {},
+                                {"DELETE", std::format("{}/{}", endpoint, name)}});
+    }
+
+    // Categories only feeds the desired state drops use; they go away with those feeds.
+    static std::vector<unsigned int> released_categories(const ConfigState& desired, const ConfigState& current) {
+        std::unordered_set<std::string> wanted;
+        std::unordered_set<unsigned int> kept;
+        for (const auto& feed : desired.threat_feeds) {
+            wanted.insert(feed.name);
+            kept.insert(feed.category);
+        }
+        std::vector<unsigned int> released;
+        for (const auto& feed : current.threat_feeds)
+            if (!wanted.contains(feed.name) && !kept.contains(feed.category)) released.push_back(feed.category);
+        return released;
+    }
+
+    static void plan_feeds(ReconcilePlan& plan, const ConfigState& desired, const ConfigState& current, bool prune) {
+        std::unordered_map<std::string, nlohmann::json> existing;
+        for (const auto& feed : current.threat_feeds) existing.emplace(feed.name, feed);
+
+        std::unordered_set<std::string> wanted;
+        for (const auto& feed : desired.threat_feeds) {
+            wanted.insert(feed.name);
+            auto it = existing.find(feed.name);
+            write(plan, "threat-feed", feed.name, ChangeStage::WRITE_FEEDS, it == existing.end() ? nullptr : &it->second,
+                  feed, feed_endpoint, feed.name);
+        }
+        if (!prune) return;
+        for (const auto& feed : current.threat_feeds)
+            if (!wanted.contains(feed.name)) remove(plan, "threat-feed", feed.name, ChangeStage::DELETE_FEEDS, feed_endpoint);
+    }
+
+    static void plan_profiles(ReconcilePlan& plan, const ConfigState& desired, const ConfigState& current, bool prune) {
+        std::unordered_map<std::string, const DNSProfile*> existing;
+        for (const auto& profile : current.dns_profiles) existing.emplace(profile.name, &profile);
+        std::vector<unsigned int> released;
+        if (prune) released = released_categories(desired, current);
+
+        std::unordered_set<std::string> wanted;
+        for (const auto& profile : desired.dns_profiles) {
+            wanted.insert(profile.name);
+            auto categories = profile.ftgd_dns.categories();
+            for (auto category : released) categories.set(category, CategoryAction::ALLOW);
+
+            auto target = profile;
+            auto it = existing.find(profile.name);
+            if (it == existing.end()) {
+                target.ftgd_dns.set_categories(categories);
+                write(plan, "dns-profile", profile.name, ChangeStage::WRITE_PROFILES, nullptr, target,
+                      profile_endpoint, profile.name);
+                continue;
+            }
+
+            target.ftgd_dns.filters = it->second->ftgd_dns.filters;
+            target.ftgd_dns.conform_to(categories);
+            nlohmann::json before = *it->second;
+            write(plan, "dns-profile", profile.name, ChangeStage::WRITE_PROFILES, &before, target, profile_endpoint,
+                  profile.name);
+        }
+        if (!prune) return;
+        for (const auto& profile : current.dns_profiles)
+            if (!wanted.contains(profile.name))
+                remove(plan, "dns-profile", profile.name, ChangeStage::DELETE_PROFILES, profile_endpoint);
+    }
+
+    static void plan_policies(ReconcilePlan& plan, const ConfigState& desired, const ConfigState& current) {
+        std::unordered_map<unsigned int, const FirewallPolicy*> by_id;
+        std::unordered_map<std::string, const FirewallPolicy*> by_name;
+        for (const auto& policy : current.firewall_policies) {
+            by_id.emplace(policy.policyid, &policy);
+            if (!policy.name.empty()) by_name.emplace(policy.name, &policy);
+        }
+
+        for (const auto& policy : desired.firewall_policies) {
+            const FirewallPolicy* match = nullptr;
+            if (policy.policyid) {
+                if (auto it = by_id.find(policy.policyid); it != by_id.end()) match = it->second;
+            } else if (auto it = by_name.find(policy.name); it != by_name.end()) match = it->second;
+
+            auto label = policy.name.empty() ? std::to_string(policy.policyid) : policy.name;
+            if (!match) {
+                write(plan, "firewall-policy", label, ChangeStage::WRITE_POLICIES, nullptr, policy, policy_endpoint, {});
+                continue;
+            }
+
+            // the device numbers policies and their uuid, so those always come from it
+            auto target = policy;
+            target.policyid = match->policyid;
+            target.uuid_idx = match->uuid_idx;
+            nlohmann::json before = *match;
+            write(plan, "firewall-policy", label, ChangeStage::WRITE_POLICIES, &before, target, policy_endpoint,
+                  std::to_string(match->policyid));
+        }
+    }
+
+public:
+    // The managed modules as the device has them now, fetched concurrently.
+    static ConfigState fetch() {
+        auto client = FortiAPI::client();
+        auto in_scope = [client](auto get) {
+            return std::async(std::launch::async, [client, get] {
+                FortiAPI::Scope scope(client);
+                return get();
+            });
+        };
+        auto feeds = in_scope([] { return ThreatFeed::get(); });
+        auto profiles = in_scope([] { return DNSFilter::get(); });
+
+        ConfigState state;
+        state.firewall_policies = FortiGate::Policy::get();
+        state.threat_feeds = feeds.get();
+        state.dns_profiles = profiles.get();
+        return state;
+    }
+
+    static ReconcilePlan plan(const ConfigState& desired, const ConfigState& current, const ReconcileOptions& options = {}) {
+        ReconcilePlan plan;
+        plan_feeds(plan, desired, current, options.prune);
+        plan_profiles(plan, desired, current, options.prune);
+        plan_policies(plan, desired, current);
+        std::ranges::stable_sort(plan.changes, {}, &PlannedChange::stage);
+        return plan;
+    }
+
+    static ReconcilePlan plan(const ConfigState& desired, const ReconcileOptions& options = {}) {
+        return plan(desired, fetch(), options);
+    }
+
+    // Runs the plan stage by stage; results line up with plan.changes.
+    static std::vector<Result<Response>> apply(const ReconcilePlan& plan) {
+        std::vector<Result<Response>> results;
+        results.reserve(plan.changes.size());
+
+        bool failed = false, policies_written = false;
+        for (auto begin = plan.changes.begin(); begin != plan.changes.end();) {
+            auto end = std::find_if(begin, plan.changes.end(),
+                                    [stage = begin->stage](const auto& change) { return change.stage != stage; });
+            if (failed) {
+                for (; begin != end; ++begin)
+                    results.push_back(std::unexpected(RequestError{0, "skipped, an earlier stage failed"}));
+                continue;
+            }
+
+            std::vector<BatchRequest> requests;
+            for (auto it = begin; it != end; ++it) requests.push_back(it->request);
+            for (auto& result : FortiAPI::batch_mutate(requests)) {
+                auto succeeded = result && result->status == "success";
+                failed = failed || !succeeded;
+                // a feed the device kept keeps its delta baseline
+                if (succeeded && begin->stage == ChangeStage::DELETE_FEEDS) ThreatFeed::forget_feed(begin->name);
+                if (begin->stage == ChangeStage::WRITE_POLICIES) policies_written = true;
+                results.push_back(std::move(result));
+                ++begin;
+            }
+        }
+
+        if (policies_written) FortiGate::Policy::reload();
+        return results;
+    }
+
+    static ReconcileReport reconcile(const ConfigState& desired, const ReconcileOptions& options = {}) {
+        ReconcileReport report{plan(desired, options), {}};
+        if (!options.dry_run) report.results = apply(report.plan);
+        return report;
+    }
+};
+
+#endif //FORTI_API_RECONCILER_HPP
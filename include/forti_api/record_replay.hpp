@@ -0,0 +1,348 @@
+#ifndef FORTI_API_RECORD_REPLAY_HPP
+#define FORTI_API_RECORD_REPLAY_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "transport.hpp"
+
+
+// One recorded request/response pair. latency is how long the device took to answer.
+struct Exchange {
+    std::string method, path, request_body;
+    TransportResponse response;
+    std::chrono::microseconds latency{};
+};
+
+// Compact binary log of exchanges: an 8 byte magic, then per exchange the method, path and request body,
+// CURLcode, HTTP status, latency in microseconds, Retry-After in milliseconds and the response body.
+// Strings are a little-endian u32 length followed by the bytes, numbers little-endian u32/u64.
+class ExchangeLog {
+    static constexpr std::string_view magic = "FGTREC01";
+
+    static void put(std::ostream& out, std::uint64_t value, int bytes) {
+        char buffer[8];
+        for (int i = 0; i < bytes; ++i) buffer[i] = static_cast<char>(value >> (8 * i));
+        out.write(buffer, bytes);
+    }
+
+    static void put(std::ostream& out, std::string_view value) {
+        put(out, value.size(), 4);
+        out.write(value.data(), static_cast<std::streamsize>(value.size()));
+    }
+
+    static bool take(std::istream& in, std::uint64_t& value, int bytes) {
+        unsigned char buffer[8];
+        if (!in.read(reinterpret_cast<char*>(buffer), bytes)) return false;
+        value = 0;
+        for (int i = 0; i < bytes; ++i) value |= static_cast<std::uint64_t>(buffer[i]) << (8 * i);
+        return true;
+    }
+
+    static bool take(std::istream& in, std::string& value) {
+        std::uint64_t size;
+        if (!take(in, size, 4)) return false;
+        value.resize(size);
+        return static_cast<bool>(in.read(value.data(), static_cast<std::streamsize>(size)));
+    }
+
+public:
+    static void write_header(std::ostream& out) { out.write(magic.data(), magic.size()); }
+
+    static void write(std::ostream& out, const Exchange& exchange) {
+        put(out, exchange.method);
+        put(out, exchange.path);
+        put(out, exchange.request_body);
+        put(out, static_cast<std::uint32_t>(exchange.response.code), 4);
+        put(out, static_cast<std::uint32_t>(exchange.response.http_status), 4);
+        put(out, static_cast<std::uint64_t>(exchange.latency.count()), 8);
+        put(out, static_cast<std::uint64_t>(exchange.response.retry_after.count()), 8);
+        put(out, exchange.response.body);
+    }
+
+    // nullopt at a clean end of the log; throws on a record cut short.
+    static std::optional<Exchange> read(std::istream& in) {
+        Exchange exchange;
+        std::uint64_t code, status, latency, retry_after;
+        if (!take(in, exchange.method)) return std::nullopt;
+        if (!take(in, exchange.path) || !take(in, exchange.request_body) || !take(in, code, 4) ||
+            !take(in, status, 4) || !take(in, latency, 8) || !take(in, retry_after, 8) ||
+            !take(in, exchange.response.body))
+            throw std::runtime_error("Truncated exchange log record");
+        exchange.response.code = static_cast<CURLcode>(code);
+        exchange.response.http_status = static_cast<long>(status);
+        exchange.latency = std::chrono::microseconds(latency);
+        exchange.response.retry_after = std::chrono::milliseconds(retry_after);
+        return exchange;
+    }
+
+    static std::vector<Exchange> load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error("Can't open exchange log: " + path);
+        std::string header(magic.size(), '\0');
+        if (!in.read(header.data(), static_cast<std::streamsize>(header.size())) || header != magic)
+            throw std::runtime_error("Not an exchange log: " + path);
+
+        std::vector<Exchange> exchanges;
+        while (auto exchange = ExchangeLog::read(in)) exchanges.push_back(std::move(*exchange));
+        return exchanges;
+    }
+
+    static void save(const std::string& path, const std::vector<Exchange>& exchanges) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Can't create exchange log: " + path);
+        write_header(out);
+        for (const auto& exchange : exchanges) write(out, exchange);
+    }
+};
+
+// Passes every request on to another transport and appends the exchange to a log file. Streamed bodies
+// are copied as they're sent, so the log holds the full body either way.
+class RecordingTransport : public Transport {
+    using Clock = std::chrono::steady_clock;
+
+    std::shared_ptr<Transport> inner;
+    std::mutex mutex;
+    std::ofstream out;
+    std::size_t recorded = 0;
+
+    // Request side of an exchange, kept until its response arrives.
+    struct Pending {
+        std::string method, path, body;
+        std::shared_ptr<std::string> streamed;
+        Clock::time_point started = Clock::now();
+    };
+
+    static Pending track(TransportRequest& request) {
+        Pending pending{request.method, request.path, request.body, nullptr};
+        if (request.body_source) {
+            pending.streamed = std::make_shared<std::string>();
+            request.body_source = [source = std::move(request.body_source), copy = pending.streamed] {
+                auto chunk = source();
+                copy->append(chunk);
+                return chunk;
+            };
+        }
+        return pending;
+    }
+
+    void record(Pending& pending, const TransportResponse& response) {
+        Exchange exchange{std::move(pending.method), std::move(pending.path),
+                          pending.streamed ? std::move(*pending.streamed) : std::move(pending.body), response,
+                          std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - pending.started)};
+        std::lock_guard lock(mutex);
+        ExchangeLog::write(out, exchange);
+        ++recorded;
+    }
+
+    class RecordingMulti : public Multi {
+        RecordingTransport& transport;
+        std::unique_ptr<Multi> inner;
+        std::unordered_map<std::size_t, Pending> pending;
+
+    public:
+        RecordingMulti(RecordingTransport& transport, std::unique_ptr<Multi> inner) :
+                transport(transport), inner(std::move(inner)) {}
+
+        void add(std::size_t tag, TransportRequest request) override {
+            pending.insert_or_assign(tag, track(request));
+            inner->add(tag, std::move(request));
+        }
+
+        std::vector<std::pair<std::size_t, TransportResponse>> poll(std::chrono::milliseconds timeout) override {
+            auto done = inner->poll(timeout);
+            for (const auto& [tag, response] : done) {
+                auto it = pending.find(tag);
+                transport.record(it->second, response);
+                pending.erase(it);
+            }
+            return done;
+        }
+    };
+
+public:
+    RecordingTransport(std::shared_ptr<Transport> inner, const std::string& path) :
+            inner(std::move(inner)), out(path, std::ios::binary | std::ios::trunc) {
+        if (!out) throw std::runtime_error("Can't create exchange log: " + path);
+        ExchangeLog::write_header(out);
+    }
+
+    TransportResponse perform(TransportRequest request) override {
+        auto pending = track(request);
+        auto response = inner->perform(std::move(request));
+        record(pending, response);
+        return response;
+    }
+
+    std::unique_ptr<Multi> multi(unsigned int max_connections) override {
+        return std::make_unique<RecordingMulti>(*this, inner->multi(max_connections));
+    }
+
+    [[nodiscard]] ConnectionStats connection_stats() const override { return inner->connection_stats(); }
+    void reset_connection_stats() override { inner->reset_connection_stats(); }
+
+    void flush() {
+        std::lock_guard lock(mutex);
+        out.flush();
+    }
+
+    [[nodiscard]] std::size_t size() {
+        std::lock_guard lock(mutex);
+        return recorded;
+    }
+};
+
+struct ReplayOptions {
+    std::chrono::microseconds latency{};  // added to every response
+    double recorded_latency_scale = 0;    // 1 replays the device's own timing, 0 answers immediately
+};
+
+struct ReplayStats {
+    std::uint64_t served{}, misses{};
+};
+
+// Serves recorded responses from memory instead of a device. Exchanges are matched on method and path
+// and handed out in recording order; once a path's recordings run out the last one keeps being served.
+// Requests nothing was recorded for get a 404, the same as a device that lacks the object. Responses
+// can be delayed to model a device of a given speed, and the request deadline is honored the way curl
+// does, with CURLE_OPERATION_TIMEDOUT.
+class ReplayTransport : public Transport {
+    using Clock = std::chrono::steady_clock;
+
+    struct Recordings {
+        std::vector<Exchange> exchanges;
+        std::size_t next = 0;
+    };
+
+    struct Reply {
+        TransportResponse response;
+        Clock::time_point ready;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Recordings> recordings;
+    ReplayOptions options;
+    ReplayStats counters;
+
+    static std::string key(std::string_view method, std::string_view path) { return std::format("{} {}", method, path); }
+
+    // Bytes the request would have put on the wire; streamed bodies are consumed to count them.
+    static std::uint64_t drain(TransportRequest& request) {
+        if (!request.body_source) return request.body.size();
+        std::uint64_t sent = 0;
+        for (auto chunk = request.body_source(); !chunk.empty(); chunk = request.body_source()) sent += chunk.size();
+        return sent;
+    }
+
+    Reply serve(TransportRequest& request) {
+        auto sent = drain(request);
+        auto now = Clock::now();
+        Reply reply;
+        std::chrono::microseconds latency;
+        {
+            std::lock_guard lock(mutex);
+            latency = options.latency;
+            auto it = recordings.find(key(request.method, request.path));
+            if (it == recordings.end()) {
+                ++counters.misses;
+                reply.response = {CURLE_OK, 404, std::format(R"({{"http_method":"{}","path":"{}","status":"error","http_status":404}})",
+                                                             request.method, request.path)};
+            } else {
+                ++counters.served;
+                auto& queue = it->second;
+                const auto& exchange = queue.exchanges[std::min(queue.next, queue.exchanges.size() - 1)];
+                if (queue.next < queue.exchanges.size()) ++queue.next;
+                reply.response = exchange.response;
+                latency += std::chrono::duration_cast<std::chrono::microseconds>(exchange.latency * options.recorded_latency_scale);
+            }
+        }
+
+        reply.ready = now + latency;
+        if (request.deadline && reply.ready > *request.deadline) {
+            reply.response = {CURLE_OPERATION_TIMEDOUT, 0, {}};
+            reply.ready = *request.deadline;
+        }
+        auto delay = std::chrono::duration_cast<std::chrono::microseconds>(reply.ready - now);
+        reply.response.timing = {.ttfb = delay, .total = delay, .bytes_sent = sent, .bytes_received = reply.response.body.size()};
+        return reply;
+    }
+
+    class ReplayMulti : public Multi {
+        ReplayTransport& transport;
+        std::vector<std::pair<std::size_t, Reply>> in_flight;
+
+    public:
+        explicit ReplayMulti(ReplayTransport& transport) : transport(transport) {}
+
+        void add(std::size_t tag, TransportRequest request) override {
+            in_flight.emplace_back(tag, transport.serve(request));
+        }
+
+        std::vector<std::pair<std::size_t, TransportResponse>> poll(std::chrono::milliseconds timeout) override {
+            std::vector<std::pair<std::size_t, TransportResponse>> done;
+            if (in_flight.empty()) return done;
+
+            auto first = std::ranges::min(in_flight, {}, [](const auto& item) { return item.second.ready; }).second.ready;
+            std::this_thread::sleep_until(std::min(first, Clock::now() + timeout));
+
+            auto now = Clock::now();
+            auto finished = std::ranges::partition(in_flight, [now](const auto& item) { return item.second.ready > now; });
+            for (auto& [tag, reply] : finished) done.emplace_back(tag, std::move(reply.response));
+            in_flight.erase(finished.begin(), finished.end());
+            return done;
+        }
+    };
+
+public:
+    explicit ReplayTransport(std::vector<Exchange> exchanges, ReplayOptions options = {}) : options(options) {
+        for (auto& exchange : exchanges) {
+            auto id = key(exchange.method, exchange.path);
+            recordings[id].exchanges.push_back(std::move(exchange));
+        }
+    }
+
+    static std::shared_ptr<ReplayTransport> load(const std::string& path, ReplayOptions options = {}) {
+        return std::make_shared<ReplayTransport>(ExchangeLog::load(path), options);
+    }
+
+    // Waits out the latency in short steps, so a cancelled request gives up the way a curl transfer does.
+    TransportResponse perform(TransportRequest request) override {
+        auto reply = serve(request);
+        while (Clock::now() < reply.ready) {
+            if (request.cancelled && request.cancelled->load()) return {CURLE_ABORTED_BY_CALLBACK, 0, {}};
+            std::this_thread::sleep_until(std::min(reply.ready, Clock::now() + std::chrono::milliseconds(5)));
+        }
+        return std::move(reply.response);
+    }
+
+    std::unique_ptr<Multi> multi(unsigned int) override { return std::make_unique<ReplayMulti>(*this); }
+
+    void set_options(ReplayOptions next) {
+        std::lock_guard lock(mutex);
+        options = next;
+    }
+
+    // Starts every path over from its first recording.
+    void rewind() {
+        std::lock_guard lock(mutex);
+        for (auto& [_, queue] : recordings) queue.next = 0;
+    }
+
+    [[nodiscard]] ReplayStats stats() const {
+        std::lock_guard lock(mutex);
+        return counters;
+    }
+};
+
+#endif //FORTI_API_RECORD_REPLAY_HPP
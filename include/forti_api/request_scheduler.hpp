@@ -0,0 +1,186 @@
+#ifndef FORTI_API_REQUEST_SCHEDULER_HPP
+#define FORTI_API_REQUEST_SCHEDULER_HPP
+
+#include <curl/curl.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <utility>
+
+
+struct RetryPolicy {
+    unsigned int max_attempts = 4;
+    std::chrono::milliseconds base_delay{200}, max_delay{10'000};
+
+    // Full jitter: uniform in [0, min(max_delay, base_delay * 2^(attempt - 1))], never below what the
+    // device asked for in Retry-After.
+    [[nodiscard]] std::chrono::milliseconds backoff(unsigned int attempt,
+                                                    std::chrono::milliseconds retry_after = {}) const {
+        thread_local std::minstd_rand random{std::random_device{}()};
+        auto shift = std::min(attempt ? attempt - 1 : 0, 20u);
+        auto cap = std::min<std::int64_t>(max_delay.count(), base_delay.count() << shift);
+        std::uniform_int_distribution<std::int64_t> jitter(0, std::max<std::int64_t>(cap, 0));
+        return std::max(std::chrono::milliseconds(jitter(random)), retry_after);
+    }
+};
+
+enum class RequestOutcome { OK, RETRYABLE, FAILED };
+
+// Whether a finished attempt is worth repeating. Throttling is always retried, as the device refused the
+// request outright. Gateway errors and transport errors are retried only when the request never
+// reached the device or repeating it is harmless: a POST behind a timed-out gateway may already have
+// been applied.
+inline RequestOutcome classify_attempt(CURLcode code, long http_status, std::string_view method) {
+    if (code != CURLE_OK) {
+        switch (code) {
+            case CURLE_COULDNT_RESOLVE_HOST:
+            case CURLE_COULDNT_CONNECT:
+                return RequestOutcome::RETRYABLE;
+            case CURLE_OPERATION_TIMEDOUT:
+            case CURLE_SEND_ERROR:
+            case CURLE_RECV_ERROR:
+            case CURLE_GOT_NOTHING:
+            case CURLE_SSL_CONNECT_ERROR:
+                return method == "POST" ? RequestOutcome::FAILED : RequestOutcome::RETRYABLE;
+            default:
+                return RequestOutcome::FAILED;
+        }
+    }
+    if (http_status == 429) return RequestOutcome::RETRYABLE;
+    if (http_status == 502 || http_status == 503 || http_status == 504)
+        return method == "POST" ? RequestOutcome::FAILED : RequestOutcome::RETRYABLE;
+    return RequestOutcome::OK;
+}
+
+struct LimiterOptions {
+    double initial = 4, min = 1, max = 32;
+    double latency_tolerance = 2.0;  // smoothed latency above this multiple of the baseline means congestion
+    double overload_backoff = 0.5, latency_backoff = 0.9;
+};
+
+struct SchedulerStats {
+    double limit{};
+    unsigned int in_flight{};
+    std::uint64_t retries{}, throttled{};
+    std::chrono::microseconds smoothed_latency{}, baseline_latency{};
+};
+
+// AIMD cap on requests in flight to one device. Each completion that finishes near the baseline latency
+// grows the limit by 1/limit (about one slot per round trip); throttling, gateway errors and timeouts
+// halve it, and latency rising past latency_tolerance x baseline trims it. Decreases happen at most once
+// per smoothed round trip so one burst of failures doesn't collapse the limit to the floor.
+class ConcurrencyLimiter {
+    using Clock = std::chrono::steady_clock;
+
+    mutable std::mutex mutex;
+    std::condition_variable released;
+    LimiterOptions options;
+    double limit;
+    unsigned int in_flight = 0;
+    double smoothed_us = 0, baseline_us = 0;
+    Clock::time_point last_decrease{};
+
+    std::atomic<std::uint64_t> retries{0}, throttled{0};
+
+    void decrease(double factor, Clock::time_point now) {
+        if (now - last_decrease < std::chrono::microseconds(static_cast<std::int64_t>(smoothed_us))) return;
+        limit = std::max(options.min, limit * factor);
+        last_decrease = now;
+    }
+
+public:
+    explicit ConcurrencyLimiter(LimiterOptions options = {}) : options(options), limit(options.initial) {}
+
+    void configure(LimiterOptions next) {
+        std::lock_guard lock(mutex);
+        options = next;
+        limit = std::clamp(options.initial, options.min, options.max);
+        released.notify_all();
+    }
+
+    // Waits for a free slot until the deadline, false if it passed first.
+    bool acquire(std::optional<Clock::time_point> deadline = std::nullopt) {
+        std::unique_lock lock(mutex);
+        auto available = [this] { return in_flight < static_cast<unsigned int>(limit); };
+        if (deadline) {
+            if (!released.wait_until(lock, *deadline, available)) return false;
+        } else released.wait(lock, available);
+        ++in_flight;
+        return true;
+    }
+
+    bool try_acquire() { return acquire(Clock::now()); }
+
+    void release(std::chrono::microseconds latency, RequestOutcome outcome) {
+        {
+            std::lock_guard lock(mutex);
+            bool saturated = in_flight + 1 >= static_cast<unsigned int>(limit);
+            --in_flight;
+            auto now = Clock::now();
+
+            if (outcome == RequestOutcome::RETRYABLE) {
+                ++throttled;
+                decrease(options.overload_backoff, now);
+            } else {
+                auto sample = static_cast<double>(latency.count());
+                smoothed_us = smoothed_us == 0 ? sample : smoothed_us * 0.8 + sample * 0.2;
+                // the baseline tracks the fastest recent round trip and drifts up slowly so it can follow
+                // a device that got permanently slower
+                baseline_us = baseline_us == 0 || sample < baseline_us ? sample : baseline_us + (sample - baseline_us) * 0.01;
+
+                if (smoothed_us > baseline_us * options.latency_tolerance) decrease(options.latency_backoff, now);
+                else if (saturated) limit = std::min(options.max, limit + 1.0 / limit);
+            }
+        }
+        released.notify_one();
+    }
+
+    // Frees a slot whose attempt never finished, without taking its latency as a sample.
+    void abandon() {
+        {
+            std::lock_guard lock(mutex);
+            --in_flight;
+        }
+        released.notify_one();
+    }
+
+    void record_retry() { ++retries; }
+
+    [[nodiscard]] SchedulerStats stats() const {
+        std::lock_guard lock(mutex);
+        return {limit, in_flight, retries.load(), throttled.load(),
+                std::chrono::microseconds(static_cast<std::int64_t>(smoothed_us)),
+                std::chrono::microseconds(static_cast<std::int64_t>(baseline_us))};
+    }
+};
+
+// A slot taken from a limiter, freed again if the attempt unwinds before it settles, so a throwing
+// transport doesn't shrink the limit for good. Dismissed once the attempt has released it.
+class HeldSlot {
+    ConcurrencyLimiter* limiter = nullptr;
+
+public:
+    HeldSlot() = default;
+    explicit HeldSlot(ConcurrencyLimiter& acquired) : limiter(&acquired) {}
+    HeldSlot(HeldSlot&& other) noexcept : limiter(std::exchange(other.limiter, nullptr)) {}
+
+    HeldSlot& operator=(HeldSlot&& other) noexcept {
+        if (this != &other) {
+            if (limiter) limiter->abandon();
+            limiter = std::exchange(other.limiter, nullptr);
+        }
+        return *this;
+    }
+
+    ~HeldSlot() { if (limiter) limiter->abandon(); }
+
+    void dismiss() { limiter = nullptr; }
+};
+
+#endif //FORTI_API_REQUEST_SCHEDULER_HPP
@@ -0,0 +1,179 @@
+#ifndef FORTI_API_RESPONSE_CACHE_HPP
+#define FORTI_API_RESPONSE_CACHE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <typeindex>
+#include <unordered_map>
+
+
+struct CacheStats {
+    std::uint64_t hits{}, misses{}, revalidations{}, invalidations{};
+};
+
+// Read-through cache of decoded CMDB GET results, keyed by path (query included) and result type.
+//
+// Entries younger than max_age are served as is. Older ones are revalidated against the device's
+// config revision, which is fetched at most once per max_age for the whole cache, so a burst of
+// stale lookups costs a single round trip. Mutations through the library drop every entry of the
+// table they touch.
+class ResponseCache {
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::shared_ptr<const void> value;
+        std::string revision;
+        Clock::time_point validated;
+    };
+
+    struct Key {
+        std::string path;
+        std::type_index type;
+        bool operator==(const Key&) const = default;
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const {
+            return std::hash<std::string>{}(key.path) ^ (key.type.hash_code() << 1);
+        }
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<Key, Entry, KeyHash> entries;
+    bool enabled = false;
+    Clock::duration max_age{};
+    std::string revision;
+    Clock::time_point revision_checked{};
+
+    std::atomic<std::uint64_t> hits{0}, misses{0}, revalidations{0}, invalidations{0};
+
+public:
+    // Collection path a request belongs to, e.g. "/cmdb/dnsfilter/profile" for
+    // "/cmdb/dnsfilter/profile/advanced?datasource=1".
+    static std::string_view table_of(std::string_view path) {
+        path = path.substr(0, path.find('?'));
+        std::size_t end = 0;
+        for (int segments = 0; segments < 3 && end != std::string_view::npos; ++segments)
+            end = path.find('/', end + 1);
+        return path.substr(0, end);
+    }
+
+    // Only config tables carry a meaningful revision; monitor endpoints are always fetched. Feed entry
+    // lists live under /cmdb/ but change with pushes to the monitor API, which leave the revision alone.
+    static bool cacheable(std::string_view path) {
+        return path.starts_with("/cmdb/") && !path.starts_with("/cmdb/system/external-resource/entry-list");
+    }
+
+    void enable(Clock::duration age) {
+        std::lock_guard lock(mutex);
+        enabled = true;
+        max_age = age;
+    }
+
+    void disable() {
+        std::lock_guard lock(mutex);
+        enabled = false;
+        entries.clear();
+    }
+
+    [[nodiscard]] bool is_enabled() const {
+        std::lock_guard lock(mutex);
+        return enabled;
+    }
+
+    // Cached value for path, revalidated through probe (which returns the current config revision)
+    // when it's older than max_age. nullopt means the caller has to fetch it.
+    template<typename T>
+    std::optional<T> lookup(const std::string& path, const std::function<std::string()>& probe) {
+        Key key{path, typeid(T)};
+        std::unique_lock lock(mutex);
+        if (!enabled) return std::nullopt;
+
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            ++misses;
+            return std::nullopt;
+        }
+
+        auto now = Clock::now();
+        if (now - it->second.validated < max_age) {
+            ++hits;
+            return *std::static_pointer_cast<const T>(it->second.value);
+        }
+
+        if (now - revision_checked >= max_age) {
+            lock.unlock();
+            std::string current = probe();
+            lock.lock();
+            if (current.empty()) {
+                entries.erase(key);
+                ++misses;
+                return std::nullopt;
+            }
+            revision = std::move(current);
+            revision_checked = Clock::now();
+        }
+
+        it = entries.find(key);
+        if (it == entries.end() || it->second.revision != revision) {
+            if (it != entries.end()) entries.erase(it);
+            ++misses;
+            return std::nullopt;
+        }
+
+        it->second.validated = now;
+        ++revalidations;
+        ++hits;
+        return *std::static_pointer_cast<const T>(it->second.value);
+    }
+
+    template<typename T>
+    void store(const std::string& path, const T& value, const std::string& value_revision) {
+        std::lock_guard lock(mutex);
+        if (!enabled || value_revision.empty()) return;
+
+        auto now = Clock::now();
+        entries.insert_or_assign(Key{path, typeid(T)}, Entry{std::make_shared<const T>(value), value_revision, now});
+        revision = value_revision;
+        revision_checked = now;
+    }
+
+    // Drops every entry of the table the mutated path belongs to.
+    void invalidate(std::string_view path) {
+        auto table = table_of(path);
+        std::lock_guard lock(mutex);
+        std::erase_if(entries, [&](const auto& item) {
+            auto entry_table = table_of(item.first.path);
+            if (entry_table != table) return false;
+            ++invalidations;
+            return true;
+        });
+        revision_checked = {};
+    }
+
+    void clear() {
+        std::lock_guard lock(mutex);
+        entries.clear();
+        revision_checked = {};
+    }
+
+    [[nodiscard]] CacheStats stats() const {
+        return {hits.load(), misses.load(), revalidations.load(), invalidations.load()};
+    }
+
+    void reset_stats() {
+        hits = 0;
+        misses = 0;
+        revalidations = 0;
+        invalidations = 0;
+    }
+};
+
+#endif //FORTI_API_RESPONSE_CACHE_HPP
@@ -0,0 +1,377 @@
+#ifndef FORTI_API_SNAPSHOT_STORE_HPP
+#define FORTI_API_SNAPSHOT_STORE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "decoder.hpp"
+
+
+// Which device state a snapshot was taken from; an empty revision means unknown.
+struct SnapshotTag {
+    std::string serial, revision;
+
+    friend bool operator==(const SnapshotTag&, const SnapshotTag&) = default;
+};
+
+struct SnapshotOptions {
+    // Paths whose GETs are kept on disk. Monitor data is only revalidated by config revision, so add
+    // monitor endpoints only when they change with the config, as the interface list does.
+    std::vector<std::string> prefixes{"/cmdb/", "/monitor/system/available-interfaces"};
+    // Paths under those prefixes that aren't kept. Entry lists change when a threat feed is refreshed,
+    // which doesn't bump the config revision.
+    std::vector<std::string> excluded{"/cmdb/system/external-resource/entry-list"};
+    std::chrono::milliseconds max_age = std::chrono::seconds(30);  // how long a revision check holds
+};
+
+struct SnapshotStats {
+    std::uint64_t hits{}, misses{}, stale{}, writes{}, probes{};
+};
+
+// Types carrying the device serial and config revision they were read at.
+template<typename T>
+concept Snapshottable = requires(const T& t) {
+    { t.serial } -> std::convertible_to<std::string>;
+    { t.revision } -> std::convertible_to<std::string>;
+    { t.status } -> std::convertible_to<std::string>;
+};
+
+// SAX handler writing the MessagePack encoding of a JSON document as it's parsed, so a response is
+// converted without building its DOM. Container sizes aren't known until they close, so maps and
+// arrays are written in their 32-bit form and the count is filled in at the end.
+class MsgpackWriter {
+    using json = nlohmann::json;
+
+    struct Open {
+        std::size_t offset;
+        std::uint32_t count;
+        bool array;
+    };
+
+    std::string& out;
+    std::vector<Open> open;
+
+    void write(std::uint8_t type, std::uint64_t value, int bytes) {
+        out += static_cast<char>(type);
+        for (int i = bytes - 1; i >= 0; --i) out += static_cast<char>(value >> (8 * i) & 0xff);
+    }
+
+    // Counts the value in the array it sits in; object entries are counted by their key.
+    void element() {
+        if (!open.empty() && open.back().array) ++open.back().count;
+    }
+
+    bool start(std::uint8_t type, bool array) {
+        element();
+        open.push_back({out.size() + 1, 0, array});
+        write(type, 0, 4);
+        return true;
+    }
+
+    bool end() {
+        auto [offset, count, _] = open.back();
+        open.pop_back();
+        for (int i = 0; i < 4; ++i) out[offset + static_cast<std::size_t>(i)] = static_cast<char>(count >> (8 * (3 - i)) & 0xff);
+        return true;
+    }
+
+    bool bytes(std::string_view value, std::uint8_t fixed, std::uint8_t type8) {
+        auto size = value.size();
+        if (fixed && size < 32) out += static_cast<char>(fixed | size);
+        else if (size <= 0xff) write(type8, size, 1);
+        else if (size <= 0xffff) write(static_cast<std::uint8_t>(type8 + 1), size, 2);
+        else write(static_cast<std::uint8_t>(type8 + 2), size, 4);
+        out += value;
+        return true;
+    }
+
+public:
+    explicit MsgpackWriter(std::string& out) : out(out) {}
+
+    bool null() {
+        element();
+        out += '\xc0';
+        return true;
+    }
+
+    bool boolean(bool v) {
+        element();
+        out += v ? '\xc3' : '\xc2';
+        return true;
+    }
+
+    bool number_unsigned(json::number_unsigned_t v) {
+        element();
+        if (v < 0x80) out += static_cast<char>(v);
+        else if (v <= 0xff) write(0xcc, v, 1);
+        else if (v <= 0xffff) write(0xcd, v, 2);
+        else if (v <= 0xffffffff) write(0xce, v, 4);
+        else write(0xcf, v, 8);
+        return true;
+    }
+
+    bool number_integer(json::number_integer_t v) {
+        if (v >= 0) return number_unsigned(static_cast<json::number_unsigned_t>(v));
+        element();
+        auto bits = static_cast<std::uint64_t>(v);
+        if (v >= -32) out += static_cast<char>(bits & 0xff);
+        else if (v >= INT8_MIN) write(0xd0, bits, 1);
+        else if (v >= INT16_MIN) write(0xd1, bits, 2);
+        else if (v >= INT32_MIN) write(0xd2, bits, 4);
+        else write(0xd3, bits, 8);
+        return true;
+    }
+
+    bool number_float(json::number_float_t v, const json::string_t&) {
+        element();
+        write(0xcb, std::bit_cast<std::uint64_t>(v), 8);
+        return true;
+    }
+
+    bool string(json::string_t& v) {
+        element();
+        return bytes(v, 0xa0, 0xd9);
+    }
+
+    bool binary(json::binary_t& v) {
+        element();
+        return bytes({reinterpret_cast<const char*>(v.data()), v.size()}, 0, 0xc4);
+    }
+
+    bool key(json::string_t& k) {
+        ++open.back().count;
+        return bytes(k, 0xa0, 0xd9);
+    }
+
+    bool start_object(std::size_t) { return start(0xdf, false); }
+    bool start_array(std::size_t) { return start(0xdd, true); }
+    bool end_object() { return end(); }
+    bool end_array() { return end(); }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) { return false; }
+
+    // Appends the encoding of body to out; false, with out partly written, when body isn't valid JSON.
+    static bool convert(std::string_view body, std::string& out) {
+        MsgpackWriter writer(out);
+        return nlohmann::json::sax_parse(body, &writer);
+    }
+};
+
+// Decoded GET responses kept on disk across runs, so a tool starting against a large device reads its
+// tables locally instead of refetching them. One file per path and result type holds the device serial
+// and config revision next to the response encoded as MessagePack, which decodes straight into T.
+//
+// Snapshots are revalidated lazily: the first lookup after max_age probes the device's serial and
+// revision once for the whole store, and files taken at another revision are dropped. Mutations through
+// the library force the next lookup to probe again.
+class SnapshotStore {
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::string_view magic = "FGTSNP01";
+
+    // Temporary files are named per process and per write, so processes sharing a directory don't
+    // write into each other's files.
+    static inline const std::uint64_t process_token =
+            std::uint64_t{std::random_device{}()} << 32 | std::random_device{}();
+    static inline std::atomic<std::uint64_t> temporaries{0};
+
+    mutable std::mutex mutex;
+    std::filesystem::path directory;  // empty while disabled
+    SnapshotOptions options;
+    SnapshotTag device;
+    Clock::time_point device_checked{};
+
+    std::atomic<std::uint64_t> hits{0}, misses{0}, stale{0}, writes{0}, probes{0};
+
+    static void put(std::string& out, std::string_view value) {
+        auto size = static_cast<std::uint32_t>(value.size());
+        for (int i = 0; i < 4; ++i) out += static_cast<char>(size >> (8 * i) & 0xff);
+        out += value;
+    }
+
+    static std::optional<std::string_view> take(std::span<const std::uint8_t>& in) {
+        if (in.size() < 4) return std::nullopt;
+        std::uint32_t size = 0;
+        for (int i = 0; i < 4; ++i) size |= std::uint32_t{in[static_cast<std::size_t>(i)]} << (8 * i);
+        if (in.size() - 4 < size) return std::nullopt;
+        std::string_view value(reinterpret_cast<const char*>(in.data() + 4), size);
+        in = in.subspan(4 + size);
+        return value;
+    }
+
+    static std::optional<std::vector<std::uint8_t>> read(const std::filesystem::path& file) {
+        std::ifstream in(file, std::ios::binary | std::ios::ate);
+        if (!in) return std::nullopt;
+        std::vector<std::uint8_t> bytes(static_cast<std::size_t>(in.tellg()));
+        in.seekg(0);
+        if (!in.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size())))
+            return std::nullopt;
+        return bytes;
+    }
+
+    // The device tag to validate against, probed when the last check is older than max_age.
+    std::optional<SnapshotTag> current(const std::function<SnapshotTag()>& probe) {
+        std::unique_lock lock(mutex);
+        if (Clock::now() - device_checked < options.max_age) return device;
+        lock.unlock();
+        ++probes;
+        auto probed = probe();
+        lock.lock();
+        if (probed.revision.empty()) return std::nullopt;
+        device = std::move(probed);
+        device_checked = Clock::now();
+        return device;
+    }
+
+public:
+    void enable(std::filesystem::path dir, SnapshotOptions snapshot_options = {}) {
+        std::filesystem::create_directories(dir);
+        std::lock_guard lock(mutex);
+        directory = std::move(dir);
+        options = std::move(snapshot_options);
+        device_checked = {};
+    }
+
+    void disable() {
+        std::lock_guard lock(mutex);
+        directory.clear();
+    }
+
+    [[nodiscard]] bool is_enabled() const {
+        std::lock_guard lock(mutex);
+        return !directory.empty();
+    }
+
+    // Whether GETs of path are kept.
+    [[nodiscard]] bool wants(std::string_view path) const {
+        std::lock_guard lock(mutex);
+        if (directory.empty()) return false;
+        auto under = [&](const auto& prefix) { return path.starts_with(prefix); };
+        return std::ranges::any_of(options.prefixes, under) && std::ranges::none_of(options.excluded, under);
+    }
+
+    [[nodiscard]] std::filesystem::path file_of(std::string_view path, std::string_view type) const {
+        auto hash = std::hash<std::string_view>{}(path) ^ (std::hash<std::string_view>{}(type) << 1);
+        std::lock_guard lock(mutex);
+        return directory / (std::to_string(hash) + ".snapshot");
+    }
+
+    // The snapshot of path if it was taken at the device's current serial and revision.
+    template<Snapshottable T>
+    std::optional<T> load(const std::string& path, const std::function<SnapshotTag()>& probe) {
+        if (!wants(path)) return std::nullopt;
+        std::string_view type = typeid(T).name();
+        auto file = file_of(path, type);
+        auto bytes = read(file);
+        if (!bytes || bytes->size() < magic.size() ||
+            std::string_view(reinterpret_cast<const char*>(bytes->data()), magic.size()) != magic) {
+            ++misses;
+            return std::nullopt;
+        }
+
+        std::span<const std::uint8_t> in(*bytes);
+        in = in.subspan(magic.size());
+        auto serial = take(in), revision = take(in), stored_path = take(in), stored_type = take(in);
+        if (!stored_type || *stored_path != path || *stored_type != type) {
+            ++misses;
+            return std::nullopt;
+        }
+
+        auto tag = current(probe);
+        if (!tag) {
+            ++misses;  // device didn't answer the probe; the snapshot may still be good next time
+            return std::nullopt;
+        }
+        if (tag->serial != *serial || tag->revision != *revision) {
+            ++stale;
+            std::error_code ignored;
+            std::filesystem::remove(file, ignored);
+            return std::nullopt;
+        }
+
+        try {
+            T result = SaxDecoder::decode_msgpack<T>(in);
+            ++hits;
+            return result;
+        } catch (const nlohmann::json::exception&) {
+            ++misses;
+            return std::nullopt;
+        }
+    }
+
+    // Keeps body, the JSON response T was decoded from, when it succeeded and carries a revision. The
+    // file is replaced atomically, so concurrent loads see either snapshot whole.
+    template<Snapshottable T>
+    void save(const std::string& path, const T& result, std::string_view body) {
+        if (!wants(path) || result.status != "success" || result.revision.empty()) return;
+        std::string_view type = typeid(T).name();
+
+        std::string out(magic);
+        put(out, result.serial);
+        put(out, result.revision);
+        put(out, path);
+        put(out, type);
+        if (!MsgpackWriter::convert(body, out)) return;
+
+        auto file = file_of(path, type);
+        auto temporary = file;
+        temporary += std::format(".{:x}.{}.tmp", process_token, ++temporaries);
+        {
+            std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+            if (!stream.write(out.data(), static_cast<std::streamsize>(out.size()))) return;
+        }
+        std::error_code error;
+        std::filesystem::rename(temporary, file, error);
+        if (error) return;
+        ++writes;
+
+        std::lock_guard lock(mutex);
+        device = {result.serial, result.revision};
+        device_checked = Clock::now();
+    }
+
+    // The device changed, so the next lookup has to check its revision again.
+    void invalidate() {
+        std::lock_guard lock(mutex);
+        device_checked = {};
+    }
+
+    // Deletes every snapshot file of this store.
+    void clear() {
+        std::lock_guard lock(mutex);
+        device_checked = {};
+        if (directory.empty()) return;
+        std::error_code ignored;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, ignored))
+            if (entry.path().extension() == ".snapshot") std::filesystem::remove(entry.path(), ignored);
+    }
+
+    [[nodiscard]] SnapshotStats stats() const {
+        return {hits.load(), misses.load(), stale.load(), writes.load(), probes.load()};
+    }
+
+    void reset_stats() {
+        hits = 0;
+        misses = 0;
+        stale = 0;
+        writes = 0;
+        probes = 0;
+    }
+};
+
+#endif //FORTI_API_SNAPSHOT_STORE_HPP
@@ -0,0 +1,44 @@
+#ifndef FORTI_API_STRING_POOL_HPP
+#define FORTI_API_STRING_POOL_HPP
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+
+// Interns strings into dense 32-bit ids so tables of device objects, where the same vdom, type and
+// interface names repeat on every row, store each distinct string once.
+class StringPool {
+    std::deque<std::string> storage;  // deque keeps element addresses stable for the views below
+    std::unordered_map<std::string_view, std::uint32_t> ids;
+
+public:
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+    StringPool(StringPool&&) = default;
+    StringPool& operator=(StringPool&&) = default;
+
+    std::uint32_t intern(std::string_view value) {
+        if (auto it = ids.find(value); it != ids.end()) return it->second;
+        auto id = static_cast<std::uint32_t>(storage.size());
+        ids.emplace(storage.emplace_back(value), id);
+        return id;
+    }
+
+    [[nodiscard]] std::uint32_t find(std::string_view value) const {
+        auto it = ids.find(value);
+        return it == ids.end() ? npos : it->second;
+    }
+
+    [[nodiscard]] const std::string& operator[](std::uint32_t id) const { return storage[id]; }
+
+    [[nodiscard]] std::size_t size() const { return storage.size(); }
+};
+
+#endif //FORTI_API_STRING_POOL_HPP
@@ -6,9 +6,20 @@
 #define FORTI_API_SYSTEM_H
 
 #include "api.hpp"
+#include "pagination.hpp"
+#include "string_pool.hpp"
+#include "ip_prefix.hpp"
 #include <string>
 #include <utility>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
 
 
 // SYSTEM INTERFACE TYPES
@@ -17,20 +28,20 @@ struct SystemResponse {
     unsigned int build{};
     std::string http_method, revision, vdom, path, name, action, status, serial, version;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(SystemResponse, build, http_method, revision, vdom, path, name, action,
+    FORTI_API_DEFINE_TYPE(SystemResponse, build, http_method, revision, vdom, path, name, action,
                                    status, serial, version);
 };
 
 struct GeneralInterface {
     std::string name;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(GeneralInterface, name);
+    FORTI_API_DEFINE_TYPE(GeneralInterface, name);
 };
 
 struct GeneralResponse : public Response {
     std::vector<GeneralInterface> results;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(GeneralResponse, http_method, size, matched_count, next_idx,
+    FORTI_API_DEFINE_TYPE(GeneralResponse, http_method, size, matched_count, next_idx,
                                    revision, vdom, path, name, status, http_status, serial, version,
                                    build, results)
 };
@@ -39,7 +50,7 @@ struct IPV4Address {
     std::string ip, netmask;
     unsigned int cidr_netmask{};
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(IPV4Address, ip, netmask, cidr_netmask);
+    FORTI_API_DEFINE_TYPE(IPV4Address, ip, netmask, cidr_netmask);
 };
 
 struct SystemInterface {
@@ -53,7 +64,7 @@ struct SystemInterface {
     std::vector<IPV4Address> ipv4_addresses{};
     std::vector<std::string> members{};
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(SystemInterface,
+    FORTI_API_DEFINE_TYPE(SystemInterface,
                                    name, type, real_interface_name, vdom, status, alias, vlan_protocol, role,
                                    mac_address, port_speed, media, physical_switch, link, duplex, icon,
                                    is_used, is_physical, dynamic_addressing, dhcp_interface, valid_in_policy,
@@ -70,24 +81,181 @@ struct VirtualWANLink {
     bool is_sdwan_zone{}, valid_in_policy{};
     std::vector<std::string> members{};
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(VirtualWANLink, name, vdom, status, type, link, icon, is_sdwan_zone,
+    FORTI_API_DEFINE_TYPE(VirtualWANLink, name, vdom, status, type, link, icon, is_sdwan_zone,
                                                 valid_in_policy, members);
 };
 
 struct InterfacesGeneralResponse : public SystemResponse {
     std::vector<nlohmann::json> results;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(InterfacesGeneralResponse, build, http_method, revision, vdom, path,
+    FORTI_API_DEFINE_TYPE(InterfacesGeneralResponse, build, http_method, revision, vdom, path,
                                                 name, action, status, serial, version, results);
 };
 
+// Immutable, indexed copy of the device's interface list. Strings are interned, the boolean attributes
+// packed into one word, and rows are found by (vdom, name) with a single hash lookup.
+class InterfaceSnapshot {
+    static constexpr std::array string_fields{
+            &SystemInterface::name, &SystemInterface::type, &SystemInterface::real_interface_name,
+            &SystemInterface::vdom, &SystemInterface::status, &SystemInterface::alias,
+            &SystemInterface::vlan_protocol, &SystemInterface::role, &SystemInterface::mac_address,
+            &SystemInterface::port_speed, &SystemInterface::media, &SystemInterface::physical_switch,
+            &SystemInterface::link, &SystemInterface::duplex, &SystemInterface::icon};
+
+    static constexpr std::array flag_fields{
+            &SystemInterface::is_used, &SystemInterface::is_physical, &SystemInterface::dynamic_addressing,
+            &SystemInterface::dhcp_interface, &SystemInterface::valid_in_policy, &SystemInterface::is_ipsecable,
+            &SystemInterface::is_routable, &SystemInterface::supports_fortilink, &SystemInterface::supports_dhcp,
+            &SystemInterface::is_explicit_proxyable, &SystemInterface::supports_device_id,
+            &SystemInterface::supports_fortitelemetry, &SystemInterface::is_system_interface,
+            &SystemInterface::monitor_bandwidth};
+
+    static constexpr std::array counter_fields{
+            &SystemInterface::in_bandwidth_limit, &SystemInterface::out_bandwidth_limit,
+            &SystemInterface::dhcp4_client_count, &SystemInterface::dhcp6_client_count,
+            &SystemInterface::estimated_upstream_bandwidth, &SystemInterface::estimated_downstream_bandwidth,
+            &SystemInterface::chip_id, &SystemInterface::speed};
+
+    static constexpr std::size_t name_field = 0, type_field = 1, vdom_field = 3;
+
+    struct Row {
+        std::array<std::uint32_t, string_fields.size()> strings;
+        std::array<std::uint32_t, counter_fields.size()> counters;
+        std::uint32_t first_address, address_count;
+        std::uint16_t flags;
+    };
+
+    struct Address {
+        std::uint32_t ip, netmask, cidr_netmask;
+    };
+
+    StringPool strings;
+    std::vector<Row> rows;
+    std::vector<Address> addresses;
+    std::unordered_map<std::uint64_t, std::uint32_t> index;
+    std::chrono::steady_clock::time_point loaded = std::chrono::steady_clock::now();
+
+    static std::uint64_t key(std::uint32_t vdom, std::uint32_t name) { return std::uint64_t{vdom} << 32 | name; }
+
+    [[nodiscard]] const Row* find(std::string_view name, std::string_view vdom, std::string_view type) const {
+        auto vdom_id = strings.find(vdom), name_id = strings.find(name);
+        if (vdom_id == StringPool::npos || name_id == StringPool::npos) return nullptr;
+        auto it = index.find(key(vdom_id, name_id));
+        if (it == index.end()) return nullptr;
+        const Row& row = rows[it->second];
+        return type.empty() || strings[row.strings[type_field]] == type ? &row : nullptr;
+    }
+
+public:
+    explicit InterfaceSnapshot(const std::vector<nlohmann::json>& results) {
+        rows.reserve(results.size());
+        for (const auto& result : results) {
+            if (!result.contains("type")) continue;
+            SystemInterface interface = result;
+
+            Row row{};
+            for (std::size_t i = 0; i < string_fields.size(); ++i) row.strings[i] = strings.intern(interface.*string_fields[i]);
+            for (std::size_t i = 0; i < counter_fields.size(); ++i) row.counters[i] = interface.*counter_fields[i];
+            for (std::size_t i = 0; i < flag_fields.size(); ++i)
+                if (interface.*flag_fields[i]) row.flags |= static_cast<std::uint16_t>(1u << i);
+
+            row.first_address = static_cast<std::uint32_t>(addresses.size());
+            row.address_count = static_cast<std::uint32_t>(interface.ipv4_addresses.size());
+            for (const auto& address : interface.ipv4_addresses)
+                addresses.push_back({strings.intern(address.ip), strings.intern(address.netmask), address.cidr_netmask});
+
+            index.insert_or_assign(key(row.strings[vdom_field], row.strings[name_field]),
+                                   static_cast<std::uint32_t>(rows.size()));
+            rows.push_back(row);
+        }
+    }
+
+    // Rebuilds the full SystemInterface for (vdom, name), optionally requiring a type.
+    [[nodiscard]] std::optional<SystemInterface> get(std::string_view name, std::string_view vdom = "root",
+                                                     std::string_view type = {}) const {
+        const Row* row = find(name, vdom, type);
+        if (!row) return std::nullopt;
+
+        SystemInterface interface;
+        for (std::size_t i = 0; i < string_fields.size(); ++i) interface.*string_fields[i] = strings[row->strings[i]];
+        for (std::size_t i = 0; i < counter_fields.size(); ++i) interface.*counter_fields[i] = row->counters[i];
+        for (std::size_t i = 0; i < flag_fields.size(); ++i) interface.*flag_fields[i] = row->flags >> i & 1;
+        for (std::uint32_t i = 0; i < row->address_count; ++i) {
+            const auto& address = addresses[row->first_address + i];
+            interface.ipv4_addresses.push_back({strings[address.ip], strings[address.netmask], address.cidr_netmask});
+        }
+        return interface;
+    }
+
+    // First IPv4 address of an interface without materializing the row, nullptr if it has none.
+    [[nodiscard]] const std::string* first_ipv4(std::string_view name, std::string_view vdom = "root",
+                                                std::string_view type = {}) const {
+        const Row* row = find(name, vdom, type);
+        if (!row || !row->address_count) return nullptr;
+        return &strings[addresses[row->first_address].ip];
+    }
+
+    [[nodiscard]] std::size_t size() const { return rows.size(); }
+    [[nodiscard]] std::chrono::steady_clock::time_point loaded_at() const { return loaded; }
+};
+
+// Holds the current InterfaceSnapshot and replaces it atomically, so readers on any thread get a
+// consistent table without locking. A snapshot older than the refresh interval is reloaded by the
+// first reader to notice; everyone else keeps using the old one meanwhile. An interval of zero
+// only refreshes on request.
+class InterfaceTable {
+    using Loader = std::function<std::vector<nlohmann::json>()>;
+
+    Loader loader;
+    std::atomic<std::shared_ptr<const InterfaceSnapshot>> current;
+    std::atomic<std::chrono::milliseconds::rep> interval_ms;
+    std::mutex refresh_mutex;
+
+    [[nodiscard]] bool expired(const InterfaceSnapshot& snapshot) const {
+        auto interval = std::chrono::milliseconds(interval_ms.load(std::memory_order_relaxed));
+        return interval.count() > 0 && std::chrono::steady_clock::now() - snapshot.loaded_at() >= interval;
+    }
+
+    std::shared_ptr<const InterfaceSnapshot> reload() {
+        auto snapshot = std::make_shared<const InterfaceSnapshot>(loader());
+        current.store(snapshot, std::memory_order_release);
+        return snapshot;
+    }
+
+public:
+    explicit InterfaceTable(Loader loader, std::chrono::milliseconds interval = std::chrono::minutes(1)) :
+            loader(std::move(loader)), interval_ms(interval.count()) {}
+
+    std::shared_ptr<const InterfaceSnapshot> snapshot() {
+        auto snapshot = current.load(std::memory_order_acquire);
+        if (snapshot && !expired(*snapshot)) return snapshot;
+
+        std::unique_lock lock(refresh_mutex, std::try_to_lock);
+        if (!lock) {
+            if (snapshot) return snapshot;  // stale but usable while another thread reloads
+            lock.lock();
+        }
+
+        snapshot = current.load(std::memory_order_acquire);
+        if (snapshot && !expired(*snapshot)) return snapshot;
+        return reload();
+    }
+
+    std::shared_ptr<const InterfaceSnapshot> refresh() {
+        std::lock_guard lock(refresh_mutex);
+        return reload();
+    }
+
+    void set_refresh_interval(std::chrono::milliseconds interval) { interval_ms.store(interval.count()); }
+};
+
 
 // SYSTEM ADMIN TYPES
 
 struct VDomEntry {
     std::string name, q_origin_key;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(VDomEntry, name, q_origin_key)
+    FORTI_API_DEFINE_TYPE(VDomEntry, name, q_origin_key)
 };
 
 enum class TrustHostType {
@@ -109,10 +277,11 @@ struct TrustHostEntry {
     [[nodiscard]] bool is_ipv4() const { return get_type() == TrustHostType::IPV4; }
     [[nodiscard]] bool is_ipv6() const { return get_type() == TrustHostType::IPV6; }
 
+    [[nodiscard]] std::optional<IPPrefix> get_prefix() const { return IPPrefix::parse(get_subnet()); }
+
     friend void to_json(nlohmann::json& j, const TrustHostEntry& host) {
         j = nlohmann::json{
                 {"id", host.id},
-                {"q_origin_key", host.q_origin_key},
                 {"type", host.type},
                 {host.is_ipv4() ? "ipv4-trusthost" : "ipv6-trusthost", host.get_subnet()}
         };
@@ -129,7 +298,7 @@ struct IPV4TrustHost : public TrustHostEntry {
     IPV4TrustHost() = default;
     explicit IPV4TrustHost(std::string ip_addr) : TrustHostEntry("ipv4-trusthost"), ipv4_trusthost(std::move(ip_addr)) {}
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(IPV4TrustHost, id, q_origin_key, type, ipv4_trusthost)
+    FORTI_API_DEFINE_TYPE(IPV4TrustHost, id, q_origin_key, type, ipv4_trusthost)
 };
 
 // Derived class for IPv6 TrustHost
@@ -140,18 +309,40 @@ struct IPV6TrustHost : public TrustHostEntry {
     [[nodiscard]] std::string get_subnet() const override { return ipv6_trusthost; }
 
     IPV6TrustHost() = default;
-    explicit IPV6TrustHost(std::string ip_addr) : TrustHostEntry("ipv4-trusthost"), ipv6_trusthost(std::move(ip_addr)) {}
+    explicit IPV6TrustHost(std::string ip_addr) : TrustHostEntry("ipv6-trusthost"), ipv6_trusthost(std::move(ip_addr)) {}
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(IPV6TrustHost, id, q_origin_key, type, ipv6_trusthost)
+    FORTI_API_DEFINE_TYPE(IPV6TrustHost, id, q_origin_key, type, ipv6_trusthost)
 };
 
+// The entries as FortiOS lists them, plus a PrefixSet over them for containment lookups. APIUser keeps
+// the two in step; call reindex() after editing the entries directly.
 struct TrustHost : public std::vector<std::shared_ptr<TrustHostEntry>> {
+    PrefixSet index;
+
+    static std::shared_ptr<TrustHostEntry> make_entry(const IPPrefix& prefix) {
+        if (prefix.address.v6) return std::make_shared<IPV6TrustHost>(prefix.to_trusthost());
+        return std::make_shared<IPV4TrustHost>(prefix.to_trusthost());
+    }
+
+    void reindex() {
+        index.clear();
+        for (const auto& host : *this)
+            if (auto prefix = host->get_prefix()) index.insert(*prefix);
+    }
+
+    // Whether a client at this address may use the API key; unparsable addresses never are.
+    [[nodiscard]] bool covers(std::string_view ip) const {
+        auto address = IPAddress::parse(ip);
+        return address && index.covers(*address);
+    }
+
     friend void from_json(const nlohmann::json& j, TrustHost& th) {
         for (const auto& item : j) {
             auto type = item.at("type").get<std::string>();
             if (type == "ipv4-trusthost") th.push_back(std::make_shared<IPV4TrustHost>(item));
             else th.push_back(std::make_shared<IPV6TrustHost>(item));
         }
+        th.reindex();
     }
 
     friend void to_json(nlohmann::json& j, const TrustHost& th) {
@@ -165,28 +356,69 @@ struct APIUser {
             peer_auth, peer_group;
     TrustHost trusthost;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(APIUser, name, q_origin_key, comments, api_key, accprofile,
+    FORTI_API_DEFINE_TYPE(APIUser, name, q_origin_key, comments, api_key, accprofile,
                                                 schedule, cors_allow_origin, peer_auth, peer_group, trusthost)
 
+    // Subnets compare as prefixes, so "10.0.0.0/24" and "10.0.0.0 255.255.255.0" are the same entry.
     bool is_trusted(const std::string& subnet) {
-        return std::any_of(trusthost.begin(), trusthost.end(),
-                           [&subnet](const std::shared_ptr<TrustHostEntry>& host) {
-                               return host->get_subnet() == subnet;
-                           });
+        auto prefix = IPPrefix::parse(subnet);
+        return prefix && std::any_of(trusthost.begin(), trusthost.end(),
+                                     [&prefix](const std::shared_ptr<TrustHostEntry>& host) {
+                                         return host->get_prefix() == prefix;
+                                     });
     }
 
+    [[nodiscard]] bool covers(std::string_view ip) const { return trusthost.covers(ip); }
+
+    // Adds the subnet unless an existing entry already covers it; entries inside it are dropped.
     void trust(const std::string& subnet) {
-        if (is_trusted(subnet)) return;
-        if (std::regex_match(subnet, ipv4)) trusthost.push_back(std::make_shared<IPV4TrustHost>(subnet));
-        else if (std::regex_match(subnet, ipv6)) trusthost.push_back(std::make_shared<IPV6TrustHost>(subnet));
+        auto prefix = IPPrefix::parse(subnet);
+        if (!prefix || trusthost.index.covers(*prefix)) return;
+        if (trusthost.index.overlaps_within(*prefix)) {
+            std::erase_if(trusthost, [&prefix](const std::shared_ptr<TrustHostEntry>& entry) {
+                auto existing = entry->get_prefix();
+                return existing && prefix->contains(*existing);
+            });
+        }
+        trusthost.push_back(TrustHost::make_entry(*prefix));
+        trusthost.index.insert(*prefix);
     }
 
+    // Removes the entries for exactly this subnet. The index only holds the minimal prefixes, and entries
+    // the device lists inside a wider one aren't in it, so it's rebuilt from the entries that remain.
     void distrust(const std::string& subnet) {
-        if (!is_trusted(subnet)) return;
-        trusthost.erase(std::remove_if(trusthost.begin(), trusthost.end(),
-                                       [&subnet](const std::shared_ptr<TrustHostEntry>& entry) {
-                                           return entry->get_subnet() == subnet;
-                                       }), trusthost.end());
+        auto prefix = IPPrefix::parse(subnet);
+        if (!prefix) return;
+        auto removed = std::erase_if(trusthost, [&prefix](const std::shared_ptr<TrustHostEntry>& entry) {
+            return entry->get_prefix() == prefix;
+        });
+        if (removed) trusthost.reindex();
+    }
+
+    // Replaces the trusthosts with the minimal list covering subnets; entries that survive keep their
+    // ids. Throws on a subnet that doesn't parse rather than silently narrowing who may log in.
+    // Returns whether anything changed.
+    bool sync_trusthosts(const std::vector<std::string>& subnets) {
+        PrefixSet desired;
+        for (const auto& subnet : subnets) {
+            auto prefix = IPPrefix::parse(subnet);
+            if (!prefix) throw std::runtime_error("Invalid trusthost subnet: " + subnet);
+            desired.insert(*prefix);
+        }
+
+        TrustHost next;
+        PrefixSet kept;
+        for (const auto& entry : trusthost) {
+            auto prefix = entry->get_prefix();
+            if (prefix && desired.contains(*prefix) && kept.insert(*prefix)) next.push_back(entry);
+        }
+        for (const auto& prefix : desired.prefixes())
+            if (!kept.contains(prefix)) next.push_back(TrustHost::make_entry(prefix));
+
+        bool changed = next.size() != trusthost.size() || !std::ranges::equal(next, trusthost);
+        next.index = std::move(desired);
+        trusthost = std::move(next);
+        return changed;
     }
 
     void update() {
@@ -197,7 +429,7 @@ struct APIUser {
 struct AllAPIUsersResponse : public Response {
     std::vector<APIUser> results;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(AllAPIUsersResponse, http_method, size, matched_count, next_idx,
+    FORTI_API_DEFINE_TYPE(AllAPIUsersResponse, http_method, size, matched_count, next_idx,
                                                 revision, vdom, path, name, status, http_status, serial, version,
                                                 build, results)
 };
@@ -207,27 +439,23 @@ namespace System {
     class Interface {
         inline static std::string available_interfaces_endpoint = "/monitor/system/available-interfaces";
 
-        inline static std::vector<SystemInterface> physical_interfaces{},
-                tunnel_interfaces{},
-                hard_switch_vlan_interfaces{},
-                aggregate_interfaces{};
-
-        static void update_local_interface_data() {
-            physical_interfaces.clear();
-            tunnel_interfaces.clear();
-            hard_switch_vlan_interfaces.clear();
-            aggregate_interfaces.clear();
-
-            auto interfaces = FortiAPI::get<InterfacesGeneralResponse>(available_interfaces_endpoint);
-            for (const auto& interface : interfaces.results) {
-                if (!interface.contains("type")) continue;
-                auto type = interface["type"].get<std::string>();
-
-                if (type == "physical") physical_interfaces.emplace_back(interface);
-                else if (type == "tunnel") tunnel_interfaces.emplace_back(interface);
-                else if (type == "hard-switch-vlan") hard_switch_vlan_interfaces.emplace_back(interface);
-                else if (type == "aggregate") aggregate_interfaces.emplace_back(interface);
+        // One table per device, keyed like the threat feed baselines, so clients running side by side in
+        // a Fleet or under FortiAPI::Scope never read another device's interfaces.
+        inline static std::mutex tables_mutex;
+        inline static std::unordered_map<std::string, std::shared_ptr<InterfaceTable>> tables;
+        inline static std::chrono::milliseconds refresh_interval = std::chrono::minutes(1);
+
+        // The loader runs on the thread asking for the snapshot, which is in this device's scope.
+        static std::shared_ptr<InterfaceTable> table() {
+            auto key = FortiAPI::client()->get_config().base_url();
+            std::lock_guard lock(tables_mutex);
+            auto& table = tables[key];
+            if (!table) {
+                table = std::make_shared<InterfaceTable>([] {
+                    return FortiAPI::get<InterfacesGeneralResponse>(available_interfaces_endpoint).results;
+                }, refresh_interval);
             }
+            return table;
         }
 
         static unsigned int count_interfaces() {
@@ -241,29 +469,26 @@ namespace System {
             return FortiAPI::get<std::vector<nlohmann::json>>(endpoint)[0];
         }
 
-        static SystemInterface get(const std::vector<SystemInterface>& interfaces,
-                                   const std::string& name, const std::string& vdom = "root") {
-            if (interfaces.empty()) update_local_interface_data();
-            for (const auto& interface : interfaces)
-                if (interface.name == name && interface.vdom == vdom) return interface;
+        static SystemInterface get(std::string_view type, const std::string& name, const std::string& vdom = "root") {
+            if (auto interface = table()->snapshot()->get(name, vdom, type)) return std::move(*interface);
             throw std::runtime_error(std::format("No system interface found for: {}", name));
         }
 
     public:
         static SystemInterface get_physical_interface(const std::string& name, const std::string& vdom = "root") {
-            return get(physical_interfaces, name, vdom);
+            return get("physical", name, vdom);
         }
 
         static SystemInterface get_tunnel_interface(const std::string& name, const std::string& vdom = "root") {
-            return get(tunnel_interfaces, name, vdom);
+            return get("tunnel", name, vdom);
         }
 
         static SystemInterface get_hard_vlan_switch_interface(const std::string& name, const std::string& vdom = "root") {
-            return get(hard_switch_vlan_interfaces, name, vdom);
+            return get("hard-switch-vlan", name, vdom);
         }
 
         static SystemInterface get_aggregate_interface(const std::string& name, const std::string& vdom = "root") {
-            return get(aggregate_interfaces, name, vdom);
+            return get("aggregate", name, vdom);
         }
 
         static VirtualWANLink get_virtual_wan_link(const std::string& name = "virtual-wan-link", const std::string& vdom = "root") {
@@ -271,7 +496,22 @@ namespace System {
         }
 
         static std::string get_wan_ip(unsigned int wan_port = 1, const std::string& vdom = "root") {
-            return get_physical_interface(std::format("wan{}", wan_port), vdom).ipv4_addresses[0].ip;
+            auto name = std::format("wan{}", wan_port);
+            if (auto ip = table()->snapshot()->first_ipv4(name, vdom, "physical")) return *ip;
+            throw std::runtime_error(std::format("No IPv4 address found for: {}", name));
+        }
+
+        // Current device's interface table, reloaded once it's older than the refresh interval.
+        static std::shared_ptr<const InterfaceSnapshot> snapshot() { return table()->snapshot(); }
+
+        static void refresh() { table()->refresh(); }
+
+        // Zero disables time-based refreshes; the tables then only reload through refresh(). Applies to
+        // every device.
+        static void set_refresh_interval(std::chrono::milliseconds interval) {
+            std::lock_guard lock(tables_mutex);
+            refresh_interval = interval;
+            for (auto& [_, table] : tables) table->set_refresh_interval(interval);
         }
     }; // System::Interface
 
@@ -293,6 +533,10 @@ namespace System {
                 return FortiAPI::get<AllAPIUsersResponse>(api_user_endpoint).results;
             }
 
+            static PagedRange<AllAPIUsersResponse> range(unsigned int page_size = 1000) {
+                return PagedRange<AllAPIUsersResponse>(api_user_endpoint, page_size);
+            }
+
             static APIUser get(const std::string& api_admin_name) {
                 auto endpoint = std::format("{}/{}", api_user_endpoint, api_admin_name);
                 auto response = FortiAPI::get<AllAPIUsersResponse>(endpoint);
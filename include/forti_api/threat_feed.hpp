@@ -8,7 +8,15 @@
 #include "dns_filter.hpp"
 #include <utility>
 #include <vector>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <fstream>
+#include <memory>
 #include "api.hpp"
+#include "domain_set.hpp"
+#include "pagination.hpp"
 
 
 struct PushThreatFeed {
@@ -23,7 +31,7 @@ struct PushThreatFeed {
     PushThreatFeed() = default;
     PushThreatFeed(std::string  name, unsigned int category) : name(std::move(name)), category(category) {}
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(PushThreatFeed, name, status, type, update_method,
+    FORTI_API_DEFINE_TYPE(PushThreatFeed, name, status, type, update_method,
                                                 server_identity_check, category, comments)
 };
 
@@ -31,14 +39,14 @@ struct FeedThreatFeed : public PushThreatFeed {
     std::string resource;
     unsigned int refresh_rate{};
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(FeedThreatFeed, name, status, type, update_method,
+    FORTI_API_DEFINE_TYPE(FeedThreatFeed, name, status, type, update_method,
                                                 server_identity_check, category, comments, resource, refresh_rate)
 };
 
 struct ExternalResourcesResponse : public Response {
     std::vector<PushThreatFeed> results;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(ExternalResourcesResponse, http_method, size, matched_count, next_idx,
+    FORTI_API_DEFINE_TYPE(ExternalResourcesResponse, http_method, size, matched_count, next_idx,
                                    revision, vdom, path, name, status, http_status, serial, version,
                                    build, results)
 };
@@ -46,7 +54,7 @@ struct ExternalResourcesResponse : public Response {
 struct Entry {
     std::string entry, valid;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(Entry, entry, valid);
+    FORTI_API_DEFINE_TYPE(Entry, entry, valid);
 };
 
 struct ExternalResourceEntryList {
@@ -54,14 +62,70 @@ struct ExternalResourceEntryList {
     unsigned long last_content_update_time{};
     std::vector<Entry> entries;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(ExternalResourceEntryList, status, resource_file_status,
+    FORTI_API_DEFINE_TYPE(ExternalResourceEntryList, status, resource_file_status,
                                    last_content_update_time, entries);
 };
 
 struct ExternalResourceEntryListResponse : public Response {
     ExternalResourceEntryList results;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(ExternalResourceEntryListResponse, http_method, size, matched_count, next_idx,
+    FORTI_API_DEFINE_TYPE(ExternalResourceEntryListResponse, http_method, size, matched_count, next_idx,
+                                   revision, vdom, path, name, status, http_status, serial, version,
+                                   build, results)
+};
+
+// An entry list decoded straight into the (domain, valid) pairs a DomainSet is built from, so no Entry
+// is ever held for it.
+struct DomainEntries {
+    std::vector<std::pair<std::string, bool>> domains;
+
+    friend void to_json(nlohmann::json& j, const DomainEntries& entries) {
+        j = nlohmann::json::array();
+        for (const auto& [domain, valid] : entries.domains)
+            j.push_back({{"entry", domain}, {"valid", valid ? "true" : "false"}});
+    }
+
+    friend void from_json(const nlohmann::json& j, DomainEntries& entries) {
+        entries.domains.clear();
+        for (const auto& entry : j) entries.domains.emplace_back(entry.value("entry", ""), entry.value("valid", "") == "true");
+    }
+};
+
+template<>
+struct DecodeTraits<DomainEntries> {
+    static void valid(void* object, DecodeScalar& value) {
+        if (auto* text = std::get_if<std::string*>(&value)) *static_cast<bool*>(object) = **text == "true";
+    }
+
+    static DecodeTarget field(void* object, std::string_view key) {
+        static constexpr DecodeOps valid_ops = [] { DecodeOps o; o.scalar = valid; return o; }();
+        auto& [domain, is_valid] = *static_cast<std::pair<std::string, bool>*>(object);
+        if (key == "entry") return DecodeTarget::bind(domain);
+        if (key == "valid") return {&is_valid, &valid_ops};
+        return {};
+    }
+
+    static DecodeTarget element(void* object) {
+        static constexpr DecodeOps entry_ops = [] { DecodeOps o; o.field = field; return o; }();
+        return {&static_cast<DomainEntries*>(object)->domains.emplace_back(), &entry_ops};
+    }
+
+    static constexpr DecodeOps ops = [] { DecodeOps o; o.element = element; return o; }();
+};
+
+struct ExternalResourceDomainList {
+    std::string status, resource_file_status;
+    unsigned long last_content_update_time{};
+    DomainEntries entries;
+
+    FORTI_API_DEFINE_TYPE(ExternalResourceDomainList, status, resource_file_status,
+                                   last_content_update_time, entries);
+};
+
+struct ExternalResourceDomainListResponse : public Response {
+    ExternalResourceDomainList results;
+
+    FORTI_API_DEFINE_TYPE(ExternalResourceDomainListResponse, http_method, size, matched_count, next_idx,
                                    revision, vdom, path, name, status, http_status, serial, version,
                                    build, results)
 };
@@ -71,9 +135,10 @@ struct CommandEntry {
     std::vector<std::string> entries;
 
     CommandEntry() = default;
-    CommandEntry(std::string name, const std::vector<std::string>& entries) : name(std::move(name)), entries(entries) {}
+    CommandEntry(std::string name, const std::vector<std::string>& entries, std::string command = "snapshot") :
+            name(std::move(name)), command(std::move(command)), entries(entries) {}
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(CommandEntry, name, entries, command)
+    FORTI_API_DEFINE_TYPE(CommandEntry, name, entries, command)
 };
 
 struct CommandsRequest {
@@ -82,7 +147,103 @@ struct CommandsRequest {
     CommandsRequest() = default;
     CommandsRequest(const CommandEntry& initialEntry) : commands() { commands.push_back(initialEntry); }
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(CommandsRequest, commands)
+    FORTI_API_DEFINE_TYPE(CommandsRequest, commands)
+};
+
+// Yields feed entries one at a time, std::nullopt once exhausted.
+using EntrySource = std::function<std::optional<std::string_view>()>;
+
+template<typename It>
+EntrySource entries_from(It begin, It end) {
+    return [begin, end]() mutable -> std::optional<std::string_view> {
+        if (begin == end) return std::nullopt;
+        return std::string_view(*begin++);
+    };
+}
+
+// One entry per line; blank lines are skipped.
+inline EntrySource entries_from_file(const std::string& path) {
+    auto file = std::make_shared<std::ifstream>(path);
+    if (!*file) throw std::runtime_error("Unable to open feed file: " + path);
+    auto line = std::make_shared<std::string>();
+    return [file, line]() -> std::optional<std::string_view> {
+        while (std::getline(*file, *line)) {
+            if (!line->empty() && line->back() == '\r') line->pop_back();
+            if (!line->empty()) return std::string_view(*line);
+        }
+        return std::nullopt;
+    };
+}
+
+// Serializes a CommandsRequest with a single command piece by piece, so the body of a feed upload
+// never has to exist in memory as a whole. Used as a BodySource for FortiAPI::post_stream. The bytes
+// are the same as nlohmann::json(request).dump(): keys in sorted order, the same escapes.
+class CommandStream {
+    static constexpr std::size_t chunk_size = 64 * 1024;
+
+    std::string name, command;
+    EntrySource source;
+    std::string chunk;
+    bool started = false, finished = false, first_entry = true;
+
+    static void append_escaped(std::string& out, std::string_view value) {
+        out += '"';
+        for (char c : value) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                case '\b': out += "\\b"; break;
+                case '\f': out += "\\f"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) out += std::format("\\u{:04x}", static_cast<int>(c));
+                    else out += c;
+            }
+        }
+        out += '"';
+    }
+
+public:
+    CommandStream(std::string name, EntrySource source, std::string command = "snapshot") :
+            name(std::move(name)), command(std::move(command)), source(std::move(source)) {}
+
+    std::string_view operator()() {
+        chunk.clear();
+        if (finished) return chunk;
+
+        if (!started) {
+            chunk += R"({"commands":[{"command":)";
+            append_escaped(chunk, command);
+            chunk += R"(,"entries":[)";
+            started = true;
+        }
+
+        while (chunk.size() < chunk_size) {
+            auto entry = source();
+            if (!entry) {
+                chunk += R"(],"name":)";
+                append_escaped(chunk, name);
+                chunk += "}]}";
+                finished = true;
+                break;
+            }
+            if (!first_entry) chunk += ',';
+            first_entry = false;
+            append_escaped(chunk, *entry);
+        }
+        return chunk;
+    }
+};
+
+struct FeedUpdate {
+    bool snapshot{};
+    std::size_t added{}, removed{};
+    std::optional<Response> response;  // the device's answer, nullopt when there was nothing to send
+
+    // Whether the device holds the entries now.
+    [[nodiscard]] bool succeeded() const { return !response || response->status == "success"; }
 };
 
 class ThreatFeed {
@@ -92,6 +253,41 @@ class ThreatFeed {
     inline static std::string external_resource_entry_list =
             std::format("{}/entry-list?include_notes=true&vdom=root&mkey=", external_resource);
 
+    // Last set of entries successfully pushed per device and feed, the baseline for delta updates.
+    inline static std::mutex pushed_mutex;
+    inline static std::unordered_map<std::string, std::unordered_set<std::string>> pushed_entries;
+    inline static double max_delta_ratio = 0.5;
+
+    // Held by a delta update from reading the baseline until the push is recorded, so two updates of
+    // the same feed never diff against the same baseline. Guarded by pushed_mutex.
+    inline static std::unordered_map<std::string, std::shared_ptr<std::mutex>> feed_mutexes;
+
+    static std::shared_ptr<std::mutex> feed_mutex(const std::string& key) {
+        std::lock_guard lock(pushed_mutex);
+        auto& mutex = feed_mutexes[key];
+        if (!mutex) mutex = std::make_shared<std::mutex>();
+        return mutex;
+    }
+
+    // The same feed name lives on every device, so baselines are keyed by the client's url too.
+    static std::string baseline_key(const std::string& name) {
+        return std::format("{} {}", FortiAPI::client()->get_config().base_url(), name);
+    }
+
+    static void record_push(const CommandsRequest& data, bool success) {
+        std::lock_guard lock(pushed_mutex);
+        for (const auto& entry : data.commands) {
+            auto key = baseline_key(entry.name);
+            if (!success) pushed_entries.erase(key);
+            else if (entry.command == "snapshot")
+                pushed_entries[key] = {entry.entries.begin(), entry.entries.end()};
+            else if (auto it = pushed_entries.find(key); it != pushed_entries.end()) {
+                if (entry.command == "add") it->second.insert(entry.entries.begin(), entry.entries.end());
+                else if (entry.command == "remove") for (const auto& e : entry.entries) it->second.erase(e);
+            }
+        }
+    }
+
     static void set(const std::string& name, bool enable = true) {
         nlohmann::json j;
         j["status"] = enable ? "enable" : "disable";
@@ -103,7 +299,62 @@ public:
         FortiAPI::post(std::format("{}/{}", external_resource_monitor, name), data);
     }
 
-    static void update_feed(const CommandsRequest& data) { FortiAPI::post(external_resource_monitor, data); }
+    static Response update_feed(const CommandsRequest& data) {
+        auto response = FortiAPI::post(external_resource_monitor, data);
+        record_push(data, response.status == "success");
+        return response;
+    }
+
+    // Sends only add/remove commands against the last push of this feed, falling back to a snapshot
+    // when there's no baseline yet or the delta exceeds max_ratio of the feed.
+    static FeedUpdate update_feed_delta(const std::string& name, const std::vector<std::string>& entries,
+                                        std::optional<double> max_ratio = std::nullopt) {
+        auto key = baseline_key(name);
+        auto feed = feed_mutex(key);
+        std::lock_guard feed_lock(*feed);
+
+        std::unordered_set<std::string> next(entries.begin(), entries.end());
+        std::vector<std::string> additions, removals;
+        bool snapshot;
+
+        {
+            std::lock_guard lock(pushed_mutex);
+            auto previous = pushed_entries.find(key);
+            snapshot = previous == pushed_entries.end();
+            if (!snapshot) {
+                for (const auto& entry : next) if (!previous->second.contains(entry)) additions.push_back(entry);
+                for (const auto& entry : previous->second) if (!next.contains(entry)) removals.push_back(entry);
+                auto limit = max_ratio.value_or(max_delta_ratio) * static_cast<double>(next.size());
+                snapshot = static_cast<double>(additions.size() + removals.size()) > limit;
+            }
+        }
+
+        if (snapshot) return {true, next.size(), 0, update_feed(CommandEntry(name, {next.begin(), next.end()}))};
+
+        CommandsRequest request;
+        if (!additions.empty()) request.commands.emplace_back(name, additions, "add");
+        if (!removals.empty()) request.commands.emplace_back(name, removals, "remove");
+        FeedUpdate update{false, additions.size(), removals.size(), std::nullopt};
+        if (!request.commands.empty()) update.response = update_feed(request);
+        return update;
+    }
+
+    // Uploads the feed straight from the source; memory use stays flat regardless of feed size. The
+    // entries aren't retained, so the delta baseline for this feed is dropped.
+    static Response stream_feed(const std::string& name, EntrySource source, const std::string& command = "snapshot") {
+        forget_feed(name);
+        return FortiAPI::post_stream(external_resource_monitor,
+                                     CommandStream(name, std::move(source), command));
+    }
+
+    static void set_max_delta_ratio(double ratio) { max_delta_ratio = ratio; }
+
+    // Drops the delta baseline, the next update of this feed is sent as a snapshot.
+    static void forget_feed(const std::string& name) {
+        auto key = baseline_key(name);
+        std::lock_guard lock(pushed_mutex);
+        pushed_entries.erase(key);
+    }
 
     static std::vector<PushThreatFeed> get() {
         return FortiAPI::get<ExternalResourcesResponse>(external_resource).results;
@@ -118,8 +369,30 @@ public:
                 (std::format("{}/{}", external_resource_entry_list, feed)).results.entries;
     }
 
+    // Pages through a feed's entry list without holding all of it in memory.
+    static PagedRange<ExternalResourceEntryListResponse, Entry> entry_range(const std::string& feed,
+                                                                            unsigned int page_size = 10000) {
+        return PagedRange<ExternalResourceEntryListResponse, Entry>(
+                std::format("{}/{}", external_resource_entry_list, feed), page_size,
+                [](ExternalResourceEntryListResponse&& response) { return std::move(response.results.entries); });
+    }
+
+    // Entry list as a compact DomainSet, for membership checks against large feeds.
+    static DomainSet get_entry_set(const std::string& feed) {
+        return DomainSet(std::move(FortiAPI::get<ExternalResourceDomainListResponse>(
+                std::format("{}/{}", external_resource_entry_list, feed)).results.entries.domains));
+    }
+
     static bool contains(const std::string& name) {
-        return FortiAPI::get<ExternalResourcesResponse>(std::format("{}/{}", external_resource, name)).http_status == 200;
+        return FortiAPI::exists(std::format("{}/{}", external_resource, name));
+    }
+
+    // The feed's category alone, nullopt when there's no such feed.
+    static std::optional<unsigned int> category_of(const std::string& name) {
+        auto response = FortiAPI::get<ExternalResourcesResponse>(
+                std::format("{}/{}?format=name|category", external_resource, name));
+        if (response.http_status != 200 || response.results.empty()) return std::nullopt;
+        return response.results[0].category;
     }
 
     static void enable(const std::string& name) { set(name, true); }
@@ -131,19 +404,51 @@ public:
         FortiAPI::post(external_resource, threat_feed);
     }
 
+    static MutationResult try_add(const std::string& name, unsigned int category) {
+        return FortiAPI::mutate("POST", external_resource, PushThreatFeed(name, category));
+    }
+
+    // Optimistic delete: one request when nothing uses the feed. Only when the device refuses because
+    // its category is still set in a DNS profile is the category allowed everywhere and the delete
+    // sent again.
+    static MutationResult try_del(const std::string& name) {
+        auto path = std::format("{}/{}", external_resource, name);
+        auto result = FortiAPI::mutate("DELETE", path);
+        if (result.status == MutationStatus::IN_USE) {
+            if (auto category = category_of(name)) {
+                DNSFilter::global_allow_category(*category);
+                result = FortiAPI::mutate("DELETE", path);
+            }
+        }
+        if (result) forget_feed(name);
+        return result;
+    }
+
+    // Always allows the feed's category in every profile first; the category lookup doubles as the
+    // existence check.
     static void del(const std::string& name) {
-        if (contains(name)) {
-            auto category = get(name).category;
-            DNSFilter::global_allow_category(category);
-            FortiAPI::del(std::format("{}/{}", external_resource, name));
-        } else std::cerr << "Couldn't locate threat feed for deletion: " << name << std::endl;
+        auto category = category_of(name);
+        if (!category) {
+            std::cerr << "Couldn't locate threat feed for deletion: " << name << std::endl;
+            return;
+        }
+        DNSFilter::global_allow_category(*category);
+        if (FortiAPI::del(std::format("{}/{}", external_resource, name)).status == "success") forget_feed(name);
     }
 
     static void del(unsigned int category) {
         DNSFilter::global_allow_category(category);
+        std::vector<std::string> names;
+        std::vector<BatchRequest> deletions;
         for (const auto& feed : get()) {
-            if (feed.category == category) FortiAPI::del(std::format("{}/{}", external_resource, feed.name));
+            if (feed.category == category) {
+                deletions.push_back({"DELETE", std::format("{}/{}", external_resource, feed.name)});
+                names.push_back(feed.name);
+            }
         }
+        auto results = FortiAPI::batch_mutate(deletions);
+        for (std::size_t i = 0; i < results.size(); ++i)
+            if (results[i] && results[i]->status == "success") forget_feed(names[i]);
     }
 };
 
@@ -0,0 +1,357 @@
+#ifndef FORTI_API_TRANSPORT_HPP
+#define FORTI_API_TRANSPORT_HPP
+
+#include <curl/curl.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "connection_pool.hpp"
+#include "metrics.hpp"
+
+
+// Produces the next chunk of a streamed request body; the view must stay valid until the next call,
+// an empty view ends the body.
+using BodySource = std::function<std::string_view()>;
+
+// Connection settings for one FortiGate.
+struct DeviceConfig {
+    std::string gateway_ip;
+    unsigned int admin_https_port{};
+    std::string ca_cert_path, ssl_cert_path, cert_password, api_key;
+
+    static std::string check_env(const char* env_var_name) {
+        const char* value = std::getenv(env_var_name);
+        if (value == nullptr) {
+            std::cerr << "[DEBUG] Missing required field: '" << env_var_name << "'. Please set this in your environment.\n";
+            return "";
+        }
+        return value;
+    }
+
+    static DeviceConfig from_env() {
+        DeviceConfig config;
+        config.admin_https_port = std::stoi(check_env("FORTIGATE_ADMIN_HTTPS_PORT"));
+        config.gateway_ip = check_env("FORTIGATE_GATEWAY_IP");
+        config.ca_cert_path = check_env("PATH_TO_FORTIGATE_CA_CERT");
+        config.ssl_cert_path = check_env("PATH_TO_FORTIGATE_SSL_CERT");
+        config.cert_password = check_env("FORTIGATE_SSL_CERT_PASS");
+        config.api_key = check_env("FORTIGATE_API_KEY");
+        return config;
+    }
+
+    [[nodiscard]] std::string base_url() const { return std::format("https://{}:{}/api/v2", gateway_ip, admin_https_port); }
+
+    [[nodiscard]] std::string auth_header() const { return api_key.empty() ? "" : "Authorization: Bearer " + api_key; }
+
+    bool operator==(const DeviceConfig&) const = default;
+};
+
+// One HTTP exchange with the admin API; path is relative to /api/v2 and query included.
+struct TransportRequest {
+    std::string method, path, body;
+    BodySource body_source;  // streamed body, sent chunked instead of body when set
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    std::shared_ptr<const std::atomic<bool>> cancelled;  // once set, the transfer is abandoned
+};
+
+// code is the transport-level result in curl's vocabulary, so every transport fails the same way.
+struct TransportResponse {
+    CURLcode code = CURLE_OK;
+    long http_status{};
+    std::string body;
+    std::chrono::milliseconds retry_after{};
+    RequestTiming timing{};
+};
+
+// Moves requests to a device and responses back. perform() blocks; multi() hands out a driver for
+// running many requests at once from a single thread, as FortiClient::batch does. Implementations
+// must allow perform() and multi() from any number of threads.
+class Transport {
+public:
+    class Multi {
+    public:
+        virtual ~Multi() = default;
+
+        virtual void add(std::size_t tag, TransportRequest request) = 0;
+
+        // Moves transfers along, waiting up to timeout for one to finish; returns all that have.
+        virtual std::vector<std::pair<std::size_t, TransportResponse>> poll(std::chrono::milliseconds timeout) = 0;
+    };
+
+    virtual ~Transport() = default;
+
+    virtual TransportResponse perform(TransportRequest request) = 0;
+    virtual std::unique_ptr<Multi> multi(unsigned int max_connections) = 0;
+
+    [[nodiscard]] virtual ConnectionStats connection_stats() const { return {}; }
+    virtual void reset_connection_stats() {}
+};
+
+// The real thing: pooled libcurl handles sharing connections and TLS sessions, with the header lists
+// built once from the config.
+class CurlTransport : public Transport {
+    const DeviceConfig config;
+    const std::string base_url;
+    const std::shared_ptr<curl_slist> headers, chunked_headers;
+    ConnectionPool pool;
+
+    static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp) {
+        ((std::string*)userp)->append((char*)contents, size * nmemb);
+        return size * nmemb;
+    }
+
+    static int curl_debug_callback(CURL *handle, curl_infotype type, char *data, size_t size, void *userptr) {
+        switch (type) {
+            case CURLINFO_TEXT:
+                std::cerr << "== Info: " << std::string(data, size);
+                break;
+            case CURLINFO_HEADER_OUT:
+                std::cerr << "=> Send header: " << std::string(data, size);
+                break;
+            case CURLINFO_DATA_OUT:
+                std::cerr << "=> Send data: " << std::string(data, size);
+                break;
+            case CURLINFO_SSL_DATA_OUT:
+                std::cerr << "=> Send SSL data: " << std::string(data, size);
+                break;
+            case CURLINFO_HEADER_IN:
+                std::cerr << "<= Recv header: " << std::string(data, size);
+                break;
+            case CURLINFO_DATA_IN:
+                std::cerr << "<= Recv data: " << std::string(data, size);
+                break;
+            case CURLINFO_SSL_DATA_IN:
+                std::cerr << "<= Recv SSL data: " << std::string(data, size);
+                break;
+            default:
+                break;
+        }
+        return 0;
+    }
+
+    static std::shared_ptr<curl_slist> build_headers(const std::string &auth_header, bool chunked) {
+        struct curl_slist *list = nullptr;
+        list = curl_slist_append(list, "Content-Type: application/json");
+        list = curl_slist_append(list, auth_header.c_str());
+        if (chunked) list = curl_slist_append(list, "Transfer-Encoding: chunked");
+        return {list, curl_slist_free_all};
+    }
+
+    // Missing settings are reported once per transport rather than on every request.
+    static const DeviceConfig& warn_uninitialized(const DeviceConfig &config) {
+        auto check = [](bool missing, const char *field) {
+            if (missing) std::cerr << "[WARNING] " << field << " is uninitialized!\n";
+        };
+        check(config.admin_https_port == 0, "admin_https_port");
+        check(config.gateway_ip.empty(), "gateway_ip");
+        check(config.ca_cert_path.empty(), "ca_cert_path");
+        check(config.ssl_cert_path.empty(), "ssl_cert_path");
+        check(config.cert_password.empty(), "cert_password");
+        check(config.api_key.empty(), "api_key");
+        return config;
+    }
+
+    static RequestTiming timing_of(CURL *curl) {
+        curl_off_t dns = 0, connect = 0, tls = 0, ttfb = 0, total = 0, sent = 0, received = 0;
+        long connects = 0;
+        curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+        curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+        curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &tls);
+        curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &ttfb);
+        curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+        curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &sent);
+        curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &received);
+        curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+
+        // curl reports each phase as time since the start; a reused connection skips the early ones
+        using us = std::chrono::microseconds;
+        return {us(dns), us(std::max<curl_off_t>(connect - dns, 0)), us(tls ? std::max<curl_off_t>(tls - connect, 0) : 0),
+                us(ttfb), us(total), static_cast<std::uint64_t>(sent), static_cast<std::uint64_t>(received),
+                connects > 0};
+    }
+
+    // Aborts the transfer once its request was cancelled.
+    static int ProgressCallback(void *userp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+        const auto &cancelled = static_cast<Transfer*>(userp)->request.cancelled;
+        return cancelled && cancelled->load() ? 1 : 0;
+    }
+
+    static size_t ReadCallback(char *buffer, size_t size, size_t nitems, void *userp) {
+        auto *transfer = static_cast<Transfer*>(userp);
+        size_t capacity = size * nitems, written = 0;
+        try {
+            while (written < capacity) {
+                if (transfer->pending.empty() && (transfer->pending = transfer->request.body_source()).empty()) break;
+                size_t n = std::min(capacity - written, transfer->pending.size());
+                std::memcpy(buffer + written, transfer->pending.data(), n);
+                transfer->pending.remove_prefix(n);
+                written += n;
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "Request body stream failed: " << e.what() << std::endl;
+            return CURL_READFUNC_ABORT;
+        }
+        return written;
+    }
+
+    // Owns everything curl points into for one request, so it must stay put until the transfer is done.
+    // Cert paths are read straight from the transport's config, which outlives every transfer it starts.
+    struct Transfer {
+        CurlTransport &transport;
+        ConnectionPool::Handle handle;
+        TransportRequest request;
+        std::string url, buffer;
+        std::string_view pending;
+        std::size_t tag{};
+
+        Transfer(CurlTransport &transport, TransportRequest &&request) :
+                transport(transport), handle(transport.pool.acquire()), request(std::move(request)),
+                url(transport.base_url + this->request.path) {
+            CURL *curl = handle.get();
+            const auto &config = transport.config;
+            const auto &method = this->request.method;
+
+            curl_easy_setopt(curl, CURLOPT_SSL_SESSIONID_CACHE, 1L);
+            curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, 0L);
+            curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 0L);
+            curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+            curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, -1);
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER,
+                             (this->request.body_source ? transport.chunked_headers : transport.headers).get());
+            curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
+            curl_easy_setopt(curl, CURLOPT_PRIVATE, this);
+            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 1L);
+            curl_easy_setopt(curl, CURLOPT_SSLCERTTYPE, "P12");  // Explicitly set certificate type to P12
+            curl_easy_setopt(curl, CURLOPT_CAINFO, config.ca_cert_path.c_str());
+            curl_easy_setopt(curl, CURLOPT_SSLCERT, config.ssl_cert_path.c_str());
+            curl_easy_setopt(curl, CURLOPT_KEYPASSWD, config.cert_password.c_str());
+
+            if (this->request.deadline) {
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        *this->request.deadline - std::chrono::steady_clock::now());
+                curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, static_cast<long>(std::max<std::int64_t>(1, remaining.count())));
+            }
+            curl_easy_setopt(curl, CURLOPT_NOPROGRESS, this->request.cancelled ? 0L : 1L);
+            curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallback);
+            curl_easy_setopt(curl, CURLOPT_XFERINFODATA, this);
+
+            if (this->request.body_source) {
+                curl_easy_setopt(curl, CURLOPT_POST, 1L);
+                curl_easy_setopt(curl, CURLOPT_READFUNCTION, ReadCallback);
+                curl_easy_setopt(curl, CURLOPT_READDATA, this);
+            } else if (method == "POST" || method == "PUT")
+                curl_easy_setopt(curl, CURLOPT_POSTFIELDS, this->request.body.c_str());
+
+            if (method != "POST" && method != "GET")
+                curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method.c_str());
+
+#ifdef ENABLE_DEBUG
+            curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+            curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, curl_debug_callback);
+            curl_easy_setopt(curl, CURLOPT_DEBUGDATA, nullptr);
+#endif
+        }
+
+        Transfer(const Transfer&) = delete;
+        Transfer& operator=(const Transfer&) = delete;
+
+        [[nodiscard]] CURL* curl() const { return handle.get(); }
+
+        TransportResponse finish(CURLcode code) {
+            TransportResponse response{code, 0, {}};
+            response.timing = timing_of(curl());
+            if (code != CURLE_OK) return response;
+            transport.pool.record(curl());
+
+            curl_off_t retry_after = 0;
+            curl_easy_getinfo(curl(), CURLINFO_RESPONSE_CODE, &response.http_status);
+            curl_easy_getinfo(curl(), CURLINFO_RETRY_AFTER, &retry_after);
+            response.retry_after = std::chrono::seconds(retry_after);
+            response.body = std::move(buffer);
+            return response;
+        }
+    };
+
+    class CurlMulti : public Multi {
+        CurlTransport &transport;
+        std::unique_ptr<CURLM, decltype(&curl_multi_cleanup)> multi;
+        std::vector<std::unique_ptr<Transfer>> transfers;
+
+        void collect(std::vector<std::pair<std::size_t, TransportResponse>> &done) {
+            int still_running = 0, queued = 0;
+            curl_multi_perform(multi.get(), &still_running);
+
+            while (CURLMsg *msg = curl_multi_info_read(multi.get(), &queued)) {
+                if (msg->msg != CURLMSG_DONE) continue;
+                CURL *curl = msg->easy_handle;
+                CURLcode code = msg->data.result;
+                Transfer *transfer = nullptr;
+                curl_easy_getinfo(curl, CURLINFO_PRIVATE, &transfer);
+                curl_multi_remove_handle(multi.get(), curl);
+
+                done.emplace_back(transfer->tag, transfer->finish(code));
+                std::erase_if(transfers, [transfer](const auto &owned) { return owned.get() == transfer; });
+            }
+        }
+
+    public:
+        CurlMulti(CurlTransport &transport, unsigned int max_connections) :
+                transport(transport), multi(curl_multi_init(), curl_multi_cleanup) {
+            curl_multi_setopt(multi.get(), CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(max_connections));
+        }
+
+        ~CurlMulti() override {
+            for (const auto &transfer : transfers) curl_multi_remove_handle(multi.get(), transfer->curl());
+        }
+
+        void add(std::size_t tag, TransportRequest request) override {
+            auto &transfer = transfers.emplace_back(std::make_unique<Transfer>(transport, std::move(request)));
+            transfer->tag = tag;
+            curl_multi_add_handle(multi.get(), transfer->curl());
+        }
+
+        std::vector<std::pair<std::size_t, TransportResponse>> poll(std::chrono::milliseconds timeout) override {
+            std::vector<std::pair<std::size_t, TransportResponse>> done;
+            collect(done);
+            if (done.empty() && !transfers.empty()) {
+                curl_multi_poll(multi.get(), nullptr, 0, static_cast<int>(timeout.count()), nullptr);
+                collect(done);
+            }
+            return done;
+        }
+    };
+
+public:
+    explicit CurlTransport(DeviceConfig device) :
+            config(std::move(device)), base_url(warn_uninitialized(config).base_url()),
+            headers(build_headers(config.auth_header(), false)), chunked_headers(build_headers(config.auth_header(), true)) {}
+
+    TransportResponse perform(TransportRequest request) override {
+        Transfer transfer(*this, std::move(request));
+        return transfer.finish(curl_easy_perform(transfer.curl()));
+    }
+
+    std::unique_ptr<Multi> multi(unsigned int max_connections) override {
+        return std::make_unique<CurlMulti>(*this, max_connections);
+    }
+
+    [[nodiscard]] ConnectionStats connection_stats() const override { return pool.stats(); }
+    void reset_connection_stats() override { pool.reset_stats(); }
+};
+
+#endif //FORTI_API_TRANSPORT_HPP
@@ -4,6 +4,7 @@
 
 #include <gtest/gtest.h>
 #include "include/forti_api/api.hpp"
+#include "include/forti_api/record_replay.hpp"
 
 
 class GlobalEnv : public ::testing::Environment {
@@ -11,6 +12,12 @@ public:
     void SetUp() override {
         std::cout << "[INFO] Setting up environment variables for FortiAuth...\n";
         FortiAuth::set_vars_from_env();
+
+        // FORTI_API_RECORD captures a run against a real device, FORTI_API_REPLAY reruns it without one
+        if (const char* replay = std::getenv("FORTI_API_REPLAY")) FortiAPI::set_transport(ReplayTransport::load(replay));
+        else if (const char* record = std::getenv("FORTI_API_RECORD"))
+            FortiAPI::set_transport(std::make_shared<RecordingTransport>(
+                    std::make_shared<CurlTransport>(FortiAuth::get_config()), record));
     }
 
     void TearDown() override {
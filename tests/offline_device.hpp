@@ -0,0 +1,29 @@
+#ifndef FORTI_API_TESTS_OFFLINE_DEVICE_HPP
+#define FORTI_API_TESTS_OFFLINE_DEVICE_HPP
+
+#include <format>
+#include <string>
+#include "include/forti_api.hpp"
+
+
+// Shared by the suites that run against a ReplayTransport instead of a real device.
+inline const DeviceConfig offline_device{"192.0.2.1", 8443, "ca.pem", "cert.p12", "secret", "key"};
+
+inline const std::string success_body = R"({"status":"success","http_status":200})";
+
+inline Exchange answer(std::string method, std::string path, long http_status, std::string body) {
+    return {std::move(method), std::move(path), "", {CURLE_OK, http_status, std::move(body)}};
+}
+
+inline Exchange answer(std::string method, std::string path, std::string body = success_body) {
+    return answer(std::move(method), std::move(path), 200, std::move(body));
+}
+
+// The device's answer to the serial and revision check behind the response cache and snapshots.
+inline Exchange probe(const std::string& revision, const std::string& serial = "FGT60F0000000001") {
+    return answer("GET", "/cmdb/system/global?format=hostname",
+                  std::format(R"({{"status":"success","http_status":200,"serial":"{}","revision":"{}"}})",
+                              serial, revision));
+}
+
+#endif //FORTI_API_TESTS_OFFLINE_DEVICE_HPP
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include "offline_device.hpp"
+
+static std::vector<Filter> device_filters() {
+    std::vector<Filter> filters;
+    for (auto [id, category, action, log] : {std::tuple{1u, 2u, "block", "enable"}, {2u, 7u, "monitor", "disable"},
+                                             {3u, 26u, "allow", "enable"}, {4u, 64u, "block", "disable"},
+                                             {5u, 90u, "warning", "enable"}}) {
+        Filter filter(category, action);
+        filter.id = id;
+        filter.q_origin_key = id;
+        filter.log = log;
+        filters.push_back(filter);
+    }
+    return filters;
+}
+
+TEST(TestCategoryFilter, TestRoundTripIsLossless) {
+    auto filters = device_filters();
+    CategoryFilter dense(filters);
+    ASSERT_EQ(dense.filters(), filters);
+    ASSERT_EQ(dense.size(), 5u);
+
+    auto shuffled = filters;
+    std::reverse(shuffled.begin(), shuffled.end());
+    ASSERT_EQ(CategoryFilter(shuffled).filters(), filters);
+
+    // q_origin_key is read-only, so it is never sent back to the device
+    DNSFilterOptions options;
+    options.set_categories(dense);
+    auto decoded = nlohmann::json::parse(nlohmann::json(options).dump()).get<DNSFilterOptions>();
+    for (auto& filter : filters) filter.q_origin_key = 0;
+    ASSERT_EQ(decoded.filters, filters);
+    ASSERT_EQ(decoded.categories(), CategoryFilter(filters));
+}
+
+TEST(TestCategoryFilter, TestQueries) {
+    CategoryFilter dense(device_filters());
+    ASSERT_EQ(dense.action(2), CategoryAction::BLOCK);
+    ASSERT_EQ(dense.action(7), CategoryAction::MONITOR);
+    ASSERT_EQ(dense.action(26), CategoryAction::ALLOW);
+    ASSERT_TRUE(dense.contains(26));
+    ASSERT_FALSE(dense.contains(3));
+    ASSERT_FALSE(dense.contains(100'000));
+    ASSERT_EQ(dense.attributes_of(7).log, "disable");
+    ASSERT_EQ(dense.attributes_of(90).action, "warning");
+    ASSERT_EQ(dense.blocked_categories(), (CategoryBitmap{2, 64}));
+}
+
+TEST(TestCategoryFilter, TestChangesMatchFilterList) {
+    DNSFilterOptions list;
+    list.filters = device_filters();
+    CategoryFilter dense(list.filters);
+
+    std::vector<CategoryChange> changes{{2, CategoryAction::MONITOR}, {26, CategoryAction::ALLOW},
+                                        {90, CategoryAction::BLOCK},  {300, CategoryAction::BLOCK},
+                                        {5, CategoryAction::ALLOW},   {64, CategoryAction::BLOCK}};
+    for (const auto& change : changes) list.apply(change);
+    ASSERT_TRUE(dense.apply(changes));
+    ASSERT_EQ(dense.filters(), list.filters);
+    ASSERT_EQ(dense.attributes_of(2).id, 1u);
+
+    ASSERT_FALSE(dense.apply({{64, CategoryAction::BLOCK}, {5, CategoryAction::ALLOW}}));
+    ASSERT_FALSE(list.apply({{64, CategoryAction::BLOCK}}));
+}
+
+TEST(TestCategoryFilter, TestSetOperations) {
+    CategoryFilter profile(device_filters());
+
+    CategoryFilter extra;
+    extra.set(7, CategoryAction::BLOCK);
+    extra.set(120, CategoryAction::MONITOR);
+    auto merged = profile;
+    ASSERT_TRUE(merged.merge(extra));
+    ASSERT_EQ(merged.action(7), CategoryAction::BLOCK);
+    ASSERT_EQ(merged.action(120), CategoryAction::MONITOR);
+    ASSERT_EQ(merged.attributes_of(7).id, 2u);
+    ASSERT_FALSE(merged.merge(extra));
+
+    ASSERT_TRUE(merged.remove(extra.categories()));
+    ASSERT_FALSE(merged.contains(7));
+    ASSERT_FALSE(merged.contains(120));
+    ASSERT_FALSE(merged.remove(CategoryBitmap{7, 1000}));
+
+    auto changes = profile.diff(merged);
+    ASSERT_EQ(changes.size(), 1u);
+    ASSERT_EQ(changes[0].category, 7u);
+    ASSERT_EQ(changes[0].action, CategoryAction::ALLOW);
+    ASSERT_TRUE(profile.apply(changes));
+    ASSERT_EQ(profile, merged);
+}
+
+TEST(TestCategoryFilter, TestConformToTemplate) {
+    CategoryFilter policy;
+    policy.set(2, CategoryAction::MONITOR);
+    policy.set(64, CategoryAction::BLOCK);
+    policy.set(150, CategoryAction::BLOCK);
+
+    DNSFilterOptions options;
+    options.filters = device_filters();
+    ASSERT_TRUE(options.conform_to(policy));
+    ASSERT_FALSE(options.conform_to(policy));
+
+    auto dense = options.categories();
+    ASSERT_EQ(dense.categories(), (CategoryBitmap{2, 64, 150}));
+    ASSERT_EQ(dense.action(2), CategoryAction::MONITOR);
+    ASSERT_EQ(dense.attributes_of(64).id, 4u);
+    ASSERT_EQ(dense.attributes_of(64).log, "disable");
+    ASSERT_EQ(dense.attributes_of(150).id, 0u);
+    ASSERT_TRUE(dense.diff(policy).empty());
+}
+
+TEST(TestCategoryFilter, TestDeviceIdsSurviveEdits) {
+    // as the device lists them: every entry numbered
+    std::vector<Filter> listed;
+    for (unsigned int category = 0; category < 200; category += 3) {
+        auto& filter = listed.emplace_back(category, category % 2 ? "block" : "monitor");
+        filter.id = filter.q_origin_key = category / 3 + 1;
+    }
+    CategoryFilter dense(listed);
+    ASSERT_EQ(dense.filters(), listed);
+    ASSERT_EQ(dense.attributes_of(198).q_origin_key, 67u);
+
+    // dropping the highest entry and putting it back unnumbered compares equal to a fresh one
+    auto edited = dense;
+    ASSERT_TRUE(edited.set(198, CategoryAction::ALLOW));
+    ASSERT_EQ(edited.attributes_of(198).id, 0u);
+    ASSERT_TRUE(edited.set(198, CategoryAction::MONITOR));
+    listed.back().id = listed.back().q_origin_key = 0;
+    ASSERT_EQ(edited, CategoryFilter(listed));
+    ASSERT_NE(edited, dense);
+}
+
+TEST(TestCategoryFilter, TestApplyTemplateOnlyUpdatesProfilesThatDiffer) {
+    DNSProfilesResponse listing;
+    listing.status = "success";
+    listing.http_status = 200;
+    listing.results = {DNSProfile("office"), DNSProfile("guest")};
+    listing.results[0].block_category(26);
+
+    auto replay = std::make_shared<ReplayTransport>(std::vector<Exchange>{
+            answer("GET", "/cmdb/dnsfilter/profile", nlohmann::json(listing).dump()),
+            answer("PUT", "/cmdb/dnsfilter/profile/guest"),
+    });
+    FortiAPI::Scope scope(FortiClient::create(offline_device, replay));
+
+    CategoryFilter policy;
+    policy.set(26, CategoryAction::BLOCK);
+    auto results = DNSFilter::apply_template(policy);
+    ASSERT_EQ(results.size(), 1u);
+    ASSERT_TRUE(results[0].has_value());
+    ASSERT_EQ(replay->stats().misses, 0u);
+}
@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "include/forti_api.hpp"
+
+TEST(TestClient, TestClientsOwnTheirConfig) {
+    DeviceConfig first{"192.0.2.1", 8443, "ca.pem", "cert.p12", "secret", "key-one"};
+    auto second_config = first;
+    second_config.gateway_ip = "192.0.2.2";
+    second_config.api_key = "key-two";
+
+    auto a = FortiClient::create(first), b = FortiClient::create(second_config);
+    ASSERT_EQ(a->get_config().base_url(), "https://192.0.2.1:8443/api/v2");
+    ASSERT_EQ(b->get_config().base_url(), "https://192.0.2.2:8443/api/v2");
+    ASSERT_EQ(b->get_config().auth_header(), "Authorization: Bearer key-two");
+
+    a->enable_cache();
+    a->reset_cache_stats();
+    ASSERT_EQ(b->cache_stats().hits, 0u);
+}
+
+TEST(TestClient, TestDefaultClientFollowsFortiAuth) {
+    auto saved = FortiAuth::get_config();
+    auto client = FortiAPI::client();
+    ASSERT_EQ(FortiAPI::client(), client);
+
+    std::vector<std::shared_ptr<FortiClient>> seen(8);
+    std::vector<std::thread> threads;
+    for (auto& slot : seen) threads.emplace_back([&slot] { slot = FortiAPI::client(); });
+    for (auto& thread : threads) thread.join();
+    for (const auto& other : seen) ASSERT_EQ(other, client);
+
+    FortiAuth::set_gateway_ip("192.0.2.10");
+    auto rebuilt = FortiAPI::client();
+    ASSERT_NE(rebuilt, client);
+    ASSERT_EQ(rebuilt->get_config().gateway_ip, "192.0.2.10");
+    ASSERT_EQ(client->get_config().gateway_ip, saved.gateway_ip);
+
+    FortiAuth::set_config(saved);
+    ASSERT_EQ(FortiAPI::client()->get_config(), saved);
+}
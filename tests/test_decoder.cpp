@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include "include/forti_api.hpp"
+
+template<typename T>
+T decode_with_dom(const std::string& payload) {
+    return convert_keys_to_underscores(nlohmann::json::parse(payload));
+}
+
+TEST(TestDecoder, TestEntryListMatchesDomPath) {
+    std::string payload = R"({"http_method":"GET","size":2,"status":"success","http_status":200,"build":2662,
+        "results":{"status":"enable","resource-file-status":"valid","last-content-update-time":1725000000,
+        "entries":[{"entry":"ads.example.com","valid":"true"},{"entry":"bad..domain","valid":"false"}]}})";
+
+    auto response = SaxDecoder::decode<ExternalResourceEntryListResponse>(payload);
+    ASSERT_EQ(response.results.entries.size(), 2u);
+    ASSERT_EQ(response.results.entries[1].entry, "bad..domain");
+    ASSERT_EQ(response.results.resource_file_status, "valid");
+    ASSERT_EQ(response.results.last_content_update_time, 1725000000u);
+    ASSERT_EQ(nlohmann::json(response), nlohmann::json(decode_with_dom<ExternalResourceEntryListResponse>(payload)));
+}
+
+TEST(TestDecoder, TestHyphenatedKeysAndUnknownFields) {
+    std::string payload = R"({"status":"success","http_status":200,"unknown":{"deep":[1,{"x":2}]},
+        "results":[{"name":"advanced","block-action":"block","ftgd-dns":{"options":"error-allow",
+        "filters":[{"id":1,"q_origin_key":1,"category":193,"action":"block","log":"enable","extra":null}]}}]})";
+
+    auto response = SaxDecoder::decode<DNSProfilesResponse>(payload);
+    ASSERT_EQ(response.results.size(), 1u);
+    ASSERT_EQ(response.results[0].block_action, "block");
+    ASSERT_EQ(response.results[0].ftgd_dns.options, "error-allow");
+    ASSERT_TRUE(response.results[0].contains_category(193));
+    ASSERT_EQ(nlohmann::json(response), nlohmann::json(decode_with_dom<DNSProfilesResponse>(payload)));
+}
+
+TEST(TestDecoder, TestRawJsonMembersKeepWireKeys) {
+    std::string payload = R"({"status":"success","results":[{"name":"wan1","type":"physical",
+        "real-interface-name":"wan1","ipv4_addresses":[{"ip":"203.0.113.7","cidr_netmask":24}]}]})";
+
+    auto response = SaxDecoder::decode<InterfacesGeneralResponse>(payload);
+    ASSERT_EQ(response.results.size(), 1u);
+    ASSERT_TRUE(response.results[0].contains("real-interface-name"));
+
+    SystemInterface interface = response.results[0];
+    ASSERT_EQ(interface.real_interface_name, "wan1");
+    ASSERT_EQ(interface.ipv4_addresses[0].ip, "203.0.113.7");
+}
+
+TEST(TestDecoder, TestWireNamesOnSerialization) {
+    nlohmann::json feed = PushThreatFeed("test-feed", 219);
+    ASSERT_EQ(feed["update-method"], "push");
+    ASSERT_EQ(feed["server-identity-check"], "none");
+    ASSERT_FALSE(feed.contains("update_method"));
+
+    nlohmann::json filter = Filter(193, "block");
+    ASSERT_FALSE(filter.contains("q_origin_key"));
+
+    DNSProfile profile = nlohmann::json{{"name", "advanced"}, {"q_origin_key", "advanced"}, {"block-action", "block"}};
+    ASSERT_EQ(profile.q_origin_key, "advanced");
+    ASSERT_EQ(profile.block_action, "block");
+    ASSERT_EQ(nlohmann::json(profile)["ftgd-dns"]["options"], "");
+}
+
+TEST(TestDecoder, TestMalformedInputThrowsParseError) {
+    ASSERT_THROW(SaxDecoder::decode<DNSProfilesResponse>(R"({"status":"success","results":[)"),
+                 nlohmann::json::parse_error);
+    ASSERT_THROW(SaxDecoder::decode<DNSProfilesResponse>("not json"), nlohmann::json::parse_error);
+}
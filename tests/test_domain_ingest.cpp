@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include "include/forti_api/domain_ingest.hpp"
+
+TEST(TestDomainIngest, TestMixedFormats) {
+    std::string list = "# hosts style\n"
+                       "0.0.0.0 Ads.Example.com # tracker\n"
+                       "127.0.0.1 localhost\n"
+                       "0.0.0.0 one.example.com two.example.com\r\n"
+                       "plain.example.org.\n"
+                       "||adblock.example.net^\n"
+                       "||conditional.example.net^$third-party\n"
+                       "! adblock comment\n"
+                       "not_a domain\n"
+                       "-bad.example.com\n"
+                       "192.168.1.1\n"
+                       "ads.example.com";
+
+    auto domains = DomainIngest::ingest(list);
+    std::vector<std::string> expected{"adblock.example.net", "ads.example.com", "one.example.com",
+                                      "plain.example.org", "two.example.com"};
+    ASSERT_EQ(domains, expected);
+}
+
+TEST(TestDomainIngest, TestParallelMatchesSerial) {
+    std::string list;
+    for (int i = 0; i < 20000; ++i) list += std::format("0.0.0.0 host{}.Example.com\nhost{}.example.com\n", i % 15000, i);
+
+    IngestOptions serial;
+    IngestOptions parallel;
+    parallel.threads = 4;
+    parallel.parallel_threshold = 0;
+
+    auto expected = DomainIngest::ingest(list, serial);
+    ASSERT_EQ(expected.size(), 20000u);
+    ASSERT_EQ(DomainIngest::ingest(list, parallel), expected);
+}
+
+TEST(TestDomainIngest, TestIdna) {
+    std::string domain;
+    ASSERT_FALSE(DomainIngest::normalize("bücher.example", domain));
+    ASSERT_TRUE(DomainIngest::normalize("Bücher.example", domain, true));
+    ASSERT_EQ(domain, "xn--bcher-kva.example");
+    ASSERT_TRUE(DomainIngest::normalize("ёлка.рф", domain, true));
+    ASSERT_EQ(domain, "xn--80atc1g.xn--p1ai");
+}
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include <format>
+#include <set>
+#include "include/forti_api/domain_set.hpp"
+
+TEST(TestDomainSet, TestExactAndParentMembership) {
+    DomainSet set({{"example.com", true}, {"ads.tracker.net", false}, {"Shop.Example.org.", true}, {"example.com", false}});
+
+    ASSERT_EQ(set.size(), 3u);
+    ASSERT_TRUE(set.contains("example.com"));
+    ASSERT_TRUE(set.contains("shop.example.org"));
+    ASSERT_FALSE(set.contains("www.example.com"));
+    ASSERT_FALSE(set.contains("tracker.net"));
+
+    ASSERT_TRUE(set.covers("www.example.com"));
+    ASSERT_TRUE(set.covers("a.b.ads.tracker.net"));
+    ASSERT_FALSE(set.covers("tracker.net"));
+    ASSERT_FALSE(set.covers("notexample.com"));
+
+    ASSERT_EQ(set.is_valid("example.com"), true);
+    ASSERT_EQ(set.is_valid("ads.tracker.net"), false);
+    ASSERT_FALSE(set.is_valid("missing.com").has_value());
+}
+
+TEST(TestDomainSet, TestMatchesReferenceSetAcrossBlocks) {
+    std::vector<std::pair<std::string, bool>> domains;
+    std::set<std::string> reference;
+    for (std::size_t i = 0; i < 5000; ++i) {
+        auto domain = std::format("host{}.zone{}.example.com", i * 7919 % 5000, i % 13);
+        domains.emplace_back(domain, i % 2 == 0);
+        reference.insert(domain);
+    }
+    DomainSet set(domains);
+    ASSERT_EQ(set.size(), reference.size());
+
+    for (const auto& domain : reference) ASSERT_TRUE(set.contains(domain)) << domain;
+    for (std::size_t i = 5000; i < 5100; ++i) ASSERT_FALSE(set.contains(std::format("host{}.zone1.example.com", i)));
+
+    std::size_t visited = 0;
+    set.for_each([&](std::string_view domain, bool) {
+        ASSERT_TRUE(reference.contains(std::string(domain)));
+        ++visited;
+    });
+    ASSERT_EQ(visited, reference.size());
+}
+
+TEST(TestDomainSet, TestMovedInDomainsBuildTheSameSet) {
+    std::vector<std::pair<std::string, bool>> domains{
+            {"example.com", true}, {"", true}, {"Ads.Tracker.NET", false}, {"example.com", false}, {".", true}};
+    DomainSet copied(domains);
+    DomainSet moved(std::move(domains));
+
+    ASSERT_EQ(moved.size(), 2u);
+    ASSERT_EQ(moved.size(), copied.size());
+    ASSERT_EQ(moved.is_valid("example.com"), true);
+    ASSERT_EQ(moved.is_valid("ads.tracker.net"), false);
+    ASSERT_TRUE(moved.covers("www.ads.tracker.net"));
+}
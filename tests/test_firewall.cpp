@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include "offline_device.hpp"
+
+TEST(TestFirewall, TestWithQuery) {
+    ASSERT_EQ(with_query("/cmdb/firewall/policy", "start=0&count=10"), "/cmdb/firewall/policy?start=0&count=10");
+    ASSERT_EQ(with_query("/cmdb/firewall/policy?vdom=root", "start=0"), "/cmdb/firewall/policy?vdom=root&start=0");
+    ASSERT_EQ(with_query("/cmdb/firewall/policy", ""), "/cmdb/firewall/policy");
+}
+
+TEST(TestFirewall, TestPagedPoliciesMatchFullTable) {
+    auto policies = FortiGate::Policy::get();
+
+    std::vector<unsigned int> paged;
+    for (const auto& policy : FortiGate::Policy::range(7)) paged.push_back(policy.policyid);
+
+    ASSERT_EQ(paged.size(), policies.size());
+    for (std::size_t i = 0; i < policies.size(); ++i) ASSERT_EQ(paged[i], policies[i].policyid);
+}
+
+static FirewallPolicy make_policy(unsigned int id, const std::string& name, const std::string& srcintf,
+                                  const std::string& dstaddr, const std::string& dnsfilter_profile) {
+    FirewallPolicy policy;
+    policy.policyid = id;
+    policy.name = name;
+    policy.srcintf.push_back({{srcintf, srcintf}});
+    policy.dstintf.push_back({{"wan1", "wan1"}});
+    policy.dstaddr.push_back({{dstaddr, dstaddr}});
+    policy.service.push_back({{"ALL", "ALL"}});
+    policy.dnsfilter_profile = dnsfilter_profile;
+    return policy;
+}
+
+TEST(TestFirewall, TestPolicyTableIndexes) {
+    PolicyTable table({make_policy(1, "lan-out", "lan", "all", "default"),
+                       make_policy(2, "guest-out", "guest", "all", "strict"),
+                       make_policy(3, "lan-dmz", "lan", "dmz-servers", "default")});
+
+    ASSERT_EQ(table.by_name("guest-out")->policyid, 2u);
+    ASSERT_EQ(table.by_id(3)->name, "lan-dmz");
+    ASSERT_EQ(table.by(PolicyTable::Field::SRCINTF, "lan").size(), 2u);
+    ASSERT_EQ(table.by_interface("wan1").size(), 3u);
+    ASSERT_EQ(table.by_address("dmz-servers").size(), 1u);
+    ASSERT_EQ(table.by_dnsfilter_profile("default").size(), 2u);
+
+    table.upsert(make_policy(1, "lan-out-renamed", "lan", "all", "strict"));
+    ASSERT_EQ(table.by_name("lan-out"), nullptr);
+    ASSERT_EQ(table.by_name("lan-out-renamed")->policyid, 1u);
+    ASSERT_EQ(table.by_dnsfilter_profile("default").size(), 1u);
+    ASSERT_EQ(table.by_dnsfilter_profile("strict").size(), 2u);
+
+    ASSERT_TRUE(table.erase(3));
+    ASSERT_FALSE(table.erase(3));
+    ASSERT_TRUE(table.by_address("dmz-servers").empty());
+    ASSERT_EQ(table.size(), 2u);
+}
+
+TEST(TestFirewall, TestPolicyUpdateKeepsTableCurrent) {
+    FirewallPoliciesResponse listing;
+    listing.status = "success";
+    listing.http_status = 200;
+    listing.results = {make_policy(1, "lan-out", "lan", "all", "default"), make_policy(2, "", "guest", "all", "strict")};
+
+    auto replay = std::make_shared<ReplayTransport>(std::vector<Exchange>{
+            answer("GET", "/cmdb/firewall/policy?start=0&count=1000", nlohmann::json(listing).dump()),
+            answer("PUT", "/cmdb/firewall/policy/2")});
+    FortiAPI::Scope scope(FortiClient::create(offline_device, replay));
+    FortiGate::Policy::reload();
+
+    auto policy = *FortiGate::Policy::table()->by_id(2);
+    policy.comments = "updated by TestPolicyUpdateKeepsTableCurrent";
+    FortiGate::Policy::update(policy);
+    ASSERT_EQ(FortiGate::Policy::table()->by_id(2)->comments, policy.comments);
+    ASSERT_EQ(replay->stats().served, 2u);
+    ASSERT_EQ(replay->stats().misses, 0u);
+    FortiGate::Policy::reload();
+}
+
+TEST(TestFirewall, TestPolicyTableExpires) {
+    using namespace std::chrono_literals;
+    FirewallPoliciesResponse before, after;
+    before.status = after.status = "success";
+    before.http_status = after.http_status = 200;
+    before.results = {make_policy(1, "lan-out", "lan", "all", "default")};
+    after.results = {make_policy(1, "lan-out", "lan", "all", "strict")};
+
+    auto replay = std::make_shared<ReplayTransport>(std::vector<Exchange>{
+            answer("GET", "/cmdb/firewall/policy?start=0&count=1000", nlohmann::json(before).dump()),
+            answer("GET", "/cmdb/firewall/policy?start=0&count=1000", nlohmann::json(after).dump()),
+            answer("PUT", "/cmdb/firewall/policy/1")});
+    FortiAPI::Scope scope(FortiClient::create(offline_device, replay));
+    FortiGate::Policy::reload();
+    FortiGate::Policy::set_max_age(50ms);
+
+    // a table handed out stays as it was, whatever happens to the device's entry afterwards
+    auto held = FortiGate::Policy::table();
+    ASSERT_EQ(FortiGate::Policy::get("lan-out").dnsfilter_profile, "default");
+    auto renamed = *held->by_id(1);
+    renamed.comments = "edited";
+    FortiGate::Policy::update(renamed);
+    ASSERT_TRUE(held->by_id(1)->comments.empty());
+    ASSERT_EQ(FortiGate::Policy::table()->by_id(1)->comments, "edited");
+    ASSERT_EQ(replay->stats().served, 2u);
+
+    // another admin's change shows up once the table is older than the max age
+    std::this_thread::sleep_for(60ms);
+    ASSERT_EQ(FortiGate::Policy::get("lan-out").dnsfilter_profile, "strict");
+    ASSERT_EQ(held->by_id(1)->dnsfilter_profile, "default");
+
+    FortiGate::Policy::set_max_age(std::chrono::minutes(1));
+    FortiGate::Policy::reload();
+}
+
+TEST(TestFirewall, TestLeavingARangeEarlyDoesNotWaitForThePrefetch) {
+    using namespace std::chrono_literals;
+    FirewallPoliciesResponse first;
+    first.status = "success";
+    first.http_status = 200;
+    first.results = {make_policy(1, "lan-out", "lan", "all", "default"), make_policy(2, "guest-out", "guest", "all", "strict")};
+
+    Exchange second = answer("GET", "/cmdb/firewall/policy?start=2&count=2", nlohmann::json(first).dump());
+    second.latency = 500ms;
+    auto replay = std::make_shared<ReplayTransport>(
+            std::vector<Exchange>{answer("GET", "/cmdb/firewall/policy?start=0&count=2", nlohmann::json(first).dump()),
+                                  second},
+            ReplayOptions{.recorded_latency_scale = 1});
+    FortiAPI::Scope scope(FortiClient::create(offline_device, replay));
+
+    auto started = std::chrono::steady_clock::now();
+    for (const auto& policy : FortiGate::Policy::range(2)) {
+        ASSERT_EQ(policy.policyid, 1u);
+        break;
+    }
+    ASSERT_LT(std::chrono::steady_clock::now() - started, 400ms);
+}
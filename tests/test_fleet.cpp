@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "offline_device.hpp"
+
+static std::vector<FleetDevice> inventory(std::size_t count) {
+    std::vector<FleetDevice> devices;
+    for (std::size_t i = 0; i < count; ++i)
+        devices.push_back({std::format("fgt-{}", i), {std::format("192.0.2.{}", i + 1), 443, "ca.pem", "cert.p12", "pass", "key"}});
+    return devices;
+}
+
+TEST(TestFleet, TestRunsEachDeviceOnItsOwnClient) {
+    Fleet fleet(inventory(12), {.parallelism = 3});
+    std::atomic<int> running{0}, peak{0};
+
+    auto report = fleet.run([&](FortiClient& client) {
+        int now = ++running;
+        for (int seen = peak; now > seen && !peak.compare_exchange_weak(seen, now);) {}
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        --running;
+        if (client.get_config().gateway_ip == "192.0.2.5") throw std::runtime_error("unreachable");
+        return FortiAPI::client()->get_config().gateway_ip;
+    });
+
+    ASSERT_EQ(report.devices.size(), 12u);
+    ASSERT_LE(peak.load(), 3);
+    ASSERT_EQ(report.succeeded(), 11u);
+    ASSERT_EQ(report.devices[2].device, "fgt-2");
+    ASSERT_EQ(*report.devices[2].result, "192.0.2.3");
+    ASSERT_EQ(report.devices[4].result.error().message, "unreachable");
+    ASSERT_EQ(fleet.client("fgt-7")->get_config().gateway_ip, "192.0.2.8");
+    ASSERT_NE(FortiAPI::client(), fleet.client("fgt-0"));
+}
+
+TEST(TestFleet, TestTimeoutsAndFailedResponses) {
+    Fleet fleet(inventory(2), {.parallelism = 2, .timeout = std::chrono::milliseconds(10)});
+
+    auto slow = fleet.run([](FortiClient& client) {
+        if (client.get_config().gateway_ip == "192.0.2.1") {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            throw std::runtime_error("deadline exceeded");
+        }
+    });
+    ASSERT_TRUE(slow.devices[0].timed_out);
+    ASSERT_TRUE(slow.devices[1].result.has_value());
+    ASSERT_EQ(slow.timed_out(), 1u);
+
+    auto responses = fleet.run([](FortiClient&) {
+        Response response;
+        response.status = "error";
+        response.http_status = 424;
+        return response;
+    });
+    ASSERT_EQ(responses.failed(), 2u);
+    ASSERT_EQ(responses.devices[0].result.error().http_status, 424);
+}
+
+// A device with one policy and one WAN address, both telling the devices apart.
+static std::shared_ptr<FortiClient> device(const std::string& gateway, const std::string& policy_name,
+                                           const std::string& wan_ip) {
+    FirewallPoliciesResponse policies;
+    policies.status = "success";
+    policies.http_status = 200;
+    policies.results.emplace_back();
+    policies.results[0].policyid = 1;
+    policies.results[0].name = policy_name;
+
+    auto interfaces = std::format(R"({{"status":"success","results":[{{"name":"wan1","type":"physical","vdom":"root",)"
+                                  R"("ipv4_addresses":[{{"ip":"{}","cidr_netmask":24}}]}}]}})", wan_ip);
+    auto config = offline_device;
+    config.gateway_ip = gateway;
+    return FortiClient::create(config, std::make_shared<ReplayTransport>(std::vector<Exchange>{
+            answer("GET", "/cmdb/firewall/policy?start=0&count=1000", nlohmann::json(policies).dump()),
+            answer("GET", "/monitor/system/available-interfaces", interfaces)}));
+}
+
+TEST(TestFleet, TestTablesAreKeptPerDevice) {
+    auto first = device("192.0.2.21", "first-out", "203.0.113.1"),
+         second = device("192.0.2.22", "second-out", "203.0.113.2");
+
+    for (int pass = 0; pass < 2; ++pass) {
+        {
+            FortiAPI::Scope scope(first);
+            ASSERT_EQ(FortiGate::Policy::table()->by_id(1)->name, "first-out");
+            ASSERT_EQ(System::Interface::get_wan_ip(), "203.0.113.1");
+        }
+        {
+            FortiAPI::Scope scope(second);
+            ASSERT_EQ(FortiGate::Policy::get("second-out").policyid, 1u);
+            ASSERT_EQ(System::Interface::get_wan_ip(), "203.0.113.2");
+        }
+    }
+}
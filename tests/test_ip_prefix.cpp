@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "include/forti_api/system.hpp"
+
+static IPPrefix prefix(std::string_view text) {
+    auto parsed = IPPrefix::parse(text);
+    EXPECT_TRUE(parsed.has_value()) << text;
+    return parsed.value_or(IPPrefix{});
+}
+
+TEST(TestIPPrefix, TestParseAddresses) {
+    ASSERT_EQ(IPAddress::parse("192.168.1.20")->v4(), 0xc0a80114u);
+    ASSERT_FALSE(IPAddress::parse("192.168.1").has_value());
+    ASSERT_FALSE(IPAddress::parse("192.168.1.256").has_value());
+    ASSERT_FALSE(IPAddress::parse("192.168.1.2x").has_value());
+    ASSERT_FALSE(IPAddress::parse("1.2.3.4.5").has_value());
+
+    ASSERT_EQ(IPAddress::parse("::1")->to_string(), "::1");
+    ASSERT_EQ(IPAddress::parse("::")->to_string(), "::");
+    ASSERT_EQ(IPAddress::parse("2001:0DB8:0000:0000:0000:ff00:0042:8329")->to_string(), "2001:db8::ff00:42:8329");
+    ASSERT_EQ(IPAddress::parse("2001:db8:0:1:1:1:1:1")->to_string(), "2001:db8:0:1:1:1:1:1");
+    ASSERT_EQ(IPAddress::parse("2001:0:0:1:0:0:0:1")->to_string(), "2001:0:0:1::1");
+    ASSERT_EQ(IPAddress::parse("::ffff:10.0.0.1"), IPAddress::parse("::ffff:a00:1"));
+    ASSERT_FALSE(IPAddress::parse("1::2::3").has_value());
+    ASSERT_FALSE(IPAddress::parse("1:2:3:4:5:6:7").has_value());
+    ASSERT_FALSE(IPAddress::parse("1:2:3:4:5:6:7:8:9").has_value());
+    ASSERT_FALSE(IPAddress::parse("12345::").has_value());
+    ASSERT_FALSE(IPAddress::parse("fe80::1%eth0").has_value());
+}
+
+TEST(TestIPPrefix, TestParsePrefixes) {
+    ASSERT_EQ(prefix("10.1.2.3/8").to_string(), "10.0.0.0/8");
+    ASSERT_EQ(prefix("10.1.2.0 255.255.255.0"), prefix("10.1.2.0/24"));
+    ASSERT_EQ(prefix("10.1.2.0/255.255.255.0"), prefix("10.1.2.0/24"));
+    ASSERT_EQ(prefix("0.0.0.0 0.0.0.0").length, 0u);
+    ASSERT_EQ(prefix("10.1.2.3").length, 32u);
+    ASSERT_EQ(prefix("2001:db8::7/32").to_string(), "2001:db8::/32");
+    ASSERT_EQ(prefix("10.1.2.0/24").to_trusthost(), "10.1.2.0 255.255.255.0");
+    ASSERT_EQ(prefix("2001:db8::/48").to_trusthost(), "2001:db8::/48");
+
+    ASSERT_FALSE(IPPrefix::parse("10.0.0.0/33").has_value());
+    ASSERT_FALSE(IPPrefix::parse("10.0.0.0 255.0.255.0").has_value());
+    ASSERT_FALSE(IPPrefix::parse("::/129").has_value());
+    ASSERT_FALSE(IPPrefix::parse("::/255.255.0.0").has_value());
+
+    ASSERT_TRUE(prefix("10.0.0.0/8").contains(prefix("10.20.0.0/16")));
+    ASSERT_FALSE(prefix("10.20.0.0/16").contains(prefix("10.0.0.0/8")));
+    ASSERT_FALSE(prefix("0.0.0.0/0").contains(*IPAddress::parse("::1")));
+}
+
+TEST(TestIPPrefix, TestPrefixSetKeepsMinimalCover) {
+    PrefixSet set;
+    ASSERT_TRUE(set.insert(prefix("10.1.0.0/16")));
+    ASSERT_TRUE(set.insert(prefix("10.2.3.0/24")));
+    ASSERT_FALSE(set.insert(prefix("10.1.5.0/24")));
+    ASSERT_TRUE(set.insert(prefix("2001:db8::/32")));
+    ASSERT_EQ(set.size(), 3u);
+
+    ASSERT_TRUE(set.covers(*IPAddress::parse("10.1.200.7")));
+    ASSERT_FALSE(set.covers(*IPAddress::parse("10.3.0.1")));
+    ASSERT_TRUE(set.covers(*IPAddress::parse("2001:db8:ffff::1")));
+    ASSERT_FALSE(set.covers(*IPAddress::parse("2001:db9::1")));
+
+    ASSERT_TRUE(set.insert(prefix("10.0.0.0/8")));
+    ASSERT_EQ(set.size(), 2u);
+    ASSERT_EQ(set.prefixes()[0].to_string(), "10.0.0.0/8");
+    ASSERT_EQ(set.prefixes()[1].to_string(), "2001:db8::/32");
+
+    ASSERT_FALSE(set.erase(prefix("10.1.0.0/16")));
+    ASSERT_TRUE(set.erase(prefix("10.0.0.0/8")));
+    ASSERT_FALSE(set.covers(*IPAddress::parse("10.1.200.7")));
+    ASSERT_EQ(set.size(), 1u);
+
+    ASSERT_TRUE(set.insert(prefix("0.0.0.0/0")));
+    ASSERT_TRUE(set.covers(*IPAddress::parse("203.0.113.9")));
+    ASSERT_FALSE(set.covers(*IPAddress::parse("::1")));
+}
+
+TEST(TestIPPrefix, TestAPIUserTrusthosts) {
+    APIUser user = nlohmann::json::parse(R"({"name":"automation","trusthost":[
+        {"id":1,"type":"ipv4-trusthost","ipv4-trusthost":"10.0.0.0 255.255.255.0"},
+        {"id":2,"type":"ipv6-trusthost","ipv6-trusthost":"2001:db8::/64"}]})");
+    ASSERT_TRUE(user.covers("10.0.0.77"));
+    ASSERT_TRUE(user.covers("2001:db8::42"));
+    ASSERT_FALSE(user.covers("10.0.1.1"));
+    ASSERT_FALSE(user.covers("not an ip"));
+    ASSERT_TRUE(user.is_trusted("10.0.0.0/24"));
+
+    user.trust("10.0.0.5");  // already covered
+    ASSERT_EQ(user.trusthost.size(), 2u);
+    user.trust("10.0.0.0/16");
+    ASSERT_EQ(user.trusthost.size(), 2u);
+    ASSERT_TRUE(user.covers("10.0.200.1"));
+    user.trust("2001:db8:1::/48");
+    ASSERT_EQ(nlohmann::json(user.trusthost)[2]["type"], "ipv6-trusthost");
+
+    user.distrust("10.0.0.0 255.255.0.0");
+    ASSERT_FALSE(user.covers("10.0.0.77"));
+    ASSERT_EQ(user.trusthost.size(), 2u);
+}
+
+TEST(TestIPPrefix, TestDistrustNestedEntries) {
+    auto nested = nlohmann::json::parse(R"({"name":"automation","trusthost":[
+        {"id":1,"type":"ipv4-trusthost","ipv4-trusthost":"10.0.0.0 255.0.0.0"},
+        {"id":2,"type":"ipv4-trusthost","ipv4-trusthost":"10.1.0.0 255.255.0.0"}]})");
+
+    APIUser inner = nested;
+    inner.distrust("10.1.0.0/16");
+    ASSERT_EQ(inner.trusthost.size(), 1u);
+    ASSERT_TRUE(inner.covers("10.1.2.3"));
+
+    APIUser outer = nested;
+    outer.distrust("10.0.0.0/8");
+    ASSERT_EQ(outer.trusthost.size(), 1u);
+    ASSERT_TRUE(outer.covers("10.1.2.3"));
+    ASSERT_FALSE(outer.covers("10.2.0.1"));
+    ASSERT_TRUE(outer.is_trusted("10.1.0.0/16"));
+
+    outer.distrust("10.1.0.0/16");
+    ASSERT_TRUE(outer.trusthost.empty());
+    ASSERT_FALSE(outer.covers("10.1.2.3"));
+}
+
+TEST(TestIPPrefix, TestSyncTrusthosts) {
+    APIUser user;
+    user.trust("192.0.2.0/24");
+    auto kept = user.trusthost[0];
+
+    std::vector<std::string> subnets{"192.0.2.0 255.255.255.0", "198.51.100.0/24", "198.51.100.128/25", "::1"};
+    for (int i = 0; i < 2000; ++i) subnets.push_back(std::format("172.16.{}.{}", i / 256, i % 256));
+    ASSERT_TRUE(user.sync_trusthosts(subnets));
+    ASSERT_EQ(user.trusthost.size(), 2003u);
+    ASSERT_EQ(user.trusthost[0], kept);
+    ASSERT_TRUE(user.covers("198.51.100.200"));
+    ASSERT_TRUE(user.covers("172.16.7.207"));
+    ASSERT_FALSE(user.covers("172.16.7.208"));
+
+    ASSERT_FALSE(user.sync_trusthosts(subnets));
+    ASSERT_THROW(user.sync_trusthosts({"192.0.2.0/24", "bogus"}), std::runtime_error);
+    ASSERT_TRUE(user.sync_trusthosts({"0.0.0.0/0"}));
+    ASSERT_EQ(user.trusthost.size(), 1u);
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <thread>
+#include "include/forti_api.hpp"
+
+using namespace std::chrono_literals;
+
+TEST(TestMetrics, TestHistogramBuckets) {
+    ASSERT_EQ(LatencyHistogram::bucket_of(0us), 0u);
+    ASSERT_EQ(LatencyHistogram::bucket_of(25us), 0u);
+    ASSERT_EQ(LatencyHistogram::bucket_of(26us), 1u);
+    ASSERT_EQ(LatencyHistogram::bucket_of(50us), 1u);
+    ASSERT_EQ(LatencyHistogram::bucket_of(51us), 2u);
+    ASSERT_EQ(LatencyHistogram::bucket_of(3600s), HistogramSnapshot::buckets);
+
+    LatencyHistogram histogram;
+    for (int i = 0; i < 90; ++i) histogram.record(1ms);
+    for (int i = 0; i < 10; ++i) histogram.record(100ms);
+    auto snapshot = histogram.snapshot();
+    ASSERT_EQ(snapshot.count, 100u);
+    ASSERT_EQ(snapshot.sum, 1090ms);
+    ASSERT_GE(snapshot.quantile(0.5), 1ms);
+    ASSERT_LT(snapshot.quantile(0.5), 2ms);
+    ASSERT_GE(snapshot.quantile(0.99), 100ms);
+    ASSERT_LT(snapshot.quantile(0.99), 200ms);
+}
+
+TEST(TestMetrics, TestConcurrentRecordsAreNotLost) {
+    LatencyHistogram histogram;
+    {
+        std::vector<std::jthread> threads;
+        for (int t = 0; t < 8; ++t) threads.emplace_back([&] { for (int i = 0; i < 10'000; ++i) histogram.record(40us); });
+    }
+    ASSERT_EQ(histogram.snapshot().count, 80'000u);
+    ASSERT_EQ(histogram.snapshot().counts[1], 80'000u);
+}
+
+TEST(TestMetrics, TestPathTemplate) {
+    ASSERT_EQ(RequestMetrics::path_template("/cmdb/dnsfilter/profile"), "/cmdb/dnsfilter/profile");
+    ASSERT_EQ(RequestMetrics::path_template("/cmdb/dnsfilter/profile/office?vdom=root"), "/cmdb/dnsfilter/profile/{id}");
+    ASSERT_EQ(RequestMetrics::path_template("/cmdb/firewall/policy/12/"), "/cmdb/firewall/policy/{id}");
+    ASSERT_EQ(RequestMetrics::path_template("/monitor/system/external-resource/dynamic"),
+              "/monitor/system/external-resource/dynamic");
+    ASSERT_EQ(RequestMetrics::path_template("/monitor/system/external-resource/dynamic/ads-feed"),
+              "/monitor/system/external-resource/dynamic/{id}");
+    ASSERT_EQ(RequestMetrics::path_template("/monitor/system/available-interfaces?vdom=root&mkey=wan1"),
+              "/monitor/system/available-interfaces");
+}
+
+TEST(TestMetrics, TestClientRecordsEveryRequest) {
+    DeviceConfig device{"198.51.100.7", 8443, "ca.pem", "cert.p12", "secret", "key"};
+    std::string body = R"({"status":"success","http_status":200,"results":[]})";
+    auto replay = std::make_shared<ReplayTransport>(std::vector<Exchange>{
+            {"GET", "/cmdb/dnsfilter/profile/office?vdom=root", "", {CURLE_OK, 200, body}},
+            {"PUT", "/cmdb/dnsfilter/profile/office", "", {CURLE_OK, 200, body}},
+    }, ReplayOptions{.latency = 2ms});
+    FortiClient client(device, replay);
+    RequestMetrics::reset();
+
+    for (int i = 0; i < 3; ++i) client.get<Response>("/cmdb/dnsfilter/profile/office?vdom=root");
+    client.put("/cmdb/dnsfilter/profile/office", nlohmann::json{{"name", "office"}});
+    client.get<Response>("/cmdb/dnsfilter/profile/missing");
+
+    std::map<std::pair<std::string, long>, SeriesSnapshot> by_method;
+    for (const auto& series : FortiAPI::metrics())
+        if (series.key.device == "198.51.100.7:8443") by_method[{series.key.method, series.key.status}] = series;
+
+    ASSERT_EQ(by_method.size(), 3u);
+    const auto& reads = by_method.at({"GET", 200});
+    ASSERT_EQ(reads.key.path, "/cmdb/dnsfilter/profile/{id}");
+    ASSERT_EQ(reads.requests, 3u);
+    ASSERT_EQ(reads.bytes_received, 3 * body.size());
+    ASSERT_EQ(reads.decode.count, 3u);
+    ASSERT_GE(reads.total.quantile(0.5), 2ms);
+
+    const auto& write = by_method.at({"PUT", 200});
+    ASSERT_EQ(write.bytes_sent, std::string(R"({"name":"office"})").size());
+    ASSERT_EQ(by_method.at({"GET", 404}).requests, 1u);
+
+    auto text = FortiAPI::openmetrics();
+    ASSERT_NE(text.find(R"(forti_api_requests_total{device="198.51.100.7:8443",method="GET",path="/cmdb/dnsfilter/profile/{id}",status="200"} 3)"),
+              std::string::npos);
+    ASSERT_NE(text.find(R"(forti_api_request_duration_seconds_count{device="198.51.100.7:8443",method="PUT")"), std::string::npos);
+    ASSERT_NE(text.find("phase=\"ttfb\""), std::string::npos);
+    ASSERT_TRUE(text.ends_with("# EOF\n"));
+}
+
+TEST(TestMetrics, TestReusedConnectionsSkipConnectionPhases) {
+    RequestMetrics::reset();
+    RequestMetrics::record("203.0.113.9:443", "GET", "/monitor/x", 200,
+                           {.dns = 2ms, .connect = 3ms, .tls = 5ms, .ttfb = 12ms, .total = 13ms, .new_connection = true});
+    for (int i = 0; i < 3; ++i) RequestMetrics::record("203.0.113.9:443", "GET", "/monitor/x", 200, {.ttfb = 2ms, .total = 3ms});
+
+    for (const auto& series : RequestMetrics::snapshot()) {
+        if (series.key.device != "203.0.113.9:443") continue;
+        ASSERT_EQ(series.requests, 4u);
+        ASSERT_EQ(series.ttfb.count, 4u);
+        ASSERT_EQ(series.connect.count, 1u);
+        ASSERT_EQ(series.tls.quantile(0.5), HistogramSnapshot::bound(LatencyHistogram::bucket_of(5ms)));
+    }
+}
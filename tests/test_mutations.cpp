@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include "offline_device.hpp"
+
+TEST(TestMutations, TestClassifyMutation) {
+    Response response;
+    response.status = "success";
+    response.http_status = 200;
+    ASSERT_EQ(classify_mutation(response), MutationStatus::OK);
+
+    response.status = "error";
+    response.http_status = 404;
+    response.error = -3;
+    ASSERT_EQ(classify_mutation(response), MutationStatus::NOT_FOUND);
+
+    response.http_status = 500;
+    response.error = -5;
+    ASSERT_EQ(classify_mutation(response), MutationStatus::ALREADY_EXISTS);
+    response.error = -23;
+    ASSERT_EQ(classify_mutation(response), MutationStatus::IN_USE);
+    response.error = -1;
+    ASSERT_EQ(classify_mutation(response), MutationStatus::FAILED);
+}
+
+TEST(TestMutations, TestUpdateSkipsTheExistenceCheck) {
+    auto replay = std::make_shared<ReplayTransport>(std::vector<Exchange>{
+            answer("PUT", "/cmdb/dnsfilter/profile/ghost", 404, R"({"status":"error","http_status":404,"error":-3})"),
+            answer("PUT", "/cmdb/dnsfilter/profile/office"),
+            answer("POST", "/cmdb/dnsfilter/profile", 500, R"({"status":"error","http_status":500,"error":-5})")});
+    FortiAPI::Scope scope(FortiClient::create(offline_device, replay));
+
+    ASSERT_THROW(DNSFilter::update(DNSProfile("ghost")), std::runtime_error);
+    DNSFilter::update(DNSProfile("office"));
+    ASSERT_EQ(DNSFilter::try_add(DNSProfile("office")).status, MutationStatus::ALREADY_EXISTS);
+    ASSERT_EQ(replay->stats().served, 3u);
+    ASSERT_EQ(replay->stats().misses, 0u);
+}
+
+TEST(TestMutations, TestExistenceChecksAskForTheKeyOnly) {
+    auto replay = std::make_shared<ReplayTransport>(std::vector<Exchange>{
+            answer("GET", "/cmdb/dnsfilter/profile/office?format=name", 200,
+                   R"({"status":"success","http_status":200,"results":[{"name":"office"}]})"),
+            answer("GET", "/cmdb/system/external-resource/ads?format=name", 404,
+                   R"({"status":"error","http_status":404,"error":-3})")});
+    FortiAPI::Scope scope(FortiClient::create(offline_device, replay));
+
+    ASSERT_TRUE(DNSFilter::contains("office"));
+    ASSERT_FALSE(ThreatFeed::contains("ads"));
+    ASSERT_EQ(replay->stats().misses, 0u);
+}
+
+TEST(TestMutations, TestFeedDeleteFallsBackWhenInUse) {
+    DNSProfilesResponse profiles;
+    profiles.status = "success";
+    profiles.http_status = 200;
+    profiles.results = {DNSProfile("office")};
+    profiles.results[0].block_category(192);
+
+    auto replay = std::make_shared<ReplayTransport>(std::vector<Exchange>{
+            answer("DELETE", "/cmdb/system/external-resource/ads", 500, R"({"status":"error","http_status":500,"error":-23})"),
+            answer("DELETE", "/cmdb/system/external-resource/ads"),
+            answer("DELETE", "/cmdb/system/external-resource/trackers"),
+            answer("GET", "/cmdb/system/external-resource/ads?format=name|category", 200,
+                   R"({"status":"success","http_status":200,"results":[{"name":"ads","category":192}]})"),
+            answer("GET", "/cmdb/dnsfilter/profile", nlohmann::json(profiles).dump()),
+            answer("PUT", "/cmdb/dnsfilter/profile/office")});
+    FortiAPI::Scope scope(FortiClient::create(offline_device, replay));
+
+    // unused: a single request
+    ASSERT_TRUE(ThreatFeed::try_del("trackers"));
+    ASSERT_EQ(replay->stats().served, 1u);
+
+    // in use: the category is allowed in the profile blocking it, then the delete goes through
+    ASSERT_TRUE(ThreatFeed::try_del("ads"));
+    ASSERT_EQ(replay->stats().served, 6u);
+    ASSERT_EQ(replay->stats().misses, 0u);
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include "include/forti_api/policy_match.hpp"
+
+static FirewallPolicy rule(unsigned int id, const std::string& srcintf, const std::string& srcaddr,
+                           const std::string& dstaddr, const std::string& service, const std::string& action) {
+    FirewallPolicy policy;
+    policy.policyid = id;
+    policy.action = action;
+    policy.srcintf.push_back({{srcintf, srcintf}});
+    policy.dstintf.push_back({{"wan1", "wan1"}});
+    policy.srcaddr.push_back({{srcaddr, srcaddr}});
+    policy.dstaddr.push_back({{dstaddr, dstaddr}});
+    policy.service.push_back({{service, service}});
+    return policy;
+}
+
+static PolicyMatcher::Objects objects() {
+    PolicyMatcher::Objects objects;
+
+    FirewallAddress lan, servers, printer, web;
+    lan.name = "lan-net", lan.type = "ipmask", lan.subnet = "10.0.0.0 255.255.0.0";
+    servers.name = "servers", servers.type = "iprange", servers.start_ip = "10.0.5.10", servers.end_ip = "10.0.5.20";
+    printer.name = "printer", printer.subnet = "10.0.5.15/32";
+    web.name = "web.example.com", web.type = "fqdn";
+    objects.addresses = {lan, servers, printer, web};
+
+    FirewallAddressGroup internal;
+    internal.name = "internal", internal.member = {{{"servers", "servers"}}, {{"printer", "printer"}}};
+    objects.address_groups = {internal};
+
+    ServiceCustom https, dns, ping;
+    https.name = "HTTPS", https.protocol = "TCP/UDP/SCTP", https.tcp_portrange = "443";
+    dns.name = "DNS", dns.protocol = "TCP/UDP/SCTP", dns.tcp_portrange = "53", dns.udp_portrange = "53 5353:1024-65535";
+    ping.name = "PING", ping.protocol = "ICMP";
+    objects.services = {https, dns, ping};
+
+    ServiceGroup web_services;
+    web_services.name = "web", web_services.member = {{{"HTTPS", "HTTPS"}}, {{"DNS", "DNS"}}};
+    objects.service_groups = {web_services};
+    return objects;
+}
+
+TEST(TestPolicyMatch, TestFirstMatchInListOrder) {
+    PolicyMatcher matcher({rule(10, "lan", "servers", "all", "HTTPS", "deny"),
+                           rule(20, "lan", "lan-net", "all", "web", "accept"),
+                           rule(30, "any", "all", "all", "PING", "accept"),
+                           rule(40, "lan", "web.example.com", "all", "ALL", "accept")}, objects());
+
+    ASSERT_EQ(matcher.match("lan", "wan1", "10.0.5.12", "8.8.8.8", 6, 443), 10u);
+    ASSERT_EQ(matcher.match("lan", "wan1", "10.0.9.1", "8.8.8.8", 6, 443), 20u);
+    ASSERT_EQ(matcher.match("lan", "wan1", "10.0.5.12", "8.8.8.8", 17, 5353), 20u);
+    ASSERT_EQ(matcher.match("dmz", "wan1", "192.0.2.1", "8.8.8.8", 1), 30u);
+    ASSERT_FALSE(matcher.match("lan", "wan1", "10.0.9.1", "8.8.8.8", 6, 22).has_value());
+    ASSERT_FALSE(matcher.match("dmz", "wan1", "10.0.9.1", "8.8.8.8", 6, 443).has_value());
+    ASSERT_THROW((void) matcher.match("lan", "wan1", "10.0.9", "8.8.8.8", 6, 443), std::invalid_argument);
+}
+
+TEST(TestPolicyMatch, TestShadowedAndRedundantRules) {
+    PolicyMatcher matcher({rule(1, "lan", "lan-net", "all", "web", "accept"),
+                           rule(2, "lan", "internal", "all", "HTTPS", "deny"),
+                           rule(3, "lan", "printer", "all", "DNS", "accept"),
+                           rule(4, "any", "lan-net", "all", "ALL", "accept"),
+                           rule(5, "lan", "web.example.com", "all", "HTTPS", "deny")}, objects());
+
+    auto findings = matcher.analyze();
+    ASSERT_EQ(findings.size(), 2u);
+    ASSERT_EQ(findings[0].policyid, 2u);
+    ASSERT_EQ(findings[0].covered_by, 1u);
+    ASSERT_EQ(findings[0].kind, PolicyFinding::Kind::SHADOWED);
+    ASSERT_EQ(findings[1].policyid, 3u);
+    ASSERT_EQ(findings[1].kind, PolicyFinding::Kind::REDUNDANT);
+}
+
+TEST(TestPolicyMatch, TestUnmodelledConditionsArePartial) {
+    auto negated = rule(1, "lan", "lan-net", "all", "ALL", "deny");
+    negated.srcaddr_negate = "enable";
+    auto for_users = rule(3, "lan", "lan-net", "all", "ALL", "accept");
+    for_users.groups.push_back({{"staff", "staff"}});
+    auto scheduled = rule(5, "lan", "lan-net", "all", "ALL", "deny");
+    scheduled.schedule = "weekdays";
+
+    PolicyMatcher matcher({negated, rule(2, "lan", "printer", "all", "DNS", "accept"), for_users,
+                           rule(4, "lan", "servers", "all", "HTTPS", "accept"), scheduled}, objects());
+
+    // neither the negated rule nor the group rule may cover the rules after them
+    auto findings = matcher.analyze();
+    ASSERT_TRUE(findings.empty());
+    ASSERT_TRUE(matcher.is_partial(0));
+    ASSERT_FALSE(matcher.is_partial(1));
+    ASSERT_TRUE(matcher.is_partial(2));
+    ASSERT_TRUE(matcher.is_partial(4));
+    ASSERT_EQ(nlohmann::json(negated)["srcaddr-negate"], "enable");
+}
@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include "offline_device.hpp"
+
+static FirewallPolicy policy(unsigned int id, const std::string& name, const std::string& profile) {
+    FirewallPolicy policy;
+    policy.policyid = id;
+    policy.uuid_idx = id + 100;
+    policy.name = name;
+    policy.action = "accept";
+    policy.dnsfilter_profile = profile;
+    return policy;
+}
+
+// What the device holds: two feeds, two profiles and one policy, with device-assigned filter ids.
+static ConfigState device_state() {
+    ConfigState state;
+    state.threat_feeds = {PushThreatFeed("ads", 192), PushThreatFeed("legacy", 193)};
+
+    DNSProfile office("office"), guest("guest");
+    office.block_category(192);
+    office.block_category(26);
+    unsigned int id = 0;
+    for (auto& filter : office.ftgd_dns.filters) filter.id = ++id;
+    state.dns_profiles = {office, guest};
+    state.firewall_policies = {policy(7, "lan-out", "office")};
+    return state;
+}
+
+static ConfigState desired_state() {
+    ConfigState state;
+    state.threat_feeds = {PushThreatFeed("ads", 192), PushThreatFeed("malware", 194)};
+
+    DNSProfile office("office"), guest("guest");
+    office.block_category(26);
+    office.block_category(192);
+    office.block_category(194);
+    guest.block_category(192);
+    state.dns_profiles = {office, guest};
+
+    auto lan = policy(0, "lan-out", "office");
+    lan.uuid_idx = 0;
+    lan.comments = "managed";
+    state.firewall_policies = {lan};
+    return state;
+}
+
+TEST(TestReconciler, TestUnchangedStatePlansNothing) {
+    auto current = device_state();
+    auto desired = current;
+    for (auto& profile : desired.dns_profiles)
+        for (auto& filter : profile.ftgd_dns.filters) filter.id = 0;
+    ASSERT_TRUE(Reconciler::plan(desired, current, {.prune = true}).empty());
+}
+
+TEST(TestReconciler, TestPlanIsMinimalAndOrdered) {
+    auto plan = Reconciler::plan(desired_state(), device_state(), {.prune = true});
+    std::vector<std::pair<std::string, std::string>> order;
+    for (const auto& change : plan.changes) order.emplace_back(change.module, change.name);
+
+    std::vector<std::pair<std::string, std::string>> expected{
+            {"threat-feed", "malware"}, {"dns-profile", "office"}, {"dns-profile", "guest"},
+            {"firewall-policy", "lan-out"}, {"threat-feed", "legacy"}};
+    ASSERT_EQ(order, expected);
+    ASSERT_EQ(plan.count(ChangeKind::CREATE), 1u);
+    ASSERT_EQ(plan.count(ChangeKind::UPDATE), 3u);
+    ASSERT_EQ(plan.count(ChangeKind::DELETE), 1u);
+
+    // office keeps the ids of the filters it already had, only ftgd-dns differs
+    const auto& office = plan.changes[1];
+    ASSERT_EQ(office.fields.size(), 1u);
+    ASSERT_EQ(office.fields[0].field, "ftgd-dns");
+    auto filters = office.request.data["ftgd-dns"]["filters"];
+    ASSERT_EQ(filters.size(), 3u);
+    ASSERT_EQ(filters[0]["id"], 1);
+    ASSERT_EQ(filters[1]["id"], 2);
+    ASSERT_EQ(filters[2]["id"], 0);
+
+    // the policy is matched by name and addressed by the device's id
+    const auto& lan = plan.changes[3];
+    ASSERT_EQ(lan.request.method, "PUT");
+    ASSERT_EQ(lan.request.path, "/cmdb/firewall/policy/7");
+    ASSERT_EQ(lan.fields.size(), 1u);
+    ASSERT_EQ(lan.fields[0].field, "comments");
+    ASSERT_EQ(lan.fields[0].after, "managed");
+
+    ASSERT_EQ(plan.changes.back().request.method, "DELETE");
+    ASSERT_EQ(Reconciler::plan(desired_state(), device_state()).count(ChangeKind::DELETE), 0u);
+}
+
+static std::vector<Exchange> device_exchanges(const ConfigState& state) {
+    ExternalResourcesResponse feeds;
+    feeds.status = "success";
+    feeds.http_status = 200;
+    feeds.results = state.threat_feeds;
+    DNSProfilesResponse profiles;
+    profiles.status = "success";
+    profiles.http_status = 200;
+    profiles.results = state.dns_profiles;
+    FirewallPoliciesResponse policies;
+    policies.status = "success";
+    policies.http_status = 200;
+    policies.results = state.firewall_policies;
+
+    return {
+            answer("GET", "/cmdb/system/external-resource", nlohmann::json(feeds).dump()),
+            answer("GET", "/cmdb/dnsfilter/profile", nlohmann::json(profiles).dump()),
+            answer("GET", "/cmdb/firewall/policy", nlohmann::json(policies).dump()),
+            answer("POST", "/cmdb/system/external-resource"),
+            answer("PUT", "/cmdb/dnsfilter/profile/office"),
+            answer("PUT", "/cmdb/dnsfilter/profile/guest"),
+            answer("PUT", "/cmdb/firewall/policy/7"),
+            answer("DELETE", "/cmdb/system/external-resource/legacy"),
+    };
+}
+
+TEST(TestReconciler, TestDryRunOnlyReads) {
+    auto replay = std::make_shared<ReplayTransport>(device_exchanges(device_state()));
+    FortiAPI::Scope scope(FortiClient::create(offline_device, replay));
+
+    auto report = Reconciler::reconcile(desired_state(), {.dry_run = true, .prune = true});
+    ASSERT_EQ(report.plan.changes.size(), 5u);
+    ASSERT_TRUE(report.results.empty());
+    ASSERT_EQ(replay->stats().served, 3u);
+
+    std::ostringstream out;
+    report.plan.print(out);
+    ASSERT_NE(out.str().find("+ threat-feed malware"), std::string::npos);
+    ASSERT_NE(out.str().find("comments: \"\" -> \"managed\""), std::string::npos);
+}
+
+TEST(TestReconciler, TestApplyRunsStagesInOrder) {
+    auto path = (std::filesystem::temp_directory_path() / "forti_api_reconcile.log").string();
+    auto recorder = std::make_shared<RecordingTransport>(
+            std::make_shared<ReplayTransport>(device_exchanges(device_state())), path);
+    {
+        FortiAPI::Scope scope(FortiClient::create(offline_device, recorder));
+        auto report = Reconciler::reconcile(desired_state(), {.prune = true});
+        ASSERT_EQ(report.results.size(), 5u);
+        ASSERT_EQ(report.succeeded(), 5u);
+    }
+    recorder->flush();
+
+    auto log = ExchangeLog::load(path);
+    ASSERT_EQ(log.size(), 8u);
+    std::vector<std::string> writes;
+    for (std::size_t i = 3; i < log.size(); ++i) writes.push_back(log[i].method + " " + log[i].path);
+    ASSERT_EQ(writes[0], "POST /cmdb/system/external-resource");
+    ASSERT_TRUE(writes[1].starts_with("PUT /cmdb/dnsfilter/profile/"));
+    ASSERT_TRUE(writes[2].starts_with("PUT /cmdb/dnsfilter/profile/"));
+    ASSERT_EQ(writes[3], "PUT /cmdb/firewall/policy/7");
+    ASSERT_EQ(writes[4], "DELETE /cmdb/system/external-resource/legacy");
+    std::filesystem::remove(path);
+}
+
+TEST(TestReconciler, TestFailedStageSkipsLaterStages) {
+    auto exchanges = device_exchanges(device_state());
+    exchanges[3].response = {CURLE_OK, 500, R"({"status":"error","http_status":500})"};
+    auto client = FortiClient::create(offline_device,
+                                      std::make_shared<ReplayTransport>(exchanges));
+    client->set_retry_policy({.max_attempts = 1});
+    FortiAPI::Scope scope(client);
+
+    auto report = Reconciler::reconcile(desired_state(), {.prune = true});
+    ASSERT_EQ(report.results.size(), 5u);
+    ASSERT_EQ(report.succeeded(), 0u);
+    ASSERT_EQ(report.results[4].error().message, "skipped, an earlier stage failed");
+}
+
+TEST(TestReconciler, TestPrunedFeedsAreAllowedFirst) {
+    auto current = device_state();
+    current.dns_profiles[1].block_category(193);
+    auto desired = desired_state();
+    desired.dns_profiles[1].block_category(193);
+
+    auto plan = Reconciler::plan(desired, current, {.prune = true});
+    const auto& guest = plan.changes[2];
+    ASSERT_EQ(guest.name, "guest");
+    ASSERT_EQ(guest.request.data["ftgd-dns"]["filters"].size(), 1u);
+    ASSERT_EQ(guest.request.data["ftgd-dns"]["filters"][0]["category"], 192);
+
+    // without pruning the feed stays, and so does the category
+    auto kept = Reconciler::plan(desired, current);
+    ASSERT_EQ(kept.changes[2].request.data["ftgd-dns"]["filters"].size(), 2u);
+}
+
+TEST(TestReconciler, TestFailedDeleteKeepsTheFeedBaseline) {
+    auto exchanges = device_exchanges(device_state());
+    exchanges.push_back(answer("DELETE", "/cmdb/system/external-resource/legacy"));
+    exchanges[7].response = {CURLE_OK, 500, R"({"status":"error","http_status":500})"};
+    exchanges.push_back(answer("POST", "/monitor/system/external-resource/dynamic"));
+    auto client = FortiClient::create(offline_device, std::make_shared<ReplayTransport>(exchanges));
+    client->set_retry_policy({.max_attempts = 1});
+    FortiAPI::Scope scope(client);
+
+    std::vector<std::string> entries{"a.example", "b.example", "c.example", "d.example", "e.example"};
+    ASSERT_TRUE(ThreatFeed::update_feed_delta("legacy", entries).snapshot);
+
+    auto report = Reconciler::reconcile(desired_state(), {.prune = true});
+    ASSERT_EQ(report.failed(), 1u);
+    entries[0] = "f.example";
+    ASSERT_FALSE(ThreatFeed::update_feed_delta("legacy", entries).snapshot);
+
+    report = Reconciler::reconcile(desired_state(), {.prune = true});
+    ASSERT_EQ(report.failed(), 0u);
+    entries[1] = "g.example";
+    ASSERT_TRUE(ThreatFeed::update_feed_delta("legacy", entries).snapshot);
+}
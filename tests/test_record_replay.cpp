@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include "offline_device.hpp"
+
+using namespace std::chrono_literals;
+
+static std::vector<Exchange> recorded_profiles() {
+    DNSProfilesResponse listing;
+    listing.http_method = "GET";
+    listing.status = "success";
+    listing.http_status = 200;
+    listing.results = {DNSProfile("office"), DNSProfile("guest")};
+
+    std::vector<Exchange> exchanges{answer("GET", "/cmdb/dnsfilter/profile", nlohmann::json(listing).dump()),
+                                    answer("PUT", "/cmdb/dnsfilter/profile/office"),
+                                    answer("PUT", "/cmdb/dnsfilter/profile/guest")};
+    exchanges[0].latency = 2ms;
+    exchanges[1].latency = exchanges[2].latency = 3ms;
+    return exchanges;
+}
+
+TEST(TestRecordReplay, TestRecordedWorkflowReplaysIdentically) {
+    auto path = (std::filesystem::temp_directory_path() / "forti_api_record_replay.log").string();
+    auto recorder = std::make_shared<RecordingTransport>(std::make_shared<ReplayTransport>(recorded_profiles()), path);
+
+    std::vector<Result<Response>> live;
+    {
+        FortiAPI::Scope scope(FortiClient::create(offline_device, recorder));
+        live = DNSFilter::apply_category_changes({{26, CategoryAction::BLOCK}});
+        ASSERT_EQ(DNSFilter::get().size(), 2u);
+    }
+    recorder->flush();
+    ASSERT_EQ(recorder->size(), 4u);
+
+    auto log = ExchangeLog::load(path);
+    ASSERT_EQ(log.size(), 4u);
+    ASSERT_EQ(log[0].method, "GET");
+    ASSERT_EQ(log[1].method, "PUT");
+    ASSERT_NE(log[1].request_body.find("\"category\":26"), std::string::npos);
+    ASSERT_EQ(log[3].response.http_status, 200);
+
+    auto replay = ReplayTransport::load(path);
+    FortiAPI::Scope scope(FortiClient::create(offline_device, replay));
+    auto replayed = DNSFilter::apply_category_changes({{26, CategoryAction::BLOCK}});
+    ASSERT_EQ(replayed.size(), live.size());
+    for (std::size_t i = 0; i < replayed.size(); ++i) {
+        ASSERT_TRUE(replayed[i].has_value());
+        ASSERT_EQ(replayed[i]->status, "success");
+    }
+    ASSERT_EQ(replay->stats().misses, 0u);
+    std::filesystem::remove(path);
+}
+
+TEST(TestRecordReplay, TestStreamedBodiesAreRecorded) {
+    auto path = (std::filesystem::temp_directory_path() / "forti_api_record_stream.log").string();
+    auto recorder = std::make_shared<RecordingTransport>(std::make_shared<ReplayTransport>(std::vector<Exchange>{}), path);
+    {
+        FortiAPI::Scope scope(FortiClient::create(offline_device, recorder));
+        std::vector<std::string> entries{"ads.example.com", "tracker.example.net"};
+        ThreatFeed::stream_feed("blocklist", entries_from(entries.begin(), entries.end()));
+    }
+    recorder->flush();
+
+    auto log = ExchangeLog::load(path);
+    ASSERT_EQ(log.size(), 1u);
+    ASSERT_EQ(log[0].response.http_status, 404);
+    auto body = nlohmann::json::parse(log[0].request_body);
+    ASSERT_EQ(body["commands"][0]["entries"].size(), 2u);
+    std::filesystem::remove(path);
+}
+
+TEST(TestRecordReplay, TestReplayServesInOrderAndReportsMisses) {
+    auto replay = std::make_shared<ReplayTransport>(std::vector<Exchange>{
+            answer("GET", "/monitor/x", R"({"status":"success","revision":"1"})"),
+            answer("GET", "/monitor/x", R"({"status":"success","revision":"2"})"),
+    });
+    FortiClient client(offline_device, replay);
+
+    ASSERT_EQ(client.get<Response>("/monitor/x").revision, "1");
+    ASSERT_EQ(client.get<Response>("/monitor/x").revision, "2");
+    ASSERT_EQ(client.get<Response>("/monitor/x").revision, "2");
+    ASSERT_EQ(client.get<Response>("/monitor/y").http_status, 404u);
+    ASSERT_EQ(replay->stats().served, 3u);
+    ASSERT_EQ(replay->stats().misses, 1u);
+
+    replay->rewind();
+    ASSERT_EQ(client.get<Response>("/monitor/x").revision, "1");
+}
+
+TEST(TestRecordReplay, TestInjectedLatencyOverlapsInBatches) {
+    std::vector<Exchange> exchanges;
+    std::vector<BatchRequest> requests;
+    for (int i = 0; i < 8; ++i) {
+        auto path = std::format("/cmdb/firewall/policy/{}", i);
+        exchanges.push_back(answer("GET", path));
+        requests.push_back({"GET", path});
+    }
+    auto replay = std::make_shared<ReplayTransport>(exchanges, ReplayOptions{.latency = 40ms});
+    FortiClient client(offline_device, replay);
+    client.configure_limiter({.initial = 8, .min = 8, .max = 8});
+
+    auto started = std::chrono::steady_clock::now();
+    client.get<Response>(requests[0].path);
+    ASSERT_GE(std::chrono::steady_clock::now() - started, 40ms);
+
+    started = std::chrono::steady_clock::now();
+    auto results = client.batch<Response>(requests, 8);
+    auto elapsed = std::chrono::steady_clock::now() - started;
+    for (const auto& result : results) ASSERT_TRUE(result.has_value());
+    ASSERT_GE(elapsed, 40ms);
+    ASSERT_LT(elapsed, 8 * 40ms);
+}
+
+TEST(TestRecordReplay, TestReplayHonoursDeadline) {
+    auto replay = std::make_shared<ReplayTransport>(std::vector<Exchange>{
+            {"GET", "/monitor/slow", "", {CURLE_OK, 200, R"({"status":"success"})"}, 500ms},
+    }, ReplayOptions{.recorded_latency_scale = 1});
+    FortiClient client(offline_device, replay);
+
+    auto started = std::chrono::steady_clock::now();
+    {
+        FortiClient::Deadline deadline(50ms);
+        ASSERT_THROW(client.get<Response>("/monitor/slow"), std::runtime_error);
+    }
+    ASSERT_LT(std::chrono::steady_clock::now() - started, 400ms);
+}
+
+TEST(TestRecordReplay, TestCancelledRequestsStopWaiting) {
+    auto replay = std::make_shared<ReplayTransport>(std::vector<Exchange>{
+            {"GET", "/monitor/slow", "", {CURLE_OK, 200, R"({"status":"success"})"}, 500ms},
+    }, ReplayOptions{.recorded_latency_scale = 1});
+    FortiClient client(offline_device, replay);
+
+    auto flag = std::make_shared<std::atomic<bool>>(false);
+    auto started = std::chrono::steady_clock::now();
+    std::thread canceller([&] {
+        std::this_thread::sleep_for(50ms);
+        flag->store(true);
+    });
+    {
+        FortiClient::Cancellation cancellation(flag);
+        EXPECT_THROW(client.get<Response>("/monitor/slow"), std::runtime_error);
+    }
+    canceller.join();
+    ASSERT_LT(std::chrono::steady_clock::now() - started, 400ms);
+    ASSERT_EQ(replay->stats().served, 1u);
+}
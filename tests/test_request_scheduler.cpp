@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "include/forti_api/api.hpp"
+
+using namespace std::chrono_literals;
+
+TEST(TestRequestScheduler, TestClassifyAttempt) {
+    ASSERT_EQ(classify_attempt(CURLE_OK, 200, "GET"), RequestOutcome::OK);
+    ASSERT_EQ(classify_attempt(CURLE_OK, 404, "GET"), RequestOutcome::OK);
+    ASSERT_EQ(classify_attempt(CURLE_OK, 429, "POST"), RequestOutcome::RETRYABLE);
+    ASSERT_EQ(classify_attempt(CURLE_OK, 503, "PUT"), RequestOutcome::RETRYABLE);
+    ASSERT_EQ(classify_attempt(CURLE_OK, 504, "DELETE"), RequestOutcome::RETRYABLE);
+    ASSERT_EQ(classify_attempt(CURLE_OK, 502, "POST"), RequestOutcome::FAILED);
+    ASSERT_EQ(classify_attempt(CURLE_OK, 504, "POST"), RequestOutcome::FAILED);
+    ASSERT_EQ(classify_attempt(CURLE_COULDNT_CONNECT, 0, "POST"), RequestOutcome::RETRYABLE);
+    ASSERT_EQ(classify_attempt(CURLE_OPERATION_TIMEDOUT, 0, "GET"), RequestOutcome::RETRYABLE);
+    ASSERT_EQ(classify_attempt(CURLE_OPERATION_TIMEDOUT, 0, "POST"), RequestOutcome::FAILED);
+    ASSERT_EQ(classify_attempt(CURLE_SSL_CACERT_BADFILE, 0, "GET"), RequestOutcome::FAILED);
+}
+
+TEST(TestRequestScheduler, TestBackoffIsCappedAndHonoursRetryAfter) {
+    RetryPolicy policy{.max_attempts = 5, .base_delay = 100ms, .max_delay = 1000ms};
+    for (unsigned int attempt = 1; attempt <= 10; ++attempt) {
+        auto delay = policy.backoff(attempt);
+        ASSERT_LE(delay, std::min(1000ms, 100ms * (1 << std::min(attempt - 1, 4u))));
+        ASSERT_GE(delay, 0ms);
+    }
+    ASSERT_GE(policy.backoff(1, 3000ms), 3000ms);
+}
+
+TEST(TestRequestScheduler, TestAdditiveIncreaseMultiplicativeDecrease) {
+    ConcurrencyLimiter limiter({.initial = 2, .min = 1, .max = 4});
+
+    ASSERT_TRUE(limiter.try_acquire());
+    ASSERT_TRUE(limiter.try_acquire());
+    ASSERT_FALSE(limiter.try_acquire());
+
+    // saturated, fast completions grow the limit by roughly one per round trip
+    for (int i = 0; i < 40; ++i) {
+        limiter.release(200'000us, RequestOutcome::OK);
+        ASSERT_TRUE(limiter.try_acquire());
+        while (limiter.try_acquire()) {}
+    }
+    ASSERT_DOUBLE_EQ(limiter.stats().limit, 4.0);
+
+    limiter.release(200'000us, RequestOutcome::RETRYABLE);
+    ASSERT_DOUBLE_EQ(limiter.stats().limit, 2.0);
+
+    // a second failure inside the same round trip doesn't halve it again
+    limiter.release(200'000us, RequestOutcome::RETRYABLE);
+    ASSERT_DOUBLE_EQ(limiter.stats().limit, 2.0);
+    ASSERT_EQ(limiter.stats().throttled, 2u);
+}
+
+TEST(TestRequestScheduler, TestLatencyRiseShrinksTheLimit) {
+    ConcurrencyLimiter limiter({.initial = 8, .min = 1, .max = 8, .latency_tolerance = 2.0});
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(limiter.try_acquire());
+        limiter.release(1000us, RequestOutcome::OK);
+    }
+    ASSERT_DOUBLE_EQ(limiter.stats().limit, 8.0);
+
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_TRUE(limiter.try_acquire());
+        limiter.release(5000us, RequestOutcome::OK);
+        std::this_thread::sleep_for(std::chrono::microseconds(limiter.stats().smoothed_latency));
+    }
+    ASSERT_LT(limiter.stats().limit, 8.0);
+    ASSERT_GE(limiter.stats().limit, 1.0);
+}
+
+TEST(TestRequestScheduler, TestAcquireWaitsForRelease) {
+    ConcurrencyLimiter limiter({.initial = 1, .min = 1, .max = 1});
+    ASSERT_TRUE(limiter.try_acquire());
+    ASSERT_FALSE(limiter.acquire(std::chrono::steady_clock::now() + 5ms));
+
+    std::jthread releaser([&] {
+        std::this_thread::sleep_for(10ms);
+        limiter.release(1000us, RequestOutcome::OK);
+    });
+    ASSERT_TRUE(limiter.acquire(std::chrono::steady_clock::now() + 5s));
+}
+
+TEST(TestRequestScheduler, TestUnreachableDeviceThrowsAfterRetries) {
+    FortiClient client({"127.0.0.1", 1, "ca.pem", "cert.p12", "pass", "key"});
+    client.set_retry_policy({.max_attempts = 3, .base_delay = 1ms, .max_delay = 2ms});
+
+    ASSERT_THROW(client.get<Response>("/cmdb/system/global"), std::runtime_error);
+    auto stats = client.scheduler_stats();
+    ASSERT_EQ(stats.retries, 2u);
+    ASSERT_EQ(stats.throttled, 3u);
+    ASSERT_EQ(stats.in_flight, 0u);
+
+    auto results = client.batch({{"GET", "/cmdb/system/global"}, {"POST", "/cmdb/system/global", {}}});
+    ASSERT_FALSE(results[0].has_value());
+    ASSERT_FALSE(results[1].has_value());
+    ASSERT_EQ(client.scheduler_stats().retries, 6u);
+}
+
+// Fails every request before it reaches the wire; batches get one transfer in and then fail.
+class ThrowingTransport : public Transport {
+    class Multi : public Transport::Multi {
+        std::size_t added = 0;
+
+    public:
+        void add(std::size_t, TransportRequest) override {
+            if (++added > 1) throw std::runtime_error("no handle available");
+        }
+
+        std::vector<std::pair<std::size_t, TransportResponse>> poll(std::chrono::milliseconds) override { return {}; }
+    };
+
+public:
+    TransportResponse perform(TransportRequest) override { throw std::runtime_error("no handle available"); }
+    std::unique_ptr<Transport::Multi> multi(unsigned int) override { return std::make_unique<Multi>(); }
+};
+
+TEST(TestRequestScheduler, TestThrowingTransportGivesSlotsBack) {
+    FortiClient client({"127.0.0.1", 1, "ca.pem", "cert.p12", "pass", "key"}, std::make_shared<ThrowingTransport>());
+    client.configure_limiter({.initial = 2, .min = 2, .max = 2});
+
+    for (int i = 0; i < 3; ++i)
+        ASSERT_THROW(client.get<Response>("/cmdb/system/global"), std::runtime_error);
+    ASSERT_EQ(client.scheduler_stats().in_flight, 0u);
+
+    ASSERT_THROW(client.batch({{"GET", "/cmdb/system/global"}, {"GET", "/cmdb/system/status"}}), std::runtime_error);
+    ASSERT_EQ(client.scheduler_stats().in_flight, 0u);
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include "offline_device.hpp"
+
+TEST(TestResponseCache, TestTableOf) {
+    ASSERT_EQ(ResponseCache::table_of("/cmdb/dnsfilter/profile/advanced?datasource=1"), "/cmdb/dnsfilter/profile");
+    ASSERT_EQ(ResponseCache::table_of("/cmdb/dnsfilter/profile"), "/cmdb/dnsfilter/profile");
+    ASSERT_EQ(ResponseCache::table_of("/cmdb/firewall/policy?start=0&count=10"), "/cmdb/firewall/policy");
+    ASSERT_FALSE(ResponseCache::cacheable("/monitor/system/available-interfaces"));
+    ASSERT_FALSE(ResponseCache::cacheable("/cmdb/system/external-resource/entry-list?include_notes=true&mkey=ads"));
+    ASSERT_TRUE(ResponseCache::cacheable("/cmdb/system/external-resource/ads"));
+}
+
+TEST(TestResponseCache, TestRevalidationAndInvalidation) {
+    ResponseCache cache;
+    cache.enable(std::chrono::milliseconds(0));
+
+    std::string revision = "1";
+    int probes = 0;
+    auto probe = [&] { ++probes; return revision; };
+
+    DNSProfilesResponse response;
+    response.revision = "1";
+    response.results.emplace_back();
+    response.results[0].name = "advanced";
+
+    ASSERT_FALSE(cache.lookup<DNSProfilesResponse>("/cmdb/dnsfilter/profile/advanced", probe));
+    cache.store("/cmdb/dnsfilter/profile/advanced", response, response.revision);
+
+    auto hit = cache.lookup<DNSProfilesResponse>("/cmdb/dnsfilter/profile/advanced", probe);
+    ASSERT_TRUE(hit);
+    ASSERT_EQ(hit->results[0].name, "advanced");
+    ASSERT_EQ(probes, 1);
+
+    // the same path decoded as another type is a separate entry
+    ASSERT_FALSE(cache.lookup<Response>("/cmdb/dnsfilter/profile/advanced", probe));
+
+    revision = "2";
+    ASSERT_FALSE(cache.lookup<DNSProfilesResponse>("/cmdb/dnsfilter/profile/advanced", probe));
+
+    cache.store("/cmdb/dnsfilter/profile/advanced", response, "2");
+    cache.store("/cmdb/firewall/policy", FirewallPoliciesResponse{}, "2");
+    cache.invalidate("/cmdb/dnsfilter/profile/other");
+    ASSERT_FALSE(cache.lookup<DNSProfilesResponse>("/cmdb/dnsfilter/profile/advanced", probe));
+    ASSERT_TRUE(cache.lookup<FirewallPoliciesResponse>("/cmdb/firewall/policy", probe));
+
+    auto stats = cache.stats();
+    ASSERT_EQ(stats.hits, 2u);
+    ASSERT_EQ(stats.revalidations, 2u);
+    ASSERT_EQ(stats.invalidations, 1u);
+}
+
+TEST(TestResponseCache, TestCachedReadsSkipTheDevice) {
+    FortiAPI::enable_cache(std::chrono::seconds(30));
+    FortiAPI::reset_cache_stats();
+
+    auto first = DNSFilter::get();
+    auto second = DNSFilter::get();
+    ASSERT_EQ(first.size(), second.size());
+    ASSERT_GE(FortiAPI::cache_stats().hits, 1u);
+
+    FortiAPI::disable_cache();
+}
+
+static std::string entry_list(const std::vector<std::string>& entries) {
+    ExternalResourceEntryListResponse response;
+    response.status = "success";
+    response.http_status = 200;
+    response.revision = "7";  // pushes don't move the config revision
+    for (const auto& entry : entries) response.results.entries.push_back({entry, "true"});
+    return nlohmann::json(response).dump();
+}
+
+TEST(TestResponseCache, TestEntryListsAreReadAfterPushes) {
+    auto path = "/cmdb/system/external-resource/entry-list?include_notes=true&vdom=root&mkey=ads";
+    auto replay = std::make_shared<ReplayTransport>(std::vector<Exchange>{
+            answer("GET", path, entry_list({"old.example"})),
+            answer("GET", path, entry_list({"new.example"})),
+            answer("POST", "/monitor/system/external-resource/dynamic")});
+    FortiClient client(offline_device, replay);
+    client.enable_cache(std::chrono::seconds(30));
+
+    auto before = client.get<ExternalResourceEntryListResponse>(path).results.entries;
+    ASSERT_EQ(before.size(), 1u);
+    ASSERT_EQ(before[0].entry, "old.example");
+
+    client.post("/monitor/system/external-resource/dynamic", CommandsRequest(CommandEntry("ads", {"new.example"})));
+    auto after = client.get<ExternalResourceEntryListResponse>(path).results.entries;
+    ASSERT_EQ(after.size(), 1u);
+    ASSERT_EQ(after[0].entry, "new.example");
+    ASSERT_EQ(client.cache_stats().hits, 0u);
+    ASSERT_EQ(replay->stats().misses, 0u);
+}
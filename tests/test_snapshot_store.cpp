@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include "offline_device.hpp"
+
+static std::filesystem::path snapshot_directory(const std::string& name) {
+    auto directory = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(directory);
+    return directory;
+}
+
+static std::string profile_listing(const std::string& revision) {
+    return std::format(R"({{"http_method":"GET","revision":"{}","serial":"FGT60F0000000001","status":"success",)"
+                       R"("http_status":200,"results":[{{"name":"office","q_origin_key":"office","ftgd-dns":)"
+                       R"({{"options":"","filters":[{{"id":4,"q_origin_key":4,"category":26,"action":"block",)"
+                       R"("log":"disable"}}]}}}}]}})", revision);
+}
+
+TEST(TestSnapshotStore, TestSnapshotsRoundTripLosslessly) {
+    auto directory = snapshot_directory("forti_api_snapshots_roundtrip");
+    SnapshotStore store;
+    store.enable(directory);
+
+    auto body = profile_listing("7");
+    auto decoded = SaxDecoder::decode<DNSProfilesResponse>(body);
+    store.save("/cmdb/dnsfilter/profile", decoded, body);
+
+    SnapshotTag device{"FGT60F0000000001", "7"};
+    auto restored = store.load<DNSProfilesResponse>("/cmdb/dnsfilter/profile", [&] { return device; });
+    ASSERT_TRUE(restored);
+    ASSERT_EQ(restored->revision, "7");
+    ASSERT_EQ(restored->results[0].q_origin_key, "office");
+    ASSERT_EQ(restored->results[0].ftgd_dns.filters, decoded.results[0].ftgd_dns.filters);
+    ASSERT_EQ(restored->results[0].ftgd_dns.filters[0].q_origin_key, 4u);
+
+    // another result type of the same path, and paths outside the prefixes, are never served
+    ASSERT_FALSE(store.load<Response>("/cmdb/dnsfilter/profile", [&] { return device; }));
+    store.save("/monitor/system/status", decoded, body);
+    ASSERT_FALSE(store.load<DNSProfilesResponse>("/monitor/system/status", [&] { return device; }));
+    std::filesystem::remove_all(directory);
+}
+
+TEST(TestSnapshotStore, TestMsgpackWriterMatchesTheDom) {
+    auto body = nlohmann::json::object({
+            {"small", 7}, {"byte", 200}, {"short", 65535}, {"word", 4294967295u}, {"huge", 18446744073709551615u},
+            {"negative", nlohmann::json::array({-1, -32, -33, -128, -129, -32768, -32769, -2147483648LL, -2147483649LL})},
+            {"float", 0.1}, {"flags", nlohmann::json::array({true, false, nullptr})},
+            {"strings", nlohmann::json::array({"", std::string(31, 'a'), std::string(32, 'b'), std::string(300, 'c'),
+                                               std::string(70000, 'd'), "caf\u00e9"})},
+            {"empty", nlohmann::json::object({{"object", nlohmann::json::object()}, {"array", nlohmann::json::array()}})},
+    }).dump();
+
+    std::string out;
+    ASSERT_TRUE(MsgpackWriter::convert(body, out));
+    ASSERT_EQ(nlohmann::json::from_msgpack(out), nlohmann::json::parse(body));
+
+    out.clear();
+    ASSERT_FALSE(MsgpackWriter::convert(R"({"results":[1,2)", out));
+}
+
+TEST(TestSnapshotStore, TestEntryListsAreNotKept) {
+    auto directory = snapshot_directory("forti_api_snapshots_excluded");
+    SnapshotStore store;
+    store.enable(directory);
+    ASSERT_TRUE(store.wants("/cmdb/system/external-resource"));
+    ASSERT_FALSE(store.wants("/cmdb/system/external-resource/entry-list?mkey=ads"));
+
+    auto body = profile_listing("7");
+    store.save("/cmdb/system/external-resource/entry-list?mkey=ads", SaxDecoder::decode<DNSProfilesResponse>(body), body);
+    store.save("/cmdb/dnsfilter/profile", SaxDecoder::decode<DNSProfilesResponse>(body), body);
+    ASSERT_EQ(store.stats().writes, 1u);
+
+    // the write went through a temporary file that was renamed into place
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) files.push_back(entry.path());
+    ASSERT_EQ(files.size(), 1u);
+    ASSERT_EQ(files[0].extension(), ".snapshot");
+    std::filesystem::remove_all(directory);
+}
+
+TEST(TestSnapshotStore, TestStaleSnapshotsAreDropped) {
+    auto directory = snapshot_directory("forti_api_snapshots_stale");
+    SnapshotStore store;
+    store.enable(directory, {.max_age = std::chrono::milliseconds(0)});
+
+    auto body = profile_listing("7");
+    store.save("/cmdb/dnsfilter/profile", SaxDecoder::decode<DNSProfilesResponse>(body), body);
+
+    SnapshotTag device{"FGT60F0000000002", "7"};
+    ASSERT_FALSE(store.load<DNSProfilesResponse>("/cmdb/dnsfilter/profile", [&] { return device; }));
+    ASSERT_FALSE(std::filesystem::exists(store.file_of("/cmdb/dnsfilter/profile", typeid(DNSProfilesResponse).name())));
+
+    store.save("/cmdb/dnsfilter/profile", SaxDecoder::decode<DNSProfilesResponse>(body), body);
+    device = {"FGT60F0000000001", "8"};
+    ASSERT_FALSE(store.load<DNSProfilesResponse>("/cmdb/dnsfilter/profile", [&] { return device; }));
+
+    auto stats = store.stats();
+    ASSERT_EQ(stats.stale, 2u);
+    ASSERT_EQ(stats.writes, 2u);
+    std::filesystem::remove_all(directory);
+}
+
+TEST(TestSnapshotStore, TestColdStartReadsFromDisk) {
+    auto directory = snapshot_directory("forti_api_snapshots_client");
+    {
+        auto replay = std::make_shared<ReplayTransport>(std::vector<Exchange>{
+                answer("GET", "/cmdb/dnsfilter/profile", profile_listing("7"))});
+        FortiClient client(offline_device, replay);
+        client.enable_snapshots(directory);
+        ASSERT_EQ(client.get<DNSProfilesResponse>("/cmdb/dnsfilter/profile").results.size(), 1u);
+        ASSERT_EQ(client.snapshot_stats().writes, 1u);
+    }
+
+    // the next run only asks the device for its revision
+    auto replay = std::make_shared<ReplayTransport>(std::vector<Exchange>{
+            probe("7"), probe("8"),
+            answer("PUT", "/cmdb/dnsfilter/profile/office"),
+            answer("GET", "/cmdb/dnsfilter/profile", profile_listing("8"))});
+    FortiClient client(offline_device, replay);
+    client.enable_snapshots(directory);
+    auto restored = client.get<DNSProfilesResponse>("/cmdb/dnsfilter/profile");
+    ASSERT_EQ(restored.results[0].ftgd_dns.filters[0].id, 4u);
+    ASSERT_EQ(client.snapshot_stats().hits, 1u);
+    ASSERT_EQ(replay->stats().served, 1u);
+
+    // a write moves the revision on, so the snapshot is checked again and refetched
+    client.put("/cmdb/dnsfilter/profile/office", restored.results[0]);
+    ASSERT_EQ(client.get<DNSProfilesResponse>("/cmdb/dnsfilter/profile").revision, "8");
+    auto stats = client.snapshot_stats();
+    ASSERT_EQ(stats.probes, 2u);
+    ASSERT_EQ(stats.stale, 1u);
+    ASSERT_EQ(stats.writes, 1u);
+    ASSERT_EQ(replay->stats().misses, 0u);
+    std::filesystem::remove_all(directory);
+}
@@ -23,3 +23,25 @@ TEST(TestSystem, TestGetPhysicalInterface) {
     ASSERT_TRUE(!interface.ipv4_addresses.empty());
     ASSERT_TRUE(interface.type == "physical");
 }
+
+TEST(TestSystem, TestInterfaceSnapshotIndex) {
+    InterfaceSnapshot snapshot({
+        {{"name", "wan1"}, {"type", "physical"}, {"vdom", "root"}, {"is_used", true}, {"speed", 1000},
+         {"ipv4_addresses", {{{"ip", "203.0.113.7"}, {"netmask", "255.255.255.0"}, {"cidr_netmask", 24}}}}},
+        {{"name", "wan1"}, {"type", "physical"}, {"vdom", "guest"}},
+        {{"name", "lan"}, {"type", "hard-switch-vlan"}, {"vdom", "root"}},
+        {{"name", "no-type"}}
+    });
+
+    ASSERT_EQ(snapshot.size(), 3u);
+    ASSERT_EQ(*snapshot.first_ipv4("wan1", "root", "physical"), "203.0.113.7");
+    ASSERT_EQ(snapshot.first_ipv4("wan1", "guest"), nullptr);
+    ASSERT_FALSE(snapshot.get("lan", "root", "physical").has_value());
+
+    auto wan = snapshot.get("wan1");
+    ASSERT_TRUE(wan.has_value());
+    ASSERT_TRUE(wan->is_used);
+    ASSERT_FALSE(wan->is_physical);
+    ASSERT_EQ(wan->speed, 1000u);
+    ASSERT_EQ(wan->ipv4_addresses[0].cidr_netmask, 24u);
+}
@@ -3,7 +3,8 @@
 //
 
 #include <gtest/gtest.h>
-#include "include/forti_api/threat_feed.hpp"
+#include <filesystem>
+#include "offline_device.hpp"
 
 TEST(TestThreatFeed, TestGetAllFeeds) {
     auto feeds = ThreatFeed::get();
@@ -23,3 +24,153 @@ TEST(TestThreatFeed, TestAddAndRemoveThreatFeed) {
     ThreatFeed::del(name);
     ASSERT_TRUE(!ThreatFeed::contains(name));
 }
+
+// Runs pushes against a replayed device and returns the commands each one sent.
+template<typename Pushes>
+static std::vector<nlohmann::json> recorded_pushes(const std::string& log_name, Pushes pushes,
+                                                   std::string response = success_body) {
+    auto path = (std::filesystem::temp_directory_path() / log_name).string();
+    auto recorder = std::make_shared<RecordingTransport>(std::make_shared<ReplayTransport>(std::vector<Exchange>{
+            answer("POST", "/monitor/system/external-resource/dynamic", std::move(response))}), path);
+    {
+        FortiAPI::Scope scope(FortiClient::create(offline_device, recorder));
+        pushes();
+    }
+    recorder->flush();
+
+    std::vector<nlohmann::json> commands;
+    for (const auto& exchange : ExchangeLog::load(path))
+        commands.push_back(nlohmann::json::parse(exchange.request_body)["commands"]);
+    std::filesystem::remove(path);
+    return commands;
+}
+
+TEST(TestThreatFeed, TestDeltaPushSendsOnlyChanges) {
+    std::vector<FeedUpdate> updates;
+    auto pushes = recorded_pushes("forti_api_feed_delta.log", [&] {
+        std::vector<std::string> entries{"a.example", "b.example", "c.example", "d.example", "e.example"};
+        updates.push_back(ThreatFeed::update_feed_delta("delta-feed", entries));
+        entries[2] = "f.example";
+        updates.push_back(ThreatFeed::update_feed_delta("delta-feed", entries));
+        updates.push_back(ThreatFeed::update_feed_delta("delta-feed", entries));
+    });
+
+    // no baseline yet: a snapshot
+    ASSERT_TRUE(updates[0].snapshot);
+    ASSERT_EQ(pushes[0][0]["command"], "snapshot");
+    ASSERT_EQ(pushes[0][0]["entries"].size(), 5u);
+
+    ASSERT_FALSE(updates[1].snapshot);
+    ASSERT_EQ(updates[1].added, 1u);
+    ASSERT_EQ(updates[1].removed, 1u);
+    ASSERT_EQ(pushes[1][0]["command"], "add");
+    ASSERT_EQ(pushes[1][0]["entries"], nlohmann::json::array({"f.example"}));
+    ASSERT_EQ(pushes[1][1]["command"], "remove");
+    ASSERT_EQ(pushes[1][1]["entries"], nlohmann::json::array({"c.example"}));
+
+    ASSERT_TRUE(updates[1].succeeded());
+
+    // nothing changed: nothing sent
+    ASSERT_EQ(updates[2].added + updates[2].removed, 0u);
+    ASSERT_FALSE(updates[2].response);
+    ASSERT_TRUE(updates[2].succeeded());
+    ASSERT_EQ(pushes.size(), 2u);
+}
+
+TEST(TestThreatFeed, TestLargeDeltaFallsBackToSnapshot) {
+    std::vector<FeedUpdate> updates;
+    auto pushes = recorded_pushes("forti_api_feed_ratio.log", [&] {
+        ThreatFeed::update_feed_delta("ratio-feed", {"a.example", "b.example", "c.example", "d.example"});
+        // two changes against four entries: over a 0.25 threshold, within a 0.5 one
+        updates.push_back(ThreatFeed::update_feed_delta("ratio-feed", {"a.example", "b.example", "c.example", "e.example"}, 0.25));
+        updates.push_back(ThreatFeed::update_feed_delta("ratio-feed", {"a.example", "b.example", "c.example", "f.example"}, 0.5));
+    });
+
+    ASSERT_TRUE(updates[0].snapshot);
+    ASSERT_EQ(pushes[1][0]["command"], "snapshot");
+    ASSERT_FALSE(updates[1].snapshot);
+    ASSERT_EQ(pushes[2][0]["command"], "add");
+}
+
+TEST(TestThreatFeed, TestFailedPushDropsTheBaseline) {
+    std::vector<FeedUpdate> updates;
+    recorded_pushes("forti_api_feed_failed.log", [&] {
+        updates.push_back(ThreatFeed::update_feed_delta("failed-feed", {"a.example", "b.example"}));
+        updates.push_back(ThreatFeed::update_feed_delta("failed-feed", {"a.example", "c.example"}));
+    }, R"({"status":"error","http_status":500})");
+
+    // the first snapshot never landed, so there's nothing to diff against
+    ASSERT_TRUE(updates[0].snapshot);
+    ASSERT_TRUE(updates[1].snapshot);
+    ASSERT_FALSE(updates[0].succeeded());
+    ASSERT_EQ(updates[1].response->http_status, 500);
+}
+
+TEST(TestThreatFeed, TestRefusedDeletesKeepTheBaseline) {
+    ExternalResourcesResponse feeds;
+    feeds.status = "success";
+    feeds.http_status = 200;
+    feeds.results = {PushThreatFeed("kept-feed", 219), PushThreatFeed("gone-feed", 219)};
+    auto refused = R"({"status":"error","http_status":500})";
+    auto client = FortiClient::create(offline_device, std::make_shared<ReplayTransport>(std::vector<Exchange>{
+            answer("GET", "/cmdb/dnsfilter/profile", R"({"status":"success","http_status":200,"results":[]})"),
+            answer("GET", "/cmdb/system/external-resource", nlohmann::json(feeds).dump()),
+            answer("GET", "/cmdb/system/external-resource/kept-feed?format=name|category", nlohmann::json(feeds).dump()),
+            answer("DELETE", "/cmdb/system/external-resource/kept-feed", 500, refused),
+            answer("DELETE", "/cmdb/system/external-resource/gone-feed"),
+            answer("POST", "/monitor/system/external-resource/dynamic")}));
+    client->set_retry_policy({.max_attempts = 1});
+    FortiAPI::Scope scope(client);
+
+    std::vector<std::string> entries{"a.example", "b.example", "c.example", "d.example", "e.example"};
+    ThreatFeed::update_feed_delta("kept-feed", entries);
+    ThreatFeed::update_feed_delta("gone-feed", entries);
+
+    ThreatFeed::del("kept-feed");
+    ThreatFeed::del(219u);
+    entries[0] = "f.example";
+    ASSERT_FALSE(ThreatFeed::update_feed_delta("kept-feed", entries).snapshot);
+    ASSERT_TRUE(ThreatFeed::update_feed_delta("gone-feed", entries).snapshot);
+}
+
+TEST(TestThreatFeed, TestEntrySetDecodesStraightIntoDomains) {
+    auto body = R"({"http_method":"GET","status":"success","http_status":200,"results":{"status":"enable",)"
+                R"("resource_file_status":"valid","last_content_update_time":1700000000,"entries":[)"
+                R"({"entry":"Ads.Example.com","valid":"true","notes":""},)"
+                R"({"entry":"tracker.example.net","valid":"false","notes":"bad line"}]}})";
+    auto replay = std::make_shared<ReplayTransport>(std::vector<Exchange>{answer(
+            "GET", "/cmdb/system/external-resource/entry-list?include_notes=true&vdom=root&mkey=/ads", body)});
+    FortiAPI::Scope scope(FortiClient::create(offline_device, replay));
+
+    auto set = ThreatFeed::get_entry_set("ads");
+    ASSERT_EQ(set.size(), 2u);
+    ASSERT_EQ(set.is_valid("ads.example.com"), true);
+    ASSERT_EQ(set.is_valid("tracker.example.net"), false);
+
+    auto decoded = SaxDecoder::decode<ExternalResourceDomainListResponse>(body);
+    ASSERT_EQ(nlohmann::json(decoded.results.entries), nlohmann::json::parse(R"([{"entry":"Ads.Example.com","valid":"true"},
+        {"entry":"tracker.example.net","valid":"false"}])"));
+}
+
+static std::pair<std::string, std::size_t> drain(CommandStream stream) {
+    std::string body;
+    std::size_t chunks = 0;
+    for (auto chunk = stream(); !chunk.empty(); chunk = stream(), ++chunks) body += chunk;
+    return {body, chunks};
+}
+
+TEST(TestThreatFeed, TestCommandStreamMatchesDump) {
+    auto expect_same = [](const std::vector<std::string>& entries, const std::string& command) {
+        auto [body, chunks] = drain(CommandStream("stream-feed", entries_from(entries.begin(), entries.end()), command));
+        EXPECT_EQ(body, nlohmann::json(CommandsRequest(CommandEntry("stream-feed", entries, command))).dump());
+        return chunks;
+    };
+
+    ASSERT_EQ(expect_same({}, "snapshot"), 1u);
+    ASSERT_EQ(expect_same({"ads.example.com"}, "add"), 1u);
+    ASSERT_EQ(expect_same({"quote\"back\\slash", "tab\tline\nfeed\b\f\x01"}, "remove"), 1u);
+
+    std::vector<std::string> many;
+    for (int i = 0; i < 20000; ++i) many.push_back(std::format("host-{}.tracker.example.net", i));
+    ASSERT_GT(expect_same(many, "snapshot"), 1u);
+}